@@ -2163,6 +2163,44 @@ void collapseLowBranchSupport(char *user_file, char *split_threshold_str) {
 }
 
 
+/**
+    pin OpenMP threads to logical CPUs grouped by NUMA node and report the placement.
+    Consecutive threads share a node, matching the static schedule of kernel packets
+    @param num_threads number of threads
+*/
+void bindThreadsToNumaNodes(int num_threads) {
+#ifdef _OPENMP
+    if (num_threads < 1) {
+        outWarning("--numa requires a fixed number of threads (-T NUM), option ignored");
+        Params::getInstance().numa_aware = false;
+        return;
+    }
+    // kernel packets of thread i are always the i-th slice of the patterns
+    omp_set_schedule(omp_sched_static, 0);
+    IntVector cpus;
+    int num_nodes = getCPUsByNumaNode(cpus);
+    if (cpus.empty()) {
+        outWarning("Thread pinning not supported on this platform, --numa only affects memory placement");
+        return;
+    }
+    IntVector thread_cpu(num_threads, -1);
+    IntVector pinned(num_threads, 0);
+    #pragma omp parallel num_threads(num_threads)
+    {
+        int thread = omp_get_thread_num();
+        pinned[thread] = pinThreadToCPU(cpus[((size_t)thread * cpus.size()) / num_threads]);
+        thread_cpu[thread] = getCurrentCPU();
+    }
+    cout << "NUMA:    " << num_nodes << " node(s), thread:CPU/node";
+    for (int thread = 0; thread < num_threads; thread++) {
+        cout << " " << thread << ":" << thread_cpu[thread] << "/" << getNumaNodeOfCPU(thread_cpu[thread]);
+        if (!pinned[thread])
+            cout << "(unpinned)";
+    }
+    cout << endl << endl;
+#endif
+}
+
 /********************************************************
     main function
 ********************************************************/
@@ -2421,6 +2459,7 @@ int main(int argc, char *argv[]) {
         outError("You have specified more threads than CPU cores available");
     }
     omp_set_nested(false); // don't allow nested OpenMP parallelism
+    omp_set_schedule(omp_sched_dynamic, 1); // for kernel packet loops with schedule(runtime)
 #else
     if (Params::getInstance().num_threads != 1) {
         cout << endl << endl;
@@ -2445,6 +2484,9 @@ int main(int argc, char *argv[]) {
 
     //cout << "sizeof(int)=" << sizeof(int) << endl;
     cout << endl << endl;
+
+    if (Params::getInstance().numa_aware)
+        bindThreadsToNumaNodes(Params::getInstance().num_threads);
     
     // show msgs which are delayed to show
     cout << Params::getInstance().delay_msgs;
@@ -2610,7 +2610,10 @@ void runTreeReconstruction(Params &params, IQTree* &iqtree) {
 
         uint64_t mem_required = iqtree->getMemoryRequired();
 
-        if (mem_required >= total_mem*0.95 && !iqtree->isSuperTree()) {
+        if (params.lh_scratch_dir) {
+            // partial likelihoods are paged in from scratch files as needed
+            cout << "NOTE: Partial likelihoods are kept in scratch files in " << params.lh_scratch_dir << endl;
+        } else if (mem_required >= total_mem*0.95 && !iqtree->isSuperTree()) {
             // switch to memory saving mode
             if (params.lh_mem_save != LM_MEM_SAVE) {
                 params.max_mem_size = (total_mem*0.95)/mem_required;
@@ -2626,7 +2629,7 @@ void runTreeReconstruction(Params &params, IQTree* &iqtree) {
                 mem_required = iqtree->getMemoryRequired();
             }
         }
-        if (mem_required >= total_mem) {
+        if (mem_required >= total_mem && !params.lh_scratch_dir) {
             cerr << "ERROR: Your RAM is below minimum requirement of " << (mem_required / 1073741824.0) << " GB RAM" << endl;
             outError("Memory saving mode cannot work, switch to another computer!!!");
         }
@@ -2982,7 +2985,7 @@ void runTreeReconstruction(Params &params, IQTree* &iqtree) {
         cout << "Computing rootstrap supports..." << endl;
         string saved = iqtree->getTreeString();
         MTreeSet trees;
-        trees.init(iqtree->boot_trees, iqtree->rooted);
+        iqtree->getBootTrees(trees);
         iqtree->computeRootstrap(trees, true);
         iqtree->readTreeString(saved);
     }
@@ -3422,6 +3425,376 @@ void exhaustiveSearchGAMMAInvar(Params &params, IQTree &iqtree) {
 /**********************************************************
  * STANDARD NON-PARAMETRIC BOOTSTRAP
  ***********************************************************/
+/**
+    draw the pattern frequencies of a bootstrap replicate, which are handed to the process
+    or thread running the replicate instead of a new alignment
+    @param alignment original alignment
+    @param sample replicate number, which determines the random seed
+    @param[out] weights frequency of each pattern of alignment, empty if the replicate needs
+        its own alignment (partitions, -bsam, site-specific frequencies or PoMo)
+*/
+void createBootstrapWeights(Params &params, Alignment *alignment, int sample, IntVector &weights) {
+    weights.clear();
+    if (alignment->isSuperAlignment() || params.bootstrap_spec || !alignment->site_state_freq.empty() ||
+        alignment->seq_type == SEQ_POMO)
+        return;
+    int *rstream;
+    init_random(params.ran_seed + sample, false, &rstream);
+    weights.resize(alignment->getNPattern());
+    alignment->createBootstrapAlignment(weights.data(), NULL, rstream);
+    finish_random(rstream);
+}
+
+/**
+    create the alignment of a bootstrap replicate
+    @param alignment original alignment
+    @param sample replicate number, which determines the random seed
+    @param weights pattern frequencies from createBootstrapWeights, NULL or empty to draw the sites
+    @return new bootstrap alignment
+*/
+Alignment *createBootstrapReplicate(Params &params, Alignment *alignment, int sample, IntVector *weights = NULL) {
+    if (weights && !weights->empty()) {
+        // only the patterns of the original alignment are copied
+        Alignment *bootstrap_alignment = new Alignment;
+        bootstrap_alignment->extractPatternFreqs(alignment, *weights);
+        return bootstrap_alignment;
+    }
+
+    // 2015-12-17: initialize random stream for creating bootstrap samples
+    // mainly so that checkpointing does not need to save bootstrap samples
+    int *saved_randstream = randstream;
+    init_random(params.ran_seed + sample);
+
+    Alignment* bootstrap_alignment;
+    if (alignment->isSuperAlignment())
+        bootstrap_alignment = new SuperAlignment;
+    else
+        bootstrap_alignment = new Alignment;
+    bootstrap_alignment->createBootstrapAlignment(alignment, NULL, params.bootstrap_spec);
+
+    // restore randstream
+    finish_random();
+    randstream = saved_randstream;
+    return bootstrap_alignment;
+}
+
+/**
+    print the optional per-replicate outputs (.bootlh, .bootaln, .bootsitefreq)
+    @param alignment original alignment
+    @param bootstrap_alignment alignment of the replicate
+    @param sample replicate number
+*/
+void printBootstrapReplicate(Params &params, Alignment *alignment, Alignment *bootstrap_alignment, int sample) {
+    string bootaln_name = params.out_prefix;
+    bootaln_name += ".bootaln";
+    string bootlh_name = params.out_prefix;
+    bootlh_name += ".bootlh";
+    if (params.print_tree_lh) {
+        double prob;
+        bootstrap_alignment->multinomialProb(*alignment, prob);
+        ofstream boot_lh;
+        if (sample == 0)
+            boot_lh.open(bootlh_name.c_str());
+        else
+            boot_lh.open(bootlh_name.c_str(), ios_base::out | ios_base::app);
+        boot_lh << "0\t" << prob << endl;
+        boot_lh.close();
+    }
+    if (params.print_bootaln) {
+        bootstrap_alignment->printAlignment(params.aln_output_format, bootaln_name.c_str(), true);
+    }
+
+    if (params.print_boot_site_freq) {
+        printSiteStateFreq((((string)params.out_prefix)+"."+convertIntToString(sample)+".bootsitefreq").c_str(), bootstrap_alignment);
+            bootstrap_alignment->printAlignment(params.aln_output_format, (((string)params.out_prefix)+"."+convertIntToString(sample)+".bootaln").c_str());
+    }
+}
+
+/**
+    create the tree of a bootstrap replicate, of the same kind as the tree of the original alignment
+    @param alignment original alignment
+    @param bootstrap_alignment alignment of the replicate
+    @param tree tree of the original alignment
+*/
+IQTree *createBootstrapTree(Params &params, Alignment *alignment, Alignment *bootstrap_alignment, IQTree *tree) {
+    IQTree *boot_tree;
+    if (alignment->isSuperAlignment()){
+        if(params.partition_type != BRLEN_OPTIMIZE){
+            boot_tree = new PhyloSuperTreePlen((SuperAlignment*) bootstrap_alignment, (PhyloSuperTree*) tree);
+        } else {
+            boot_tree = new PhyloSuperTree((SuperAlignment*) bootstrap_alignment, (PhyloSuperTree*) tree);
+        }
+    } else {
+        // allocate heterotachy tree if neccessary
+        int pos = posRateHeterotachy(alignment->model_name);
+
+        if (params.num_mixlen > 1) {
+            boot_tree = new PhyloTreeMixlen(bootstrap_alignment, params.num_mixlen);
+        } else if (pos != string::npos) {
+            boot_tree = new PhyloTreeMixlen(bootstrap_alignment, 0);
+        } else
+            boot_tree = new IQTree(bootstrap_alignment);
+    }
+
+    if (!tree->constraintTree.empty()) {
+        boot_tree->constraintTree.readConstraint(tree->constraintTree);
+    }
+    boot_tree->num_precision = tree->num_precision;
+    return boot_tree;
+}
+
+/**
+    remove the files that the tree search of a replicate wrote under its own prefix (.mldist, .bionj, ...)
+    @param prefix output prefix of the replicate
+*/
+void removeBootstrapFiles(string prefix) {
+    size_t pos = prefix.find_last_of("/\\");
+    string dir = (pos == string::npos) ? "" : prefix.substr(0, pos+1);
+    string name = prefix.substr(pos+1) + ".";
+    StrVector files;
+    getFilesInDir(dir.empty() ? "." : dir.c_str(), files);
+    for (auto file : files)
+        if (file.compare(0, name.length(), name) == 0)
+            remove((dir + file).c_str());
+}
+
+/**
+    run a bootstrap replicate next to others (MPI workers, --boot-workers) with its own copy of
+    params, random stream, checkpoint and output prefix. No output files are kept, only the
+    tree is returned
+    @param alignment original alignment
+    @param tree tree of the original alignment
+    @param bootstrap_alignment alignment of the replicate, deleted afterwards
+    @param sample replicate number
+    @param num_threads number of threads of the replicate
+    @return the replicate tree
+*/
+string runBootstrapReplicate(Params &params, Alignment *alignment, IQTree *tree,
+                             Alignment *bootstrap_alignment, int sample, int num_threads)
+{
+    IQTree *boot_tree = createBootstrapTree(params, alignment, bootstrap_alignment, tree);
+    // the replicate state is only kept in memory, the caller checkpoints the tree
+    Checkpoint checkpoint;
+    boot_tree->setCheckpoint(&checkpoint);
+
+    Params boot_params = params;
+    string boot_prefix = string(params.out_prefix) + ".boot" + convertIntToString(sample+1);
+    boot_params.out_prefix = (char*)boot_prefix.c_str();
+    boot_params.suppress_output_flags |= OUT_LOG + OUT_TREEFILE + OUT_IQTREE;
+    boot_params.num_threads = num_threads;
+    // PLL keeps global state, thus use the own parsimony kernel
+    if (boot_params.start_tree == STT_PLL_PARSIMONY)
+        boot_params.start_tree = STT_PARSIMONY;
+
+    // the tree search draws from its own stream, seeded after the alignment seeds;
+    // init_random also seeds the shared AliSim generator
+    int *saved_randstream = randstream;
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+    init_random(params.ran_seed + params.num_bootstrap_samples + sample, false, &randstream);
+
+    runTreeReconstruction(boot_params, boot_tree);
+
+    finish_random();
+    randstream = saved_randstream;
+
+    stringstream ss;
+    boot_tree->printTree(ss);
+    bootstrap_alignment = boot_tree->aln;
+    delete boot_tree;
+    delete bootstrap_alignment;
+    removeBootstrapFiles(boot_prefix);
+    return ss.str();
+}
+
+/**
+    checkpoint a finished replicate tree, then append the trees of the replicates from
+    bootSample on that are finished to .boottrees in replicate order, with the optional
+    per-replicate outputs
+    @param alignment original alignment
+    @param checkpoint checkpoint of the analysis, keeps the trees finished ahead of bootSample
+    @param sample replicate number
+    @param tree_str replicate tree
+    @param[in,out] bootSample number of replicates in .boottrees
+    @param out stream for the progress
+*/
+void saveBootstrapTree(Params &params, Alignment *alignment, Checkpoint *checkpoint, int sample,
+                       string tree_str, int &bootSample, ostream &out)
+{
+    checkpoint->put("bootTree" + convertIntToString(sample), tree_str);
+    out << RESAMPLE_NAME_I << " replicate " << sample+1 << " done" << endl;
+    string boottrees_name = params.out_prefix;
+    boottrees_name += ".boottrees";
+    string key;
+    while (checkpoint->getString(key = "bootTree" + convertIntToString(bootSample), tree_str)) {
+        if (params.print_tree_lh || params.print_bootaln || params.print_boot_site_freq) {
+            // the replicate alignment is created again from its seed
+            IntVector weights;
+            createBootstrapWeights(params, alignment, bootSample, weights);
+            Alignment *bootstrap_alignment = createBootstrapReplicate(params, alignment, bootSample, &weights);
+            printBootstrapReplicate(params, alignment, bootstrap_alignment, bootSample);
+            delete bootstrap_alignment;
+        }
+        try {
+            ofstream tree_out;
+            tree_out.exceptions(ios::failbit | ios::badbit);
+            tree_out.open(boottrees_name.c_str(), ios_base::out | ios_base::app);
+            tree_out << tree_str << endl;
+            tree_out.close();
+        } catch (ios::failure) {
+            outError(ERR_WRITE_OUTPUT, boottrees_name);
+        }
+        checkpoint->erase(key);
+        bootSample++;
+    }
+    checkpoint->put("bootSample", bootSample);
+    checkpoint->putBool("finished", false);
+    checkpoint->dump(true);
+}
+
+/**
+    run the bootstrap replicates on MPI workers: the master hands out one replicate at a time
+    to idle workers, together with its pattern frequencies, and checkpoints each returned tree
+    @param alignment original alignment
+    @param tree tree of the original alignment
+    @param[in,out] bootSample number of replicates in .boottrees
+*/
+void runBootstrapMPI(Params &params, Alignment *alignment, IQTree *tree, int &bootSample) {
+#ifdef _IQTREE_MPI
+    MPIHelper &mpi = MPIHelper::getInstance();
+    Checkpoint *checkpoint = tree->getCheckpoint();
+    int sample;
+    if (mpi.isMaster()) {
+        cout << "Distributing " << RESAMPLE_NAME << " replicates over " << mpi.getNumProcesses()-1
+             << " MPI workers" << endl;
+        IntVector idle_workers;
+        for (int worker = mpi.getNumProcesses()-1; worker > 0; worker--)
+            idle_workers.push_back(worker);
+        int running = 0;
+        int next_sample = bootSample;
+        while (true) {
+            while (!idle_workers.empty() && next_sample < params.num_bootstrap_samples) {
+                sample = next_sample++;
+                // replicates finished before a restart are restored from the checkpoint
+                if (checkpoint->hasKey("bootTree" + convertIntToString(sample)))
+                    continue;
+                Checkpoint work;
+                IntVector weights;
+                createBootstrapWeights(params, alignment, sample, weights);
+                work.put("bootSample", sample);
+                if (!weights.empty())
+                    work.putVector("bootWeights", weights);
+                mpi.sendCheckpoint(&work, idle_workers.back());
+                idle_workers.pop_back();
+                running++;
+            }
+            if (running == 0)
+                break;
+
+            // collect the next tree
+            Checkpoint reply;
+            idle_workers.push_back(mpi.recvCheckpoint(&reply));
+            running--;
+            string tree_str;
+            reply.get("bootSample", sample);
+            reply.getString("bootTree", tree_str);
+            saveBootstrapTree(params, alignment, checkpoint, sample, tree_str, bootSample, cout);
+        }
+        // tell workers to stop
+        Checkpoint stop;
+        stop.put("bootSample", -1);
+        for (int worker = 1; worker < mpi.getNumProcesses(); worker++)
+            mpi.sendCheckpoint(&stop, worker);
+    } else {
+        int num_procs = mpi.getNumProcesses();
+        int proc_id = mpi.getProcessID();
+        VerboseMode saved_mode = verbose_mode;
+        verbose_mode = VB_QUIET;
+        while (true) {
+            Checkpoint work;
+            mpi.recvCheckpoint(&work, PROC_MASTER);
+            work.get("bootSample", sample);
+            if (sample < 0)
+                break;
+            IntVector weights;
+            work.getVector("bootWeights", weights);
+            Alignment *bootstrap_alignment = createBootstrapReplicate(params, alignment, sample, &weights);
+            // the replicate runs alone, as master to finalize its tree
+            mpi.setNumProcesses(1);
+            mpi.setProcessID(PROC_MASTER);
+            string tree_str = runBootstrapReplicate(params, alignment, tree, bootstrap_alignment,
+                                                    sample, params.num_threads);
+            mpi.setNumProcesses(num_procs);
+            mpi.setProcessID(proc_id);
+            Checkpoint reply;
+            reply.put("bootSample", sample);
+            reply.put("bootTree", tree_str);
+            mpi.sendCheckpoint(&reply, PROC_MASTER);
+        }
+        verbose_mode = saved_mode;
+    }
+#endif
+}
+
+/** stream buffer that discards all output */
+class NullStreamBuf : public streambuf {
+protected:
+    virtual int overflow(int c = EOF) { return c; }
+};
+
+/**
+    run num_workers bootstrap replicates at a time, each with its share of the threads. Idle
+    workers take the next replicate and checkpoint its tree when done. The output of the
+    replicates is discarded, only their progress is printed
+    @param alignment original alignment
+    @param tree tree of the original alignment
+    @param[in,out] bootSample number of replicates in .boottrees
+    @param num_workers number of replicates run at a time
+*/
+void runBootstrapConcurrent(Params &params, Alignment *alignment, IQTree *tree, int &bootSample, int num_workers) {
+#ifdef _OPENMP
+    Checkpoint *checkpoint = tree->getCheckpoint();
+    int num_threads = params.num_threads / num_workers;
+    IntVector samples;
+    for (int sample = bootSample; sample < params.num_bootstrap_samples; sample++)
+        // replicates finished before a restart are restored from the checkpoint
+        if (!checkpoint->hasKey("bootTree" + convertIntToString(sample)))
+            samples.push_back(sample);
+    cout << "Running " << samples.size() << " " << RESAMPLE_NAME << " replicates, " << num_workers
+         << " at a time with " << num_threads << " threads each" << endl;
+
+    // the log cannot take the output of several replicates at a time
+    streambuf *saved_buf = cout.rdbuf();
+    ostream progress(saved_buf);
+    NullStreamBuf null_buf;
+    cout.rdbuf(&null_buf);
+    cout.setstate(ios::badbit);
+    VerboseMode saved_mode = verbose_mode;
+    omp_set_nested(true);
+#pragma omp parallel for schedule(dynamic) num_threads(num_workers)
+    for (int i = 0; i < samples.size(); i++) {
+        Alignment *bootstrap_alignment;
+        // creating an alignment changes verbose_mode temporarily
+#pragma omp critical
+        {
+            IntVector weights;
+            createBootstrapWeights(params, alignment, samples[i], weights);
+            bootstrap_alignment = createBootstrapReplicate(params, alignment, samples[i], &weights);
+        }
+        // parallel regions without a thread count, e.g. for the parsimony trees, use the share of the replicate
+        omp_set_num_threads(num_threads);
+        string tree_str = runBootstrapReplicate(params, alignment, tree, bootstrap_alignment,
+                                                samples[i], num_threads);
+#pragma omp critical
+        saveBootstrapTree(params, alignment, checkpoint, samples[i], tree_str, bootSample, progress);
+    }
+    omp_set_nested(false);
+    verbose_mode = saved_mode;
+    cout.rdbuf(saved_buf);
+#endif
+}
+
 void runStandardBootstrap(Params &params, Alignment *alignment, IQTree *tree) {
     ModelCheckpoint *model_info = new ModelCheckpoint;
     StrVector removed_seqs, twin_seqs;
@@ -3444,8 +3817,6 @@ void runStandardBootstrap(Params &params, Alignment *alignment, IQTree *tree) {
     boottrees_name += ".boottrees";
     string bootaln_name = params.out_prefix;
     bootaln_name += ".bootaln";
-    string bootlh_name = params.out_prefix;
-    bootlh_name += ".bootlh";
     int bootSample = 0;
     if (tree->getCheckpoint()->get("bootSample", bootSample)) {
         cout << "CHECKPOINT: " << bootSample << " bootstrap analyses restored" << endl;
@@ -3480,88 +3851,44 @@ void runStandardBootstrap(Params &params, Alignment *alignment, IQTree *tree) {
     // 2018-06-21: bug fix: alignment might be changed by -m ...MERGE
     alignment = tree->aln;
     
+    // replicates are independent: MPI workers run one at a time, or --boot-workers run several
+    // in this process; a restart resumes at the replicates whose trees are not checkpointed
+    int num_workers = 0;
+    if (params.num_boot_workers > 1 && MPIHelper::getInstance().getNumProcesses() == 1) {
+        num_workers = min(params.num_boot_workers, params.num_threads);
+        if (params.num_threads <= 0 || alignment->isSuperAlignment() || params.pll ||
+            params.start_tree == STT_RANDOM_TREE || params.lh_mem_save == LM_MEM_SAVE ||
+            params.lh_scratch_dir || params.count_trees || params.num_bootstrap_samples == 1) {
+            outWarning("Concurrent replicates (--boot-workers) do not support this analysis, replicates run one at a time");
+            num_workers = 0;
+        }
+    }
+
+    if (MPIHelper::getInstance().getNumProcesses() > 1) {
+        runBootstrapMPI(params, alignment, tree, bootSample);
+    } else if (num_workers > 1) {
+        runBootstrapConcurrent(params, alignment, tree, bootSample, num_workers);
+    } else
     // do bootstrap analysis
     for (int sample = bootSample; sample < params.num_bootstrap_samples; sample++) {
         cout << endl << "===> START " << RESAMPLE_NAME_UPPER << " REPLICATE NUMBER "
                 << sample + 1 << endl << endl;
 
-        // 2015-12-17: initialize random stream for creating bootstrap samples
-        // mainly so that checkpointing does not need to save bootstrap samples
-        int *saved_randstream = randstream;
-        init_random(params.ran_seed + sample);
-
-        Alignment* bootstrap_alignment;
         cout << "Creating " << RESAMPLE_NAME << " alignment (seed: " << params.ran_seed+sample << ")..." << endl;
+        Alignment *bootstrap_alignment = createBootstrapReplicate(params, alignment, sample);
 
-        if (alignment->isSuperAlignment())
-            bootstrap_alignment = new SuperAlignment;
-        else
-            bootstrap_alignment = new Alignment;
-        bootstrap_alignment->createBootstrapAlignment(alignment, NULL, params.bootstrap_spec);
-
-        // restore randstream
-        finish_random();
-        randstream = saved_randstream;
-
-        if (params.print_tree_lh && MPIHelper::getInstance().isMaster()) {
-            double prob;
-            bootstrap_alignment->multinomialProb(*alignment, prob);
-            ofstream boot_lh;
-            if (sample == 0)
-                boot_lh.open(bootlh_name.c_str());
-            else
-                boot_lh.open(bootlh_name.c_str(), ios_base::out | ios_base::app);
-            boot_lh << "0\t" << prob << endl;
-            boot_lh.close();
-        }
-        IQTree *boot_tree;
-        if (alignment->isSuperAlignment()){
-            if(params.partition_type != BRLEN_OPTIMIZE){
-                boot_tree = new PhyloSuperTreePlen((SuperAlignment*) bootstrap_alignment, (PhyloSuperTree*) tree);
-            } else {
-                boot_tree = new PhyloSuperTree((SuperAlignment*) bootstrap_alignment, (PhyloSuperTree*) tree);
-            }
-        } else {
-            // allocate heterotachy tree if neccessary
-            int pos = posRateHeterotachy(alignment->model_name);
-            
-            if (params.num_mixlen > 1) {
-                boot_tree = new PhyloTreeMixlen(bootstrap_alignment, params.num_mixlen);
-            } else if (pos != string::npos) {
-                boot_tree = new PhyloTreeMixlen(bootstrap_alignment, 0);
-            } else
-                boot_tree = new IQTree(bootstrap_alignment);
-        }
-        if (params.print_bootaln && MPIHelper::getInstance().isMaster()) {
-            bootstrap_alignment->printAlignment(params.aln_output_format, bootaln_name.c_str(), true);
-        }
-
-        if (params.print_boot_site_freq && MPIHelper::getInstance().isMaster()) {
-            printSiteStateFreq((((string)params.out_prefix)+"."+convertIntToString(sample)+".bootsitefreq").c_str(), bootstrap_alignment);
-                bootstrap_alignment->printAlignment(params.aln_output_format, (((string)params.out_prefix)+"."+convertIntToString(sample)+".bootaln").c_str());
-        }
+        if (MPIHelper::getInstance().isMaster())
+            printBootstrapReplicate(params, alignment, bootstrap_alignment, sample);
 
-        if (!tree->constraintTree.empty()) {
-            boot_tree->constraintTree.readConstraint(tree->constraintTree);
-        }
+        IQTree *boot_tree = createBootstrapTree(params, alignment, bootstrap_alignment, tree);
 
         // set checkpoint
         boot_tree->setCheckpoint(tree->getCheckpoint());
-        boot_tree->num_precision = tree->num_precision;
 
         runTreeReconstruction(params, boot_tree);
-        // read in the output tree file
+        // read in the output tree
         stringstream ss;
         boot_tree->printTree(ss);
-//        try {
-//            ifstream tree_in;
-//            tree_in.exceptions(ios::failbit | ios::badbit);
-//            tree_in.open(treefile_name.c_str());
-//            tree_in >> tree_str;
-//            tree_in.close();
-//        } catch (ios::failure) {
-//            outError(ERR_READ_INPUT, treefile_name);
-//        }
         // write the tree into .boottrees file
         if (MPIHelper::getInstance().isMaster())
         try {
@@ -3593,7 +3920,6 @@ void runStandardBootstrap(Params &params, Alignment *alignment, IQTree *tree) {
         tree->getCheckpoint()->dump(true);
     }
 
-
     if (params.consensus_type == CT_CONSENSUS_TREE && MPIHelper::getInstance().isMaster()) {
 
         cout << endl << "===> COMPUTE CONSENSUS TREE FROM " << params.num_bootstrap_samples
@@ -3765,7 +4091,7 @@ void computeSiteFrequencyModel(Params &params, Alignment *alignment) {
     uint64_t mem_size = tree->getMemoryRequired();
     uint64_t total_mem = getMemorySize();
     cout << "NOTE: " << (mem_size / 1024) / 1024 << " MB RAM is required!" << endl;
-    if (mem_size >= total_mem) {
+    if (mem_size >= total_mem && !params.lh_scratch_dir) {
         outError("Memory required exceeds your computer RAM size!");
     }
 #ifdef BINARY32
@@ -801,8 +801,8 @@ void runModelFinder(Params &params, IQTree &iqtree, ModelCheckpoint &model_info)
     // Model already specifed, nothing to do here
     if (!empty_model_found && params.model_name.substr(0, 4) != "TEST" && params.model_name.substr(0, 2) != "MF")
         return;
-    if (MPIHelper::getInstance().getNumProcesses() > 1)
-        outError("Please use only 1 MPI process! We are currently working on the MPI parallelization of model selection.");
+    if (MPIHelper::getInstance().getNumProcesses() > 1 && params.model_test_and_tree)
+        outError("Please use only 1 MPI process with -mtree option");
     // TODO: check if necessary
     //        if (iqtree.isSuperTree())
     //            ((PhyloSuperTree*) &iqtree)->mapTrees();
@@ -815,6 +815,9 @@ void runModelFinder(Params &params, IQTree &iqtree, ModelCheckpoint &model_info)
     if (!params.model_test_again) {
         ok_model_file = model_info.load();
     }
+    // only the master writes the model checkpoint file
+    if (MPIHelper::getInstance().isWorker())
+        model_info.setFileName("");
     
     cout << endl;
     
@@ -839,7 +842,9 @@ void runModelFinder(Params &params, IQTree &iqtree, ModelCheckpoint &model_info)
     ModelsBlock *models_block = readModelsDefinition(params);
     
     // compute initial tree
-    if (params.modelfinder_ml_tree) {
+    if (MPIHelper::getInstance().isWorker()) {
+        // MPI workers take the initial tree from the master below
+    } else if (params.modelfinder_ml_tree) {
         // 2019-09-10: Now perform NNI on the initial tree
         string tree_str = computeFastMLTree(params, iqtree.aln, model_info,
             models_block, params.num_threads, params.partition_type, iqtree.dist_file);
@@ -855,10 +860,21 @@ void runModelFinder(Params &params, IQTree &iqtree, ModelCheckpoint &model_info)
                 (*it)->saveCheckpoint();
                 model_info.endStruct();
             }
+            // the super tree for MPI workers
+            if (MPIHelper::getInstance().getNumProcesses() > 1)
+                iqtree.PhyloTree::saveCheckpoint();
         } else {
             iqtree.saveCheckpoint();
         }
     }
+
+#ifdef _IQTREE_MPI
+    if (MPIHelper::getInstance().getNumProcesses() > 1) {
+        MPIHelper::getInstance().broadcastCheckpoint(&model_info);
+        if (MPIHelper::getInstance().isWorker())
+            iqtree.restoreCheckpoint();
+    }
+#endif
     
     // also save initial tree to the original .ckp.gz checkpoint
     //        string initTree = iqtree.getTreeString();
@@ -871,7 +887,7 @@ void runModelFinder(Params &params, IQTree &iqtree, ModelCheckpoint &model_info)
     
     uint64_t mem_size = iqtree.getMemoryRequiredThreaded(max_cats);
     cout << "NOTE: ModelFinder requires " << (mem_size / 1024) / 1024 << " MB RAM!" << endl;
-    if (mem_size >= getMemorySize()) {
+    if (mem_size >= getMemorySize() && !params.lh_scratch_dir) {
         outError("Memory required exceeds your computer RAM size!");
     }
 #ifdef BINARY32
@@ -895,7 +911,7 @@ void runModelFinder(Params &params, IQTree &iqtree, ModelCheckpoint &model_info)
     } else {
         // single model selection
         CandidateModel best_model;
-        if (params.openmp_by_model)
+        if (params.openmp_by_model || MPIHelper::getInstance().getNumProcesses() > 1)
             best_model = CandidateModelSet().evaluateAll(params, &iqtree,
                 model_info, models_block, params.num_threads, BRLEN_OPTIMIZE);
         else
@@ -1603,7 +1619,12 @@ string CandidateModel::evaluate(Params &params,
     }
 
 
-    if (restoreCheckpoint(&in_model_info)) {
+    bool restored;
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+    restored = restoreCheckpoint(&in_model_info);
+    if (restored) {
         delete iqtree;
         return "";
     }
@@ -1677,7 +1698,12 @@ string CandidateModel::evaluate(Params &params,
 
             // check if logl(+R[k]) is worse than logl(+R[k-1])
             CandidateModel prev_info;
-            if (!prev_info.restoreCheckpointRminus1(&in_model_info, this)) break;
+            bool prev_restored;
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+            prev_restored = prev_info.restoreCheckpointRminus1(&in_model_info, this);
+            if (!prev_restored) break;
             if (prev_info.logl < new_logl + params.modelfinder_eps) break;
             if (step == 0) {
                 iqtree->getRate()->initFromCatMinusOne();
@@ -1765,6 +1791,85 @@ public:
 
 };
 
+/**
+    best models of subsets of partitions examined during merging, keyed by the bitset of
+    partition IDs so that a subset is found regardless of the order it was merged in.
+    Entries keep the best model for every criterion. Subsets missing in memory are
+    restored from their structs in model_info, which carries them over to later runs
+*/
+class SubsetModelCache {
+
+public:
+
+    SubsetModelCache(size_t num_parts) {
+        num_words = (num_parts + 63) / 64;
+    }
+
+    /**
+        find the best model of a subset under the current criterion
+        @param set_name name of the subset struct in model_info
+        @param[out] best_model model name, logl, df and tree_len of the best model
+        @return TRUE if found
+    */
+    bool get(set<int> &subset, string &set_name, ModelCheckpoint &model_info, CandidateModel &best_model) {
+        string key = getKey(subset);
+        auto it = entries.find(key);
+        if (it == entries.end()) {
+            model_info.startStruct(set_name);
+            string best_name;
+            bool found = model_info.getBestModel(best_name);
+            if (found)
+                it = entries.insert({key, makeEntry(model_info)}).first;
+            model_info.endStruct();
+            if (!found)
+                return false;
+        }
+        CandidateModel &model = it->second.best[Params::getInstance().model_test_criterion];
+        if (model.subst_name.empty())
+            return false;
+        best_model = model;
+        return true;
+    }
+
+    /**
+        record the best models of a subset
+        @param part_model_info model information returned by CandidateModelSet::test()
+    */
+    void put(set<int> &subset, ModelCheckpoint &part_model_info) {
+        entries[getKey(subset)] = makeEntry(part_model_info);
+    }
+
+private:
+
+    struct Entry {
+        /** best model for MTC_AIC, MTC_AICC and MTC_BIC */
+        CandidateModel best[MTC_ALL];
+    };
+
+    string getKey(set<int> &subset) {
+        vector<uint64_t> bits(num_words, 0);
+        for (int part : subset)
+            bits[part / 64] |= (uint64_t)1 << (part % 64);
+        return string((char*)bits.data(), num_words * sizeof(uint64_t));
+    }
+
+    Entry makeEntry(ModelCheckpoint &model_info) {
+        Entry entry;
+        for (int mtc = MTC_AIC; mtc < MTC_ALL; mtc++) {
+            CandidateModel &model = entry.best[mtc];
+            if (model_info.getString("best_model_" + criterionName((ModelTestCriterion)mtc), model.subst_name) &&
+                !model.restoreCheckpoint(&model_info))
+                model.subst_name = "";
+        }
+        return entry;
+    }
+
+    /** number of 64-bit words of a key */
+    size_t num_words;
+
+    unordered_map<string, Entry> entries;
+};
+
 string CandidateModel::evaluateConcatenation(Params &params, SuperAlignment *super_aln,
     ModelCheckpoint &model_info, ModelsBlock *models_block, int num_threads)
 {
@@ -1938,6 +2043,15 @@ void findClosestPairs(SuperAlignment *super_aln, DoubleVector &lenvec, vector<se
     }
 }
 
+/**
+ replace the distance of partition pairs by their rank, closest pair first
+ */
+void rankPairs(vector<SubsetPair> &pairs) {
+    std::stable_sort(pairs.begin(), pairs.end(), comparePairs);
+    for (size_t i = 0; i < pairs.size(); i++)
+        pairs[i].distance = i;
+}
+
 /**
  merge vector src into dest, eliminating duplicates
  */
@@ -1950,6 +2064,61 @@ void mergePairs(vector<SubsetPair> &dest, vector<SubsetPair> &src) {
             dest.push_back(s);
 }
 
+/**
+    merge new entries of all MPI processes into model_info and send it back to every process
+    @param new_info entries computed by this process; only these are gathered as the
+        other entries may be outdated copies
+*/
+void syncModelInfo(ModelCheckpoint &model_info, ModelCheckpoint &new_info) {
+    if (MPIHelper::getInstance().getNumProcesses() == 1)
+        return;
+#ifdef _IQTREE_MPI
+    MPIHelper::getInstance().gatherCheckpoint(&new_info);
+    if (MPIHelper::getInstance().isMaster())
+        model_info.putSubCheckpoint(&new_info, "");
+    MPIHelper::getInstance().broadcastCheckpoint(&model_info);
+    model_info.dump();
+#endif
+}
+
+/**
+    select models for the partitions distributed round-robin over MPI processes and
+    collect all results into model_info, from where the caller restores them
+    @param partitionID partitions sorted by computational cost
+*/
+void distributePartitionModels(Params &params, PhyloSuperTree* in_tree, vector<pair<int,double> > &partitionID,
+    ModelCheckpoint &model_info, ModelsBlock *models_block, int num_threads, int brlen_type,
+    bool merge_phase, bool parallel_over_partitions)
+{
+    int num_procs = MPIHelper::getInstance().getNumProcesses();
+    // ModelOMatic may replace the alignment, which the caller would test again
+    if (num_procs == 1 || params.modelomatic)
+        return;
+    ModelCheckpoint new_info;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if(parallel_over_partitions)
+#endif
+    for (int j = MPIHelper::getInstance().getProcessID(); j < in_tree->size(); j += num_procs) {
+        PhyloTree *this_tree = in_tree->at(partitionID[j].first);
+        ModelCheckpoint part_model_info;
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+        extractModelInfo(this_tree->aln->name, model_info, part_model_info);
+        string part_model_name;
+        if (params.model_name.empty())
+            part_model_name = this_tree->aln->model_name;
+        CandidateModelSet().test(params, this_tree, part_model_info, models_block,
+            (parallel_over_partitions ? 1 : num_threads), brlen_type, this_tree->aln->name,
+            part_model_name, merge_phase);
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+        replaceModelInfo(this_tree->aln->name, new_info, part_model_info);
+    }
+    syncModelInfo(model_info, new_info);
+}
+
 /**
  * select models for all partitions
  * @param[in,out] model_info (IN/OUT) all model information
@@ -2034,6 +2203,10 @@ void testPartitionModel(Params &params, PhyloSuperTree* in_tree, ModelCheckpoint
     
 #ifdef _OPENMP
     parallel_over_partitions = !params.model_test_and_tree && (in_tree->size() >= num_threads);
+#endif
+    distributePartitionModels(params, in_tree, partitionID, model_info, models_block,
+        num_threads, brlen_type, test_merge, parallel_over_partitions);
+#ifdef _OPENMP
 #pragma omp parallel for private(i) schedule(dynamic) reduction(+: lhsum, dfsum) if(parallel_over_partitions)
 #endif
 	for (int j = 0; j < in_tree->size(); j++) {
@@ -2133,6 +2306,9 @@ void testPartitionModel(Params &params, PhyloSuperTree* in_tree, ModelCheckpoint
         cout << "Merging models to increase model fit (about " << total_num_model << " total partition schemes)..." << endl;
     }
 
+    // best models of subsets examined so far
+    SubsetModelCache subset_cache(in_tree->size());
+
     /* following implements the greedy algorithm of Lanfear et al. (2012) */
 	while (params.partition_merge != MERGE_KMEANS && gene_sets.size() >= 2) {
 		// stepwise merging charsets
@@ -2146,14 +2322,30 @@ void testPartitionModel(Params &params, PhyloSuperTree* in_tree, ModelCheckpoint
         // find closest partition pairs
         vector<SubsetPair> closest_pairs;
         findClosestPairs(super_aln, lenvec, gene_sets, false, closest_pairs);
+        if (params.partfinder_topk > 0)
+            rankPairs(closest_pairs);
         if (params.partfinder_log_rate) {
             // additional consider pairs by log-rate
             vector<SubsetPair> log_closest_pairs;
             findClosestPairs(super_aln, lenvec, gene_sets, true, log_closest_pairs);
+            if (params.partfinder_topk > 0)
+                rankPairs(log_closest_pairs);
             mergePairs(closest_pairs, log_closest_pairs);
         }
+        size_t num_pairs = closest_pairs.size();
+        if (params.partfinder_topk > 0) {
+            // interleave pairs of both lists, closest first
+            std::stable_sort(closest_pairs.begin(), closest_pairs.end(), comparePairs);
+        }
+
+        // examine the pairs in batches of the closest ones and stop at the first batch
+        // containing a better pair; a single batch unless --merge-topk is given
+        size_t batch_size = (params.partfinder_topk > 0) ? params.partfinder_topk : num_pairs;
+        for (size_t batch_start = 0; batch_start < num_pairs && better_pairs.empty(); batch_start += batch_size) {
+        size_t batch_end = min(batch_start + batch_size, num_pairs);
+
         // sort partition by computational cost for OpenMP effciency
-        for (i = 0; i < closest_pairs.size(); i++) {
+        for (i = batch_start; i < batch_end; i++) {
             // computation cost is proportional to #sequences, #patterns, and #states
             Alignment *this_aln = in_tree->at(closest_pairs[i].first)->aln;
             closest_pairs[i].distance = -((double)this_aln->getNSeq())*this_aln->getNPattern()*this_aln->num_states;
@@ -2161,14 +2353,23 @@ void testPartitionModel(Params &params, PhyloSuperTree* in_tree, ModelCheckpoint
             closest_pairs[i].distance -= ((double)this_aln->getNSeq())*this_aln->getNPattern()*this_aln->num_states;
         }
         if (num_threads > 1) {
-            std::sort(closest_pairs.begin(), closest_pairs.end(), comparePairs);
+            std::sort(closest_pairs.begin() + batch_start, closest_pairs.begin() + batch_end, comparePairs);
         }
-        size_t num_pairs = closest_pairs.size();
-        
+
+        // with several MPI processes, a first pass examines the new pairs round-robin
+        // and the second pass collects all results from model_info
+        int num_procs = MPIHelper::getInstance().getNumProcesses();
+        int proc_id = MPIHelper::getInstance().getProcessID();
+        vector<char> new_pairs(num_pairs, 0);
+        ModelCheckpoint new_info;
+
+        for (int pass = (num_procs > 1) ? 0 : 1; pass < 2; pass++) {
+        if (pass == 1)
+            syncModelInfo(model_info, new_info);
 #ifdef _OPENMP
 #pragma omp parallel for private(i) schedule(dynamic) if(!params.model_test_and_tree)
 #endif
-        for (size_t pair = 0; pair < num_pairs; pair++) {
+        for (size_t pair = batch_start; pair < batch_end; pair++) {
             // information of current partitions pair
             ModelPair cur_pair;
             cur_pair.part1 = closest_pairs[pair].first;
@@ -2189,13 +2390,12 @@ void testPartitionModel(Params &params, PhyloSuperTree* in_tree, ModelCheckpoint
 #endif
             {
                 // if pairs previously examined, reuse the information
-                model_info.startStruct(cur_pair.set_name);
-                if (model_info.getBestModel(best_model.subst_name)) {
-                    best_model.restoreCheckpoint(&model_info);
-                    done_before = true;
-                }
-                model_info.endStruct();
+                done_before = subset_cache.get(cur_pair.merged_set, cur_pair.set_name, model_info, best_model);
+                if (pass == 0)
+                    new_pairs[pair] = !done_before;
             }
+            if (pass == 0 && (done_before || pair % num_procs != proc_id))
+                continue;
             ModelCheckpoint part_model_info;
             double cur_tree_len = 0.0;
             if (!done_before) {
@@ -2236,8 +2436,11 @@ void testPartitionModel(Params &params, PhyloSuperTree* in_tree, ModelCheckpoint
 #endif
 			{
 				if (!done_before) {
-					replaceModelInfo(cur_pair.set_name, model_info, part_model_info);
+					replaceModelInfo(cur_pair.set_name, (pass == 0) ? new_info : model_info, part_model_info);
                     model_info.dump();
+                    subset_cache.put(cur_pair.merged_set, part_model_info);
+                }
+				if (pass == 1 && (!done_before || new_pairs[pair])) {
                     num_model++;
 					cout.width(4);
 					cout << right << num_model << " ";
@@ -2254,10 +2457,12 @@ void testPartitionModel(Params &params, PhyloSuperTree* in_tree, ModelCheckpoint
                     }
                     cout << endl;
 				}
-                if (cur_pair.score < inf_score)
+                if (pass == 1 && cur_pair.score < inf_score)
                     better_pairs.insertPair(cur_pair);
 			}
 
+        }
+        }
         }
 		if (better_pairs.empty()) break;
         ModelPairSet compatible_pairs;
@@ -2350,6 +2555,10 @@ void testPartitionModel(Params &params, PhyloSuperTree* in_tree, ModelCheckpoint
 
     #ifdef _OPENMP
         parallel_over_partitions = !params.model_test_and_tree && (in_tree->size() >= num_threads);
+    #endif
+        distributePartitionModels(params, in_tree, partitionID, model_info, models_block,
+            num_threads, brlen_type, false, parallel_over_partitions);
+    #ifdef _OPENMP
         #pragma omp parallel for private(i) schedule(dynamic) reduction(+: lhsum, dfsum) if(parallel_over_partitions)
     #endif
         for (int j = 0; j < in_tree->size(); j++) {
@@ -2807,30 +3016,190 @@ CandidateModel CandidateModelSet::test(Params &params, PhyloTree* in_tree, Model
 	return at(best_model);
 }
 
-int64_t CandidateModelSet::getNextModel() {
-    int64_t next_model;
-#pragma omp critical
-    {
-    if (size() == 0)
-        next_model = -1;
-    else if (current_model == -1)
-        next_model = 0;
-    else {
-        for (next_model = current_model+1; next_model != current_model; next_model++) {
-            if (next_model == size())
-                next_model = 0;
-            if (!at(next_model).hasFlag(MF_IGNORED + MF_WAITING + MF_RUNNING)) {
-                break;
+bool CandidateModelSet::isFinished(int last_model) {
+    for (int model = 0; model <= last_model && model < size(); model++)
+        if (at(model).hasFlag(MF_RUNNING) || !at(model).hasFlag(MF_DONE + MF_IGNORED))
+            return false;
+    return true;
+}
+
+int64_t CandidateModelSet::getNextModel(int rate_block, int subst_block) {
+    bool waiting = false;
+    for (int64_t model = 0; model < size(); model++) {
+        if (at(model).hasFlag(MF_DONE + MF_IGNORED))
+            continue;
+        // +R[k] waits for +R[k-1] to start from its estimates; if getLowerKModel finds
+        // no such model, it waits for all previous models instead of waiting forever
+        if (at(model).hasFlag(MF_RUNNING) || (at(model).hasFlag(MF_WAITING) &&
+            getLowerKModel(model) != model-1 && !isFinished(model-1))) {
+            waiting = true;
+            continue;
+        }
+        if ((model > rate_block && !isFinished(rate_block)) ||
+            (model > subst_block && !isFinished(subst_block)))
+            return -2;
+        at(model).setFlag(MF_RUNNING);
+        return model;
+    }
+    return (waiting) ? -2 : -1;
+}
+
+void CandidateModelSet::finishModel(int64_t model, ModelCheckpoint &model_info, ModelCheckpoint *out_model_info,
+                                    int rate_block, int subst_block, bool write_info)
+{
+    int64_t num_models = size();
+    at(model).setFlag(MF_DONE);
+    at(model).resetFlag(MF_RUNNING);
+    model_results[model] = out_model_info;
+
+    int lower_model = getLowerKModel(model);
+    if (lower_model >= 0 && at(lower_model).getScore() < at(model).getScore()) {
+        // ignore all +R_k model with higher category
+        for (int higher_model = model; higher_model != -1;
+            higher_model = getHigherKModel(higher_model)) {
+            at(higher_model).setFlag(MF_IGNORED);
+        }
+    }
+    if (!rates_filtered && rate_block < num_models && isFinished(rate_block)) {
+        filterRates(rate_block); // auto filter rate models
+        rates_filtered = true;
+    }
+    if (!subst_filtered && subst_block < num_models && isFinished(subst_block)) {
+        filterSubst(subst_block); // auto filter substitution model
+        subst_filtered = true;
+    }
+
+    for (; next_commit < num_models; next_commit++) {
+        CandidateModel &info = at(next_commit);
+        if (info.hasFlag(MF_RUNNING) || !info.hasFlag(MF_DONE + MF_IGNORED))
+            break;
+        if (!info.hasFlag(MF_DONE))
+            continue;
+        if (best_score > info.getScore()) {
+            best_score = info.getScore();
+            // only update model_info with better model, models started later begin from its tree
+            model_info.putSubCheckpoint(model_results[next_commit], "");
+        }
+        delete model_results[next_commit];
+        model_results[next_commit] = NULL;
+        if (write_info) {
+            cout.width(3);
+            cout << right << next_commit+1 << "  ";
+            cout.width(13);
+            cout << left << info.getName() << " ";
+
+            cout.precision(3);
+            cout << fixed;
+            cout.width(12);
+            cout << -info.logl << " ";
+            cout.width(3);
+            cout << info.df << " ";
+            cout.width(12);
+            cout << info.AIC_score << " ";
+            cout.width(12);
+            cout << info.AICc_score << " " << info.BIC_score;
+            cout << endl;
+        }
+    }
+}
+
+void CandidateModelSet::evaluateMPI(Params &params, ModelCheckpoint &model_info,
+                                    ModelsBlock *models_block, int num_threads, int brlen_type,
+                                    int rate_block, int subst_block, bool write_info)
+{
+#ifdef _IQTREE_MPI
+    MPIHelper &mpi = MPIHelper::getInstance();
+    int64_t model;
+    if (mpi.isMaster()) {
+        if (write_info && verbose_mode >= VB_MED)
+            cout << "Evaluating models on " << mpi.getNumProcesses()-1 << " MPI workers with "
+                 << num_threads << " threads each" << endl;
+        IntVector idle_workers;
+        for (int worker = mpi.getNumProcesses()-1; worker > 0; worker--)
+            idle_workers.push_back(worker);
+        int running = 0;
+        while (true) {
+            // hand out models to idle workers, each with the current model_info
+            while (!idle_workers.empty() && (model = getNextModel(rate_block, subst_block)) >= 0) {
+                model_info.put("mf_model", model);
+                mpi.sendCheckpoint(&model_info, idle_workers.back());
+                model_info.erase("mf_model");
+                idle_workers.pop_back();
+                running++;
             }
+            if (running == 0)
+                break;
+
+            // collect the next result
+            ModelCheckpoint reply;
+            idle_workers.push_back(mpi.recvCheckpoint(&reply));
+            running--;
+            reply.get("mf_model", model);
+            reply.getString("mf_subst_name", at(model).subst_name);
+            reply.getString("mf_rate_name", at(model).rate_name);
+            at(model).restoreCheckpoint(&reply);
+            at(model).saveCheckpoint(&model_info);
+            at(model).computeICScores();
+            ModelCheckpoint *out_model_info = new ModelCheckpoint;
+            reply.getSubCheckpoint(out_model_info, "mf_result");
+            finishModel(model, model_info, out_model_info, rate_block, subst_block, write_info);
+            model_info.dump();
         }
+        // tell workers to stop
+        ModelCheckpoint stop;
+        stop.put("mf_model", -1);
+        for (int worker = 1; worker < mpi.getNumProcesses(); worker++)
+            mpi.sendCheckpoint(&stop, worker);
+    } else {
+        while (true) {
+            model_info.clear();
+            mpi.recvCheckpoint(&model_info, PROC_MASTER);
+            model_info.get("mf_model", model);
+            model_info.erase("mf_model");
+            if (model < 0)
+                break;
+            ModelCheckpoint out_model_info;
+            at(model).set_name = at(model).aln->name;
+            int this_threads = num_threads;
+            at(model).evaluate(params, model_info, out_model_info,
+                               models_block, this_threads, brlen_type);
+            ModelCheckpoint reply;
+            reply.put("mf_model", model);
+            reply.put("mf_subst_name", at(model).subst_name);
+            reply.put("mf_rate_name", at(model).rate_name);
+            at(model).saveCheckpoint(&reply);
+            reply.putSubCheckpoint(&out_model_info, "mf_result");
+            mpi.sendCheckpoint(&reply, PROC_MASTER);
+        }
+        model_info.clear();
+    }
+
+    // workers take over all results from the master to select the same best model
+    Checkpoint done_models;
+    if (mpi.isMaster()) {
+        for (model = 0; model < size(); model++)
+            if (at(model).hasFlag(MF_DONE)) {
+                done_models.startStruct(convertInt64ToString(model));
+                done_models.put("subst_name", at(model).subst_name);
+                done_models.put("rate_name", at(model).rate_name);
+                done_models.endStruct();
+            }
     }
+    mpi.broadcastCheckpoint(&model_info);
+    mpi.broadcastCheckpoint(&done_models);
+    if (mpi.isWorker()) {
+        for (model = 0; model < size(); model++) {
+            done_models.startStruct(convertInt64ToString(model));
+            if (done_models.getString("subst_name", at(model).subst_name)) {
+                done_models.getString("rate_name", at(model).rate_name);
+                at(model).restoreCheckpoint(&model_info);
+                at(model).computeICScores();
+                at(model).setFlag(MF_DONE);
+            }
+            done_models.endStruct();
+        }
     }
-    if (next_model != current_model) {
-        current_model = next_model;
-        at(next_model).setFlag(MF_RUNNING);
-        return next_model;
-    } else
-        return -1;
+#endif
 }
 
 CandidateModel CandidateModelSet::evaluateAll(Params &params, PhyloTree* in_tree, ModelCheckpoint &model_info,
@@ -2887,8 +3256,6 @@ CandidateModel CandidateModelSet::evaluateAll(Params &params, PhyloTree* in_tree
         cout << " No. Model         -LnL         df  AIC          AICc         BIC" << endl;
     }
 
-    double best_score = DBL_MAX;
-
     // detect rate hetegeneity automatically or not
     bool auto_rate = merge_phase ? iEquals(params.merge_rates, "AUTO") : iEquals(params.ratehet_set, "AUTO");
     bool auto_subst = merge_phase ? iEquals(params.merge_models, "AUTO") : iEquals(params.model_set, "AUTO");
@@ -2907,78 +3274,74 @@ CandidateModel CandidateModelSet::evaluateAll(Params &params, PhyloTree* in_tree
     }
 
     int64_t num_models = size();
-#ifdef _OPENMP
-#pragma omp parallel num_threads(num_threads)
+
+    // short alignments scale poorly inside the likelihood kernel,
+    // thus evaluate several models at a time each with a subset of threads
+    int model_threads = params.num_threads_per_model;
+    if (model_threads <= 0)
+        model_threads = in_tree->aln->getNPattern() / MODEL_PATTERNS_PER_THREAD;
+    model_threads = max(1, min(model_threads, num_threads));
+    int num_groups = max(1, num_threads / model_threads);
+    if (params.model_test_and_tree) {
+        // tree search per model changes params temporarily
+        num_groups = 1;
+        model_threads = num_threads;
+    }
+    // finished models are printed and merged into model_info in the order of the candidate
+    // list, as in test(): a better model's tree is the start tree of the following waves
+    model_results.assign(num_models, NULL);
+    best_score = DBL_MAX;
+    next_commit = 0;
+    rates_filtered = subst_filtered = false;
+
+#ifdef _IQTREE_MPI
+    if (MPIHelper::getInstance().getNumProcesses() > 1) {
+        evaluateMPI(params, model_info, models_block, num_threads, brlen_type,
+                    rate_block, subst_block, write_info);
+    } else
 #endif
     {
-    int64_t model;
-    do {
-        model = getNextModel();
-        if (model == -1)
+    if (write_info && verbose_mode >= VB_MED)
+        cout << "Evaluating " << num_groups << " models at a time with "
+             << model_threads << " threads each" << endl;
+
+    // models are evaluated in waves of up to num_groups, all starting from the same model_info;
+    // after the wave they are merged in candidate order, so the start trees do not depend on
+    // which group finishes first
+    vector<int64_t> wave;
+#ifdef _OPENMP
+    if (model_threads > 1)
+        omp_set_nested(true);
+#endif
+    while (true) {
+        wave.clear();
+        int64_t model;
+        while ((int)wave.size() < num_groups && (model = getNextModel(rate_block, subst_block)) >= 0)
+            wave.push_back(model);
+        if (wave.empty())
             break;
-
-        // optimize model parameters
-        string orig_model_name = at(model).getName();
         // keep separate output model_info to only update model_info if better model found
-        ModelCheckpoint out_model_info;
-        at(model).set_name = at(model).aln->name;
-        string tree_string;
-        
-        // main call to estimate model parameters
-        tree_string = at(model).evaluate(params, model_info, out_model_info,
-                                         models_block, num_threads, brlen_type);
-        at(model).computeICScores();
-        at(model).setFlag(MF_DONE);
-        
-        int lower_model = getLowerKModel(model);
-        if (lower_model >= 0 && at(lower_model).getScore() < at(model).getScore()) {
-            // ignore all +R_k model with higher category
-            for (int higher_model = model; higher_model != -1;
-                higher_model = getHigherKModel(higher_model)) {
-                at(higher_model).setFlag(MF_IGNORED);
-            }
-            
-        }
+        vector<ModelCheckpoint*> out_model_info(wave.size());
 #ifdef _OPENMP
-#pragma omp critical
-        {
+#pragma omp parallel for schedule(static, 1) num_threads(wave.size())
 #endif
-        if (best_score > at(model).getScore()) {
-            best_score = at(model).getScore();
-            if (!tree_string.empty()) {
-                //model_info.put("best_tree_" + criterionName(params.model_test_criterion), tree_string);
-            }
-            // only update model_info with better model
-            model_info.putSubCheckpoint(&out_model_info, "");
-        }
+        for (int i = 0; i < wave.size(); i++) {
+            out_model_info[i] = new ModelCheckpoint;
+            at(wave[i]).set_name = at(wave[i]).aln->name;
+
+            // main call to estimate model parameters
+            int this_threads = model_threads;
+            at(wave[i]).evaluate(params, model_info, *out_model_info[i],
+                                 models_block, this_threads, brlen_type);
+            at(wave[i]).computeICScores();
+        }
+        for (int i = 0; i < wave.size(); i++)
+            finishModel(wave[i], model_info, out_model_info[i], rate_block, subst_block, write_info);
         model_info.dump();
-        if (write_info) {
-            cout.width(3);
-            cout << right << model+1 << "  ";
-            cout.width(13);
-            cout << left << at(model).getName() << " ";
-            
-            cout.precision(3);
-            cout << fixed;
-            cout.width(12);
-            cout << -at(model).logl << " ";
-            cout.width(3);
-            cout << at(model).df << " ";
-            cout.width(12);
-            cout << at(model).AIC_score << " ";
-            cout.width(12);
-            cout << at(model).AICc_score << " " << at(model).BIC_score;
-            cout << endl;
-
-        }
-        if (model >= rate_block)
-            filterRates(model); // auto filter rate models
-        if (model >= subst_block)
-            filterSubst(model); // auto filter substitution model
+    }
 #ifdef _OPENMP
-        }
+    omp_set_nested(false);
 #endif
-    } while (model != -1);
     }
     
     // store the best model
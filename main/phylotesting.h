@@ -23,6 +23,9 @@ const int MF_RUNNING            = 4;
 const int MF_WAITING            = 8;
 const int MF_DONE               = 16;
 
+/** number of patterns per thread below which ModelFinder evaluates more models at a time instead */
+const int MODEL_PATTERNS_PER_THREAD = 1000;
+
 /**
     Candidate model under testing
  */
@@ -149,6 +152,11 @@ public:
         this->flag |= flag;
     }
 
+    /** turn off some flag */
+    void resetFlag(int flag) {
+        this->flag &= ~flag;
+    }
+
     bool hasFlag(int flag) {
         return (this->flag & flag) != 0;
     }
@@ -181,7 +189,7 @@ class CandidateModelSet : public vector<CandidateModel> {
 public:
 
     CandidateModelSet() : vector<CandidateModel>() {
-        current_model = -1;
+        next_commit = 0;
     }
     
     /** get ID of the best model */
@@ -271,20 +279,59 @@ public:
         return -1;
     }
 
-    /** get the next model to evaluate in parallel */
-    int64_t getNextModel();
+    /**
+     get the next model to evaluate in parallel, called by the scheduling thread between waves.
+     Models after rate_block (subst_block) are only started once all models up to it are
+     finished, so that filterRates (filterSubst) prunes the same models as in test()
+     @param rate_block last model of the block filtered by filterRates
+     @param subst_block last model of the block filtered by filterSubst
+     @return ID of the next model, -1 if all models are finished or ignored,
+        -2 if the remaining models must wait for running ones
+     */
+    int64_t getNextModel(int rate_block, int subst_block);
 
     /**
-     evaluate all models in parallel
+     evaluate all models in parallel, several models at a time each with a subset of threads
      */
     CandidateModel evaluateAll(Params &params, PhyloTree* in_tree, ModelCheckpoint &model_info,
                      ModelsBlock *models_block, int num_threads, int brlen_type,
                      string in_model_name = "", bool merge_phase = false, bool write_info = true);
-    
+
 private:
-    
-    /** current model */
-    int64_t current_model;
+
+    /** @return TRUE if all models up to last_model are done or ignored */
+    bool isFinished(int last_model);
+
+    /**
+     record a model evaluated by evaluateAll(), called by the scheduling thread after its wave.
+     Finished models are printed in the order of the candidate list, and a model better
+     than all printed before is merged into model_info, as in test()
+     @param model ID of the finished model
+     @param model_info checkpoint of all models
+     @param out_model_info model parameters estimated for this model, taken over
+     */
+    void finishModel(int64_t model, ModelCheckpoint &model_info, ModelCheckpoint *out_model_info,
+                     int rate_block, int subst_block, bool write_info);
+
+    /**
+     evaluate all models distributed over MPI processes: the master hands out one model
+     at a time to idle workers, which estimate it with all their threads
+     */
+    void evaluateMPI(Params &params, ModelCheckpoint &model_info,
+                     ModelsBlock *models_block, int num_threads, int brlen_type,
+                     int rate_block, int subst_block, bool write_info);
+
+    /** results of finished models not yet printed by finishModel() */
+    vector<ModelCheckpoint*> model_results;
+
+    /** best score of the models printed so far */
+    double best_score;
+
+    /** ID of the next model to print */
+    int64_t next_commit;
+
+    /** TRUE if filterRates() or filterSubst() was already applied */
+    bool rates_filtered, subst_filtered;
 };
 
 //typedef vector<ModelInfo> ModelCheckpoint;
@@ -816,6 +816,11 @@ void performAUTest(Params &params, PhyloTree *tree, double *pattern_lhs, vector<
     
     size_t k, tid, ptn;
     
+    // replicates are processed in blocks that stay in cache while pattern_lhs is
+    // streamed through once per block instead of once per replicate
+    size_t block_size = ((size_t)1 << 22) / (maxnptn*sizeof(double));
+    block_size = max((size_t)1, min(block_size, (size_t)16));
+
     double start_time = getRealTime();
     
     cout << "Generating " << nscales << " x " << nboot << " multiscale bootstrap replicates... ";
@@ -828,57 +833,68 @@ void performAUTest(Params &params, PhyloTree *tree, double *pattern_lhs, vector<
 #else
     int *rstream = randstream;
 #endif
-    size_t boot;
+    size_t boot, b;
     int *boot_sample = aligned_alloc<int>(maxnptn);
     memset(boot_sample, 0, maxnptn*sizeof(int));
     
-    double *boot_sample_dbl = aligned_alloc<double>(maxnptn);
+    double *boot_sample_dbl = aligned_alloc<double>(maxnptn*block_size);
+    double *max_lh = new double[block_size];
+    double *second_max_lh = new double[block_size];
+    size_t *max_tid = new size_t[block_size];
     
 #ifdef _OPENMP
 #pragma omp for schedule(dynamic)
 #endif
     for (int k = 0; k < nscales; ++k) {
         string str = "SCALE=" + convertDoubleToString(r[k]);
-        for (boot = 0; boot < nboot; boot++) {
-            if (r[k] == 1.0 && boot == 0)
-                // 2018-10-23: get one of the bootstrap sample as the original alignment
-                tree->aln->getPatternFreq(boot_sample);
-            else
-                tree->aln->createBootstrapAlignment(boot_sample, str.c_str(), rstream);
-            for (ptn = 0; ptn < maxnptn; ptn++)
-                boot_sample_dbl[ptn] = boot_sample[ptn];
-            double max_lh = -DBL_MAX, second_max_lh = -DBL_MAX;
-            int max_tid = -1;
+        for (boot = 0; boot < nboot; boot += block_size) {
+            size_t nblock = min(block_size, nboot - boot);
+            for (b = 0; b < nblock; b++) {
+                if (r[k] == 1.0 && boot+b == 0)
+                    // 2018-10-23: get one of the bootstrap sample as the original alignment
+                    tree->aln->getPatternFreq(boot_sample);
+                else
+                    tree->aln->createBootstrapAlignment(boot_sample, str.c_str(), rstream);
+                double *this_boot_sample = boot_sample_dbl + b*maxnptn;
+                for (ptn = 0; ptn < maxnptn; ptn++)
+                    this_boot_sample[ptn] = boot_sample[ptn];
+                max_lh[b] = second_max_lh[b] = -DBL_MAX;
+                max_tid[b] = -1;
+            }
             for (tid = 0; tid < ntrees; tid++) {
                 double *pattern_lh = pattern_lhs + (tid*maxnptn);
-                double tree_lh;
-                if (params.SSE == LK_386) {
-                    tree_lh = 0.0;
-                    for (ptn = 0; ptn < nptn; ptn++)
-                        tree_lh += pattern_lh[ptn] * boot_sample_dbl[ptn];
-                } else {
-                    tree_lh = tree->dotProductDoubleCall(pattern_lh, boot_sample_dbl, nptn);
+                for (b = 0; b < nblock; b++) {
+                    double *this_boot_sample = boot_sample_dbl + b*maxnptn;
+                    double tree_lh;
+                    if (params.SSE == LK_386) {
+                        tree_lh = 0.0;
+                        for (ptn = 0; ptn < nptn; ptn++)
+                            tree_lh += pattern_lh[ptn] * this_boot_sample[ptn];
+                    } else {
+                        tree_lh = tree->dotProductDoubleCall(pattern_lh, this_boot_sample, nptn);
+                    }
+                    // rescale lh
+                    tree_lh /= r[k];
+
+                    // find the max and second max
+                    if (tree_lh > max_lh[b]) {
+                        second_max_lh[b] = max_lh[b];
+                        max_lh[b] = tree_lh;
+                        max_tid[b] = tid;
+                    } else if (tree_lh > second_max_lh[b])
+                        second_max_lh[b] = tree_lh;
+
+                    treelhs[(tid*nscales+k)*nboot + boot+b] = tree_lh;
                 }
-                // rescale lh
-                tree_lh /= r[k];
-                
-                // find the max and second max
-                if (tree_lh > max_lh) {
-                    second_max_lh = max_lh;
-                    max_lh = tree_lh;
-                    max_tid = tid;
-                } else if (tree_lh > second_max_lh)
-                    second_max_lh = tree_lh;
-                
-                treelhs[(tid*nscales+k)*nboot + boot] = tree_lh;
             }
             
             // compute difference from max_lh
             for (tid = 0; tid < ntrees; tid++)
-                if (tid != max_tid)
-                    treelhs[(tid*nscales+k)*nboot + boot] = max_lh - treelhs[(tid*nscales+k)*nboot + boot];
-                else
-                    treelhs[(tid*nscales+k)*nboot + boot] = second_max_lh - max_lh;
+                for (b = 0; b < nblock; b++)
+                    if (tid != max_tid[b])
+                        treelhs[(tid*nscales+k)*nboot + boot+b] = max_lh[b] - treelhs[(tid*nscales+k)*nboot + boot+b];
+                    else
+                        treelhs[(tid*nscales+k)*nboot + boot+b] = second_max_lh[b] - max_lh[b];
             //            bp[k*ntrees+max_tid] += nboot_inv;
         } // for boot
         
@@ -889,6 +905,9 @@ void performAUTest(Params &params, PhyloTree *tree, double *pattern_lhs, vector<
         
     } // for scale
     
+    delete [] max_tid;
+    delete [] second_max_lh;
+    delete [] max_lh;
     aligned_free(boot_sample_dbl);
     aligned_free(boot_sample);
     
@@ -1053,6 +1072,65 @@ void performAUTest(Params &params, PhyloTree *tree, double *pattern_lhs, vector<
 }
 
 
+/**
+    read the next tree of a tree set and optimize its branch lengths or the model
+    @param in stream positioned at the tree
+    @param tree tree to read into, the analysis tree or one of its NNI workers
+*/
+void evaluateTree(istream &in, Params &params, IQTree *tree) {
+    tree->freeNode();
+    tree->readTree(in, tree->rooted);
+    if (!tree->findNodeName(tree->aln->getSeqName(0))) {
+        outError("Taxon " + tree->aln->getSeqName(0) + " not found in tree");
+    }
+
+    if (tree->rooted && tree->getModelFactory()->isReversible()) {
+        if (tree->leafNum != tree->aln->getNSeq()+1)
+            outError("Tree does not have same number of taxa as alignment");
+        tree->convertToUnrooted();
+//            cout << "convertToUnrooted" << endl;
+    } else if (!tree->rooted && !tree->getModelFactory()->isReversible()) {
+        if (tree->leafNum != tree->aln->getNSeq())
+            outError("Tree does not have same number of taxa as alignment");
+        tree->convertToRooted();
+//            cout << "convertToRooted" << endl;
+    }
+    tree->setAlignment(tree->aln);
+    tree->setRootNode(params.root);
+    if (tree->isSuperTree())
+        ((PhyloSuperTree*) tree)->mapTrees();
+
+    tree->initializeAllPartialLh();
+    tree->fixNegativeBranch(false);
+    if (params.fixed_branch_length) {
+        tree->setCurScore(tree->computeLikelihood());
+    } else if (params.topotest_optimize_model) {
+        tree->getModelFactory()->optimizeParameters(BRLEN_OPTIMIZE, false, params.modelEps);
+        tree->setCurScore(tree->computeLikelihood());
+    } else {
+        tree->setCurScore(tree->optimizeAllBranches(100, 0.001));
+    }
+}
+
+/**
+    read the text of the next tree of a tree set, parsed like the tree itself so that
+    semicolons in comments or quoted taxon names do not end the tree
+    @param in stream positioned at the tree, afterwards positioned after its semicolon
+    @return the tree in Newick format
+*/
+string readTreeText(istream &in) {
+    streampos start = in.tellg();
+    MTree tree;
+    bool rooted = false;
+    tree.readTree(in, rooted);
+    in.clear();
+    streampos end = in.tellg();
+    in.seekg(start);
+    string tree_str(end - start, ' ');
+    in.read(&tree_str[0], end - start);
+    return tree_str;
+}
+
 void evaluateTrees(istream &in, Params &params, IQTree *tree, vector<TreeInfo> &info, IntVector &distinct_ids)
 {
     cout << endl;
@@ -1101,7 +1179,8 @@ void evaluateTrees(istream &in, Params &params, IQTree *tree, vector<TreeInfo> &
     
     double time_start = getRealTime();
     
-    int *boot_samples = NULL;
+    BootCountType *boot_samples = NULL; // pattern counts of the replicates, one byte per pattern
+    vector<BootCountOverflow> boot_samples_overflow;
     //double *saved_tree_lhs = NULL;
     double *tree_lhs = NULL; // RELL score matrix of size #trees x #replicates
     double *pattern_lh = NULL;
@@ -1113,7 +1192,7 @@ void evaluateTrees(istream &in, Params &params, IQTree *tree, vector<TreeInfo> &
     size_t maxnptn = get_safe_upper_limit(nptn);
     
     if (params.topotest_replicates && ntrees > 1) {
-        size_t mem_size = (size_t)params.topotest_replicates*nptn*sizeof(int) +
+        size_t mem_size = (size_t)params.topotest_replicates*nptn*sizeof(BootCountType) +
         ntrees*params.topotest_replicates*sizeof(double) +
         (nptn + ntrees*3 + params.topotest_replicates*2)*sizeof(double) +
         ntrees*sizeof(TreeInfo) +
@@ -1122,22 +1201,29 @@ void evaluateTrees(istream &in, Params &params, IQTree *tree, vector<TreeInfo> &
         if (mem_size > getMemorySize()-100000)
             outWarning("The required memory does not fit in RAM!");
         cout << "Creating " << params.topotest_replicates << " bootstrap replicates..." << endl;
-        if (!(boot_samples = new int [params.topotest_replicates*nptn]))
+        if (!(boot_samples = new BootCountType [params.topotest_replicates*nptn]))
             outError(ERR_NO_MEMORY);
+        boot_samples_overflow.resize(params.topotest_replicates);
 #ifdef _OPENMP
 #pragma omp parallel if(nptn > 10000)
         {
         int *rstream;
         init_random(params.ran_seed + omp_get_thread_num(), false, &rstream);
-#pragma omp for schedule(static)
 #else
         int *rstream = randstream;
 #endif
-        for (size_t boot = 0; boot < params.topotest_replicates; boot++)
+        int *boot_sample = new int[nptn];
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+        for (size_t boot = 0; boot < params.topotest_replicates; boot++) {
             if (boot == 0)
-                tree->aln->getPatternFreq(boot_samples + (boot*nptn));
+                tree->aln->getPatternFreq(boot_sample);
             else
-                tree->aln->createBootstrapAlignment(boot_samples + (boot*nptn), params.bootstrap_spec, rstream);
+                tree->aln->createBootstrapAlignment(boot_sample, params.bootstrap_spec, rstream);
+            IQTree::setBootSample(boot_sample, nptn, boot_samples + (boot*nptn), boot_samples_overflow[boot]);
+        }
+        delete [] boot_sample;
 #ifdef _OPENMP
         finish_random(rstream);
         }
@@ -1166,92 +1252,131 @@ void evaluateTrees(istream &in, Params &params, IQTree *tree, vector<TreeInfo> &
     info.resize(ntrees);
     string saved_tree;
     saved_tree = tree->getTreeString();
+
+    // with a fixed model, batches of trees are evaluated concurrently on the NNI workers,
+    // copies of the tree that share its model; results are reported in input order
+    int num_workers = 0;
+    if (!params.topotest_optimize_model && ntrees > 1)
+        num_workers = tree->createNNIWorkers(ntrees);
+    for (IQTree *worker : tree->nni_worker_trees) {
+        worker->setModelFactory(tree->getModelFactory());
+        worker->setLikelihoodKernel(tree->sse);
+        worker->setNumThreads(1);
+    }
+    int batch_size = max(num_workers, 1);
+    double *batch_pattern_lh = NULL;
+    if (num_workers > 1 && pattern_lh)
+        batch_pattern_lh = aligned_alloc<double>(batch_size*maxnptn);
+
     //for (MTreeSet::iterator it = trees.begin(); it != trees.end(); it++, tree_index++) {
-    for (tree_index = 0, tid = 0; tree_index < distinct_ids.size(); tree_index++) {
-        
-        cout << "Tree " << tree_index + 1;
-        if (distinct_ids[tree_index] >= 0) {
-            cout << " / identical to tree " << distinct_ids[tree_index]+1 << endl;
-            // ignore tree
-            char ch;
-            do {
-                in >> ch;
-            } while (!in.eof() && ch != ';');
-            continue;
-        }
-        tree->freeNode();
-        tree->readTree(in, tree->rooted);
-        if (!tree->findNodeName(tree->aln->getSeqName(0))) {
-            outError("Taxon " + tree->aln->getSeqName(0) + " not found in tree");
-        }
-        
-        if (tree->rooted && tree->getModelFactory()->isReversible()) {
-            if (tree->leafNum != tree->aln->getNSeq()+1)
-                outError("Tree does not have same number of taxa as alignment");
-            tree->convertToUnrooted();
-//            cout << "convertToUnrooted" << endl;
-        } else if (!tree->rooted && !tree->getModelFactory()->isReversible()) {
-            if (tree->leafNum != tree->aln->getNSeq())
-                outError("Tree does not have same number of taxa as alignment");
-            tree->convertToRooted();
-//            cout << "convertToRooted" << endl;
-        }
-        tree->setAlignment(tree->aln);
-        tree->setRootNode(params.root);
-        if (tree->isSuperTree())
-            ((PhyloSuperTree*) tree)->mapTrees();
-        
-        tree->initializeAllPartialLh();
-        tree->fixNegativeBranch(false);
-        if (params.fixed_branch_length) {
-            tree->setCurScore(tree->computeLikelihood());
-        } else if (params.topotest_optimize_model) {
-            tree->getModelFactory()->optimizeParameters(BRLEN_OPTIMIZE, false, params.modelEps);
-            tree->setCurScore(tree->computeLikelihood());
-        } else {
-            tree->setCurScore(tree->optimizeAllBranches(100, 0.001));
-        }
-        treeout << "[ tree " << tree_index+1 << " lh=" << tree->getCurScore() << " ]";
-        tree->printTree(treeout);
-        treeout << endl;
-        if (params.print_tree_lh)
-            scoreout << tree->getCurScore() << endl;
-        
-        cout << " / LogL: " << tree->getCurScore() << endl;
-        
-        if (pattern_lh) {
-            double curScore = tree->getCurScore();
-            memset(pattern_lh, 0, maxnptn*sizeof(double));
-            tree->computePatternLikelihood(pattern_lh, &curScore);
-            if (params.do_weighted_test || params.do_au_test)
-                memcpy(pattern_lhs + tid*maxnptn, pattern_lh, maxnptn*sizeof(double));
-        }
-        if (params.print_site_lh) {
-            string tree_name = "Tree" + convertIntToString(tree_index+1);
-            printSiteLh(site_lh_file.c_str(), tree, pattern_lh, true, tree_name.c_str());
+    for (tree_index = 0, tid = 0; tree_index < distinct_ids.size(); ) {
+        // indices of the next batch_size distinct trees and the trees identical to earlier ones in between
+        int batch_start = tree_index;
+        vector<string> batch_trees;
+        for (; tree_index < distinct_ids.size() && batch_trees.size() < batch_size; tree_index++) {
+            if (distinct_ids[tree_index] >= 0) {
+                // ignore tree
+                readTreeText(in);
+                continue;
+            }
+            if (num_workers <= 1) {
+                batch_trees.push_back("");
+                continue;
+            }
+            batch_trees.push_back(readTreeText(in));
         }
-        if (params.print_partition_lh) {
-            string tree_name = "Tree" + convertIntToString(tree_index+1);
-            printPartitionLh(part_lh_file.c_str(), tree, pattern_lh, true, tree_name.c_str());
+
+        if (num_workers > 1) {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1) num_threads(batch_trees.size())
+#endif
+            for (int i = 0; i < batch_trees.size(); i++) {
+                IQTree *worker = tree->nni_worker_trees[i];
+                stringstream tree_in(batch_trees[i]);
+                evaluateTree(tree_in, params, worker);
+                if (batch_pattern_lh) {
+                    double curScore = worker->getCurScore();
+                    double *worker_pattern_lh = batch_pattern_lh + i*maxnptn;
+                    memset(worker_pattern_lh, 0, maxnptn*sizeof(double));
+                    worker->computePatternLikelihood(worker_pattern_lh, &curScore);
+                }
+            }
         }
-        info[tid].logl = tree->getCurScore();
-        
-        if (!params.topotest_replicates || ntrees <= 1) {
+
+        for (int index = batch_start, i = 0; index < tree_index; index++) {
+            cout << "Tree " << index + 1;
+            if (distinct_ids[index] >= 0) {
+                cout << " / identical to tree " << distinct_ids[index]+1 << endl;
+                continue;
+            }
+            IQTree *eval_tree = tree;
+            if (num_workers > 1)
+                eval_tree = tree->nni_worker_trees[i];
+            else
+                evaluateTree(in, params, tree);
+
+            treeout << "[ tree " << index+1 << " lh=" << eval_tree->getCurScore() << " ]";
+            eval_tree->printTree(treeout);
+            treeout << endl;
+            if (params.print_tree_lh)
+                scoreout << eval_tree->getCurScore() << endl;
+
+            cout << " / LogL: " << eval_tree->getCurScore() << endl;
+
+            if (pattern_lh) {
+                if (num_workers > 1) {
+                    memcpy(pattern_lh, batch_pattern_lh + i*maxnptn, maxnptn*sizeof(double));
+                } else {
+                    double curScore = tree->getCurScore();
+                    memset(pattern_lh, 0, maxnptn*sizeof(double));
+                    tree->computePatternLikelihood(pattern_lh, &curScore);
+                }
+                if (params.do_weighted_test || params.do_au_test)
+                    memcpy(pattern_lhs + tid*maxnptn, pattern_lh, maxnptn*sizeof(double));
+            }
+            if (params.print_site_lh) {
+                string tree_name = "Tree" + convertIntToString(index+1);
+                printSiteLh(site_lh_file.c_str(), eval_tree, pattern_lh, true, tree_name.c_str());
+            }
+            if (params.print_partition_lh) {
+                string tree_name = "Tree" + convertIntToString(index+1);
+                printPartitionLh(part_lh_file.c_str(), eval_tree, pattern_lh, true, tree_name.c_str());
+            }
+            info[tid].logl = eval_tree->getCurScore();
+            i++;
+
+            if (!params.topotest_replicates || ntrees <= 1) {
+                tid++;
+                continue;
+            }
+            // now compute RELL scores, replicates are independent
+            orig_tree_lh[tid] = eval_tree->getCurScore();
+            double *tree_lhs_offset = tree_lhs + (tid*params.topotest_replicates);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) if(nptn*params.topotest_replicates > 1000000)
+#endif
+            for (size_t boot = 0; boot < params.topotest_replicates; boot++) {
+                double lh = 0.0;
+                BootCountType *this_boot_sample = boot_samples + (boot*nptn);
+                // overflow entries come in the same pattern order
+                BootCountOverflow::iterator overflow = boot_samples_overflow[boot].begin();
+                for (size_t ptn = 0; ptn < nptn; ptn++) {
+                    int count = this_boot_sample[ptn];
+                    if (count == BOOT_COUNT_MAX) {
+                        count = overflow->second;
+                        overflow++;
+                    }
+                    lh += pattern_lh[ptn] * count;
+                }
+                tree_lhs_offset[boot] = lh;
+            }
             tid++;
-            continue;
         }
-        // now compute RELL scores
-        orig_tree_lh[tid] = tree->getCurScore();
-        double *tree_lhs_offset = tree_lhs + (tid*params.topotest_replicates);
-        for (size_t boot = 0; boot < params.topotest_replicates; boot++) {
-            double lh = 0.0;
-            int *this_boot_sample = boot_samples + (boot*nptn);
-            for (size_t ptn = 0; ptn < nptn; ptn++)
-                lh += pattern_lh[ptn] * this_boot_sample[ptn];
-            tree_lhs_offset[boot] = lh;
-        }
-        tid++;
     }
+    aligned_free(batch_pattern_lh);
+    // the workers no longer have the topology of the tree
+    if (num_workers > 1)
+        tree->deleteNNIWorkers();
     
     ASSERT(tid == ntrees);
     
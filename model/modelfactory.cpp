@@ -132,6 +132,9 @@ ModelFactory::ModelFactory() : CheckpointFactory() {
     site_rate = NULL;
     store_trans_matrix = false;
     is_storing = false;
+    trans_cache_size = 0;
+    trans_cache_model = NULL;
+    grad_workers_failed = false;
     joint_optimize = false;
     fused_mix_rate = false;
     ASC_type = ASC_NONE;
@@ -151,6 +154,9 @@ size_t findCloseBracket(string &str, size_t start_pos) {
 ModelFactory::ModelFactory(Params &params, string &model_name, PhyloTree *tree, ModelsBlock *models_block) : CheckpointFactory() {
     store_trans_matrix = params.store_trans_matrix;
     is_storing = false;
+    trans_cache_model = NULL;
+    grad_workers_failed = false;
+    trans_cache_size = params.trans_cache_size;
     joint_optimize = params.optimize_model_rate_joint;
     fused_mix_rate = false;
     ASC_type = ASC_NONE;
@@ -1068,9 +1074,21 @@ double ModelFactory::optimizeParametersOnly(int num_steps, double gradient_epsil
         for (int step = 0; step < steps; step++) {
             double model_lh = 0.0;
             // only optimized if model is not linked
+            if (!grad_worker_trees.empty()) {
+                syncGradientWorkers(site_rate->getTree());
+                for (PhyloTree *worker : grad_worker_trees)
+                    model->gradient_workers.push_back(worker->getModel());
+            }
             model_lh = model->optimizeParameters(gradient_epsilon);
+            model->gradient_workers.clear();
 
+            if (!grad_worker_trees.empty()) {
+                syncGradientWorkers(site_rate->getTree());
+                for (PhyloTree *worker : grad_worker_trees)
+                    site_rate->gradient_workers.push_back(worker->getRate());
+            }
             double rate_lh = site_rate->optimizeParameters(gradient_epsilon);
+            site_rate->gradient_workers.clear();
 
             if (rate_lh == 0.0)
                 logl = model_lh;
@@ -1385,6 +1403,13 @@ double ModelFactory::optimizeParameters(int fixed_len, bool write_info,
         // cout << "tree->params->num_param_iterations has increased to " << tree->params->num_param_iterations << endl;
     }
 
+    if (!joint_optimize) {
+        if (grad_worker_trees.empty())
+            createGradientWorkers(tree);
+        else
+            updateGradientWorkerTopology(tree);
+    }
+
     for (i = 2; i < tree->params->num_param_iterations; i++) {
         double new_lh;
 
@@ -1492,17 +1517,21 @@ bool ModelFactory::isUnstableParameters() {
 
 void ModelFactory::startStoringTransMatrix() {
     if (!store_trans_matrix) return;
+    int mat_size = model->num_states * model->num_states;
+    if (!trans_cache.isInitialized(mat_size))
+        trans_cache.init(mat_size, trans_cache_size);
+    else if (model != trans_cache_model)
+        trans_cache.clear();
+    trans_cache_model = model;
     is_storing = true;
 }
 
 void ModelFactory::stopStoringTransMatrix() {
     if (!store_trans_matrix) return;
     is_storing = false;
-    if (!empty()) {
-        for (iterator it = begin(); it != end(); it++)
-            delete it->second;
-        clear();
-    }
+    if (verbose_mode >= VB_MED)
+        trans_cache.report(cout);
+    trans_cache.clear();
 }
 
 
@@ -1515,54 +1544,119 @@ double ModelFactory::computeTrans(double time, int state1, int state2, double &d
 }
 
 void ModelFactory::computeTransMatrix(double time, double *trans_matrix, int mixture, int selected_row) {
-    if (!store_trans_matrix || !is_storing || model->isSiteSpecificModel()) {
+    if (!store_trans_matrix || !is_storing || model != trans_cache_model || model->isSiteSpecificModel() || selected_row >= 0) {
         model->computeTransMatrix(time, trans_matrix, mixture, selected_row);
         return;
     }
-    int mat_size = model->num_states * model->num_states;
-    iterator ass_it = find(round(time * 1e6));
-    if (ass_it == end()) {
-        // allocate memory for 3 matricies
-        double *trans_entry = new double[mat_size * 3];
-        trans_entry[mat_size] = trans_entry[mat_size+1] = 0.0;
-        model->computeTransMatrix(time, trans_entry, mixture, selected_row);
-        ass_it = insert(value_type(round(time * 1e6), trans_entry)).first;
-    } else {
-        //if (verbose_mode >= VB_MAX)
-            //cout << "ModelFactory bingo" << endl;
-    }
-
-    memcpy(trans_matrix, ass_it->second, mat_size * sizeof(double));
+    int64_t version = model->getEigenVersion();
+    if (trans_cache.get(version, mixture, time, trans_matrix))
+        return;
+    model->computeTransMatrix(time, trans_matrix, mixture, selected_row);
+    trans_cache.put(version, mixture, time, trans_matrix);
 }
 
 void ModelFactory::computeTransDerv(double time, double *trans_matrix,
     double *trans_derv1, double *trans_derv2, int mixture) {
-    if (!store_trans_matrix || !is_storing || model->isSiteSpecificModel()) {
+    if (!store_trans_matrix || !is_storing || model != trans_cache_model || model->isSiteSpecificModel()) {
         model->computeTransDerv(time, trans_matrix, trans_derv1, trans_derv2, mixture);
         return;
     }
-    int mat_size = model->num_states * model->num_states;
-    iterator ass_it = find(round(time * 1e6));
-    if (ass_it == end()) {
-        // allocate memory for 3 matricies
-        double *trans_entry = new double[mat_size * 3];
-        trans_entry[mat_size] = trans_entry[mat_size+1] = 0.0;
-        model->computeTransDerv(time, trans_entry, trans_entry+mat_size, trans_entry+(mat_size*2), mixture);
-        ass_it = insert(value_type(round(time * 1e6), trans_entry)).first;
-    } else if (ass_it->second[mat_size] == 0.0 && ass_it->second[mat_size+1] == 0.0) {
-        double *trans_entry = ass_it->second;
-        model->computeTransDerv(time, trans_entry, trans_entry+mat_size, trans_entry+(mat_size*2), mixture);
+    int64_t version = model->getEigenVersion();
+    if (trans_cache.get(version, mixture, time, trans_matrix, trans_derv1, trans_derv2))
+        return;
+    model->computeTransDerv(time, trans_matrix, trans_derv1, trans_derv2, mixture);
+    trans_cache.put(version, mixture, time, trans_matrix, trans_derv1, trans_derv2);
+}
+
+bool ModelFactory::createGradientWorkers(PhyloTree *tree) {
+    int num_workers = min(tree->params->num_grad_workers, tree->num_threads);
+    if (num_workers < 2 || grad_workers_failed || model->isMixture() || model->isSiteSpecificModel() || fused_mix_rate ||
+        !unobserved_ptns.empty() || tree->isMixlen() || model->getNDim() + site_rate->getNDim() < 2)
+        return false;
+#ifdef _OPENMP
+    if (omp_in_parallel())
+        return false;
+#else
+    return false;
+#endif
+    string model_name = tree->getModelName();
+    ModelsBlock *models_block = readModelsDefinition(*tree->params);
+    bool ok = true;
+    for (int i = 0; i < num_workers && ok; i++) {
+        PhyloTree *worker = new PhyloTree;
+        worker->copyPhyloTree(tree, true);
+        worker->optimize_by_newton = tree->optimize_by_newton;
+        worker->setParams(tree->params);
+        grad_worker_trees.push_back(worker);
+        try {
+            ModelFactory *model_fac = new ModelFactory(*tree->params, model_name, worker, models_block);
+            worker->setModelFactory(model_fac);
+            worker->setModel(model_fac->model);
+            worker->setRate(model_fac->site_rate);
+            // parameters fixed by the user are not part of the model name
+            ok = model_fac->model->getNDim() == model->getNDim() &&
+                model_fac->site_rate->getNDim() == site_rate->getNDim();
+        } catch (string &str) {
+            ok = false;
+        }
+        if (!ok)
+            break;
+        worker->setLikelihoodKernel(tree->sse);
+        worker->setNumThreads(1);
+        worker->initializeAllPartialLh();
     }
-    memcpy(trans_matrix, ass_it->second, mat_size * sizeof(double));
-    memcpy(trans_derv1, ass_it->second + mat_size, mat_size * sizeof(double));
-    memcpy(trans_derv2, ass_it->second + (mat_size*2), mat_size * sizeof(double));
+    delete models_block;
+    if (!ok) {
+        if (verbose_mode >= VB_MED)
+            cout << "Gradient workers not supported for model " << model_name << endl;
+        deleteGradientWorkers();
+        grad_workers_failed = true;
+        return false;
+    }
+    if (verbose_mode >= VB_MED)
+        cout << "Using " << num_workers << " gradient workers" << endl;
+    return true;
+}
+
+void ModelFactory::updateGradientWorkerTopology(PhyloTree *tree) {
+    for (PhyloTree *worker : grad_worker_trees) {
+        worker->copyPhyloTree(tree, true);
+        // the partial likelihood buffers of the worker are kept
+        worker->initializeAllPartialLh();
+    }
+}
+
+void ModelFactory::syncGradientWorkers(PhyloTree *tree) {
+    if (grad_worker_trees.empty())
+        return;
+    DoubleVector lenvec;
+    tree->saveBranchLengths(lenvec);
+    // the workers were built from the same model name, thus have the same variables
+    int ndim = getNDim();
+    double *variables = new double[ndim+1];
+    setVariables(variables);
+    for (PhyloTree *worker : grad_worker_trees) {
+        ModelFactory *model_fac = worker->getModelFactory();
+        worker->restoreBranchLengths(lenvec);
+        model_fac->getVariables(variables);
+        // the variables leave out the last state frequency
+        memcpy(model_fac->model->state_freq, model->state_freq, sizeof(double)*model->num_states);
+        model_fac->model->decomposeRateMatrix();
+        worker->clearAllPartialLH();
+        worker->computePtnInvar();
+    }
+    delete [] variables;
+}
+
+void ModelFactory::deleteGradientWorkers() {
+    for (PhyloTree *worker : grad_worker_trees)
+        delete worker;
+    grad_worker_trees.clear();
 }
 
 ModelFactory::~ModelFactory()
 {
-    for (iterator it = begin(); it != end(); it++)
-        delete it->second;
-    clear();
+    deleteGradientWorkers();
 }
 
 /************* FOLLOWING SERVE FOR JOINT OPTIMIZATION OF MODEL AND RATE PARAMETERS *******/
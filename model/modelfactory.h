@@ -26,6 +26,7 @@
 #include "nclextra/modelsblock.h"
 #include "utils/checkpoint.h"
 #include "alignment/alignment.h"
+#include "transmatrixcache.h"
 
 const double MIN_BRLEN_SCALE = 0.01;
 const double MAX_BRLEN_SCALE = 100.0;
@@ -54,13 +55,14 @@ string::size_type posRateFree(string &model_name);
 string::size_type posPOMO(string &model_name);
 
 /**
-Store the transition matrix corresponding to evolutionary time so that one must not compute again. 
+Create the substitution model and site-rate heterogeneity from the model name.
+With -mstore it also keeps transition matrices corresponding to evolutionary time
+in a bounded cache so that one must not compute again.
 For efficiency purpose esp. for protein (20x20) or codon (61x61).
-The values of the map contain 3 matricies consecutively: transition matrix, 1st, and 2nd derivative
 
 	@author BUI Quang Minh <minh.bui@univie.ac.at>
 */
-class ModelFactory : public unordered_map<int, double*>, public Optimization, public CheckpointFactory
+class ModelFactory : public Optimization, public CheckpointFactory
 {
 public:
 
@@ -228,6 +230,21 @@ public:
 		TRUE for storing process
 	*/
 	bool is_storing;
+
+	/**
+		cache of transition matrices and derivatives, used if store_trans_matrix is TRUE
+	*/
+	TransMatrixCache trans_cache;
+
+	/**
+		model whose matrices trans_cache holds, versions of different models are not comparable
+	*/
+	ModelSubst *trans_cache_model;
+
+	/**
+		memory cap of trans_cache in bytes
+	*/
+	int64_t trans_cache_size;
     
     /**
         TRUE for continuous Gamma
@@ -253,6 +270,42 @@ public:
 	 */
 	double optimizeParametersOnly(int num_steps, double gradient_epsilon, double cur_logl);
 
+	/**
+		trees with their own copy of model and site_rate, used to evaluate
+		finite-difference gradients concurrently (--grad-workers)
+	*/
+	vector<PhyloTree*> grad_worker_trees;
+
+	/**
+		create up to params->num_grad_workers copies of tree, model and site_rate,
+		one per thread of the tree, once per analysis. Nothing is created for models whose copies
+		cannot be rebuilt from the model name, e.g. mixtures or user-fixed parameters.
+		@param tree the tree of this model
+		@return TRUE if workers were created
+	*/
+	bool createGradientWorkers(PhyloTree *tree);
+
+	/** TRUE if the model cannot be copied into gradient workers */
+	bool grad_workers_failed;
+
+	/**
+		copy the current topology of tree into the gradient workers, which are kept
+		from one call of optimizeParameters() to the next
+		@param tree the tree of this model
+	*/
+	void updateGradientWorkerTopology(PhyloTree *tree);
+
+	/**
+		copy branch lengths, model and rate parameters of tree into the gradient workers
+		@param tree the tree of this model
+	*/
+	void syncGradientWorkers(PhyloTree *tree);
+
+	/**
+		delete the gradient workers
+	*/
+	void deleteGradientWorkers();
+
 	/************* FOLLOWING FUNCTIONS SERVE FOR JOINT OPTIMIZATION OF MODEL AND RATE PARAMETERS *******/
 
 	/**
@@ -607,6 +607,11 @@ double ModelGTR::optimizeParameters(double gradient_epsilon) {
 void ModelGTR::decomposeRateMatrix(){
 	int i, j, k = 0;
 
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+    eigen_version++;
+
 	if (num_params == -1) {
 		// manual compute eigenvalues/vectors for F81-style model
 		eigenvalues[0] = 0.0;
@@ -1187,6 +1187,16 @@ double ModelMarkov::optimizeParameters(double gradient_epsilon) {
             highest_freq_state = i;
         }
     }
+    // workers must map variables to parameters in the same way
+    for (Optimization *worker : gradient_workers) {
+        ModelMarkov *worker_model = dynamic_cast<ModelMarkov*>(worker);
+        if (!worker_model) {
+            // fall back to sequential finite differences
+            gradient_workers.clear();
+            break;
+        }
+        worker_model->highest_freq_state = highest_freq_state;
+    }
 
 	// by BFGS algorithm
 	setVariables(variables);
@@ -1386,6 +1396,11 @@ void ModelMarkov::decomposeRateMatrixNonrev() {
 void ModelMarkov::decomposeRateMatrix(){
 	int i, j, k = 0;
 
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+    eigen_version++;
+
     if (!is_reversible) {
         decomposeRateMatrixNonrev();
         return;
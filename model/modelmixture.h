@@ -98,6 +98,16 @@ public:
 	 */
 	virtual int getNMixtures() {return size(); }
 
+    /**
+        @return version of the eigen decomposition, changes whenever a component is decomposed again
+    */
+    virtual int64_t getEigenVersion() {
+        int64_t version = ModelMarkov::getEigenVersion();
+        for (iterator it = begin(); it != end(); it++)
+            version += (*it)->getEigenVersion();
+        return version;
+    }
+
  	/**
 	 * @param cat mixture class
 	 * @return weight of a mixture model component
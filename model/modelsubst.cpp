@@ -22,6 +22,7 @@ ModelSubst::ModelSubst(int nstates) : Optimization(), CheckpointFactory()
 		state_freq[i] = 1.0 / num_states;
 	freq_type = FREQ_EQUAL;
     fixed_parameters = false;
+    eigen_version = 0;
 //    linked_model = NULL;
 }
 
@@ -432,6 +432,24 @@ public:
     /** true to fix parameters, otherwise false */
     bool fixed_parameters;
 
+    /**
+        incremented by every eigen decomposition of this model,
+        cached transition matrices computed with an older version are never returned
+    */
+    int64_t eigen_version;
+
+    /**
+        @return version of the eigen decomposition, changes whenever this model is decomposed again
+    */
+    virtual int64_t getEigenVersion() {
+        int64_t version;
+#ifdef _OPENMP
+#pragma omp atomic read
+#endif
+        version = eigen_version;
+        return version;
+    }
+
 	/**
 	 state frequencies
 	 */
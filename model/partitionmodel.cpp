@@ -248,16 +248,18 @@ int PartitionModel::getNParameters(int brlen_type) {
 double PartitionModel::computeFunction(double shape) {
     PhyloSuperTree *tree = (PhyloSuperTree*)site_rate->getTree();
     double res = 0.0;
-    int ntrees = tree->size();
     linked_alpha = shape;
-    if (tree->part_order.empty()) tree->computePartitionOrder();
+    for (int phase = 0; phase < 2; phase++) {
+        int first, last;
+        tree->getScheduleRange(phase, first, last);
 #ifdef _OPENMP
-#pragma omp parallel for reduction(+: res) schedule(dynamic) if(tree->num_threads > 1)
+#pragma omp parallel for reduction(+: res) schedule(dynamic) if(phase == 1 && tree->num_threads > 1)
 #endif
-    for (int j = 0; j < ntrees; j++) {
-        int i = tree->part_order[j];
-        if (tree->at(i)->getRate()->isGammaRate())
-            res += tree->at(i)->getRate()->computeFunction(shape);
+        for (int j = first; j < last; j++) {
+            int i = tree->part_sched[j];
+            if (tree->at(i)->getRate()->isGammaRate())
+                res += tree->at(i)->getRate()->computeFunction(shape);
+        }
     }
     if (res == 0.0) {
         outError("No partition has Gamma rate heterogeneity!");
@@ -290,19 +292,21 @@ double PartitionModel::targetFunk(double x[]) {
     PhyloSuperTree *tree = (PhyloSuperTree*)site_rate->getTree();
     
     double res = 0;
-    int ntrees = tree->size();
-    if (tree->part_order.empty()) tree->computePartitionOrder();
+    for (int phase = 0; phase < 2; phase++) {
+        int first, last;
+        tree->getScheduleRange(phase, first, last);
 #ifdef _OPENMP
-#pragma omp parallel for reduction(+: res) schedule(dynamic) if(tree->num_threads > 1)
+#pragma omp parallel for reduction(+: res) schedule(dynamic) if(phase == 1 && tree->num_threads > 1)
 #endif
-    for (int j = 0; j < ntrees; j++) {
-        int i = tree->part_order[j];
-        ModelSubst *part_model = tree->at(i)->getModel();
-        if (part_model->getName() != model->getName())
-            continue;
-        bool fixed = part_model->fixParameters(false);
-        res += part_model->targetFunk(x);
-        part_model->fixParameters(fixed);
+        for (int j = first; j < last; j++) {
+            int i = tree->part_sched[j];
+            ModelSubst *part_model = tree->at(i)->getModel();
+            if (part_model->getName() != model->getName())
+                continue;
+            bool fixed = part_model->fixParameters(false);
+            res += part_model->targetFunk(x);
+            part_model->fixParameters(fixed);
+        }
     }
     if (res == 0.0)
         outError("No partition has model ", model->getName());
@@ -464,31 +468,34 @@ double PartitionModel::optimizeParameters(int fixed_len, bool write_info, double
 
     for (int step = 0; step < Params::getInstance().model_opt_steps; step++) {
         tree_lh = 0.0;
-        if (tree->part_order.empty()) tree->computePartitionOrder();
-        #ifdef _OPENMP
-        #pragma omp parallel for reduction(+: tree_lh) schedule(dynamic) if(tree->num_threads > 1)
-        #endif
-        for (int i = 0; i < ntrees; i++) {
-            int part = tree->part_order[i];
-            double score;
-            if (opt_gamma_invar)
-                score = tree->at(part)->getModelFactory()->optimizeParametersGammaInvar(fixed_len,
-                    write_info && verbose_mode >= VB_MED,
-                    logl_epsilon/min(ntrees,10), gradient_epsilon/min(ntrees,10));
-            else
-                score = tree->at(part)->getModelFactory()->optimizeParameters(fixed_len,
-                    write_info && verbose_mode >= VB_MED,
-                    logl_epsilon/min(ntrees,10), gradient_epsilon/min(ntrees,10));
-            tree_lh += score;
-            if (write_info)
+        for (int phase = 0; phase < 2; phase++) {
+            int first, last;
+            tree->getScheduleRange(phase, first, last);
+            #ifdef _OPENMP
+            #pragma omp parallel for reduction(+: tree_lh) schedule(dynamic) if(phase == 1 && tree->num_threads > 1)
+            #endif
+            for (int i = first; i < last; i++) {
+                int part = tree->part_sched[i];
+                double score;
+                if (opt_gamma_invar)
+                    score = tree->at(part)->getModelFactory()->optimizeParametersGammaInvar(fixed_len,
+                        write_info && verbose_mode >= VB_MED,
+                        logl_epsilon/min(ntrees,10), gradient_epsilon/min(ntrees,10));
+                else
+                    score = tree->at(part)->getModelFactory()->optimizeParameters(fixed_len,
+                        write_info && verbose_mode >= VB_MED,
+                        logl_epsilon/min(ntrees,10), gradient_epsilon/min(ntrees,10));
+                tree_lh += score;
+                if (write_info)
 #ifdef _OPENMP
 #pragma omp critical
 #endif
-            {
-                cout << "Partition " << tree->at(part)->aln->name
-                     << " / Model: " << tree->at(part)->getModelName()
-                     << " / df: " << tree->at(part)->getModelFactory()->getNParameters(fixed_len)
-                << " / LogL: " << score << endl;
+                {
+                    cout << "Partition " << tree->at(part)->aln->name
+                         << " / Model: " << tree->at(part)->getModelName()
+                         << " / df: " << tree->at(part)->getModelFactory()->getNParameters(fixed_len)
+                    << " / LogL: " << score << endl;
+                }
             }
         }
         //return ModelFactory::optimizeParameters(fixed_len, write_info);
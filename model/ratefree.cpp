@@ -242,6 +242,47 @@ double RateFree::targetFunk(double x[]) {
 	return -phylo_tree->computeLikelihood();
 }
 
+bool RateFree::hasAnalyticGradient() {
+    ModelFactory *model_fac = phylo_tree->getModelFactory();
+    return optimizing_params == 2 && getNDim() == ncategory-1 && !model_fac->fused_mix_rate &&
+        model_fac->unobserved_ptns.empty();
+}
+
+double RateFree::derivativeFunk(double x[], double dfx[]) {
+    if (!hasAnalyticGradient())
+        return Optimization::derivativeFunk(x, dfx);
+
+    // the likelihood is linear in the proportions and _pattern_lh_cat holds prop[c]*L[ptn,c], so
+    // dlogL/dprop[c] = sum_ptn freq[ptn] * L[ptn,c] / L[ptn] needs one traversal instead of ndim+1
+    getVariables(x);
+    double fx = -phylo_tree->computePatternLhCat(WSL_RATECAT);
+    size_t ptn, nptn = phylo_tree->aln->getNPattern();
+    int c;
+    double *grad = new double[ncategory];
+    memset(grad, 0, sizeof(double)*ncategory);
+    for (ptn = 0; ptn < nptn; ptn++) {
+        double *this_lk_cat = phylo_tree->_pattern_lh_cat + ptn*ncategory;
+        double lk_ptn = phylo_tree->ptn_invar[ptn];
+        for (c = 0; c < ncategory; c++)
+            lk_ptn += this_lk_cat[c];
+        lk_ptn = phylo_tree->ptn_freq[ptn] / lk_ptn;
+        for (c = 0; c < ncategory; c++)
+            grad[c] += this_lk_cat[c] * lk_ptn;
+    }
+    double mean_grad = 0.0;
+    for (c = 0; c < ncategory; c++) {
+        grad[c] /= prop[c];
+        mean_grad += prop[c] * grad[c];
+    }
+    // chain rule for prop[c] = x[c+1]/sum (c < ncategory-1), prop[ncategory-1] = 1/sum, sum = 1 + x[1] + ...
+    double sum = 1.0 / prop[ncategory-1];
+    for (c = 0; c < ncategory-1; c++)
+        dfx[c+1] = -(grad[c] - mean_grad) / sum;
+    delete [] grad;
+
+    return fx;
+}
+
 /**
 	optimize parameters. Default is to optimize gamma shape
 	@return the best likelihood
@@ -289,6 +330,23 @@ double RateFree::optimizeParameters(double gradient_epsilon) {
         setVariables(variables);
         setBounds(lower_bound, upper_bound, bound_check);
 
+        // workers take over the parameters changed in the previous round
+        for (Optimization *worker : gradient_workers) {
+            RateFree *worker_rate = dynamic_cast<RateFree*>(worker);
+            if (!worker_rate) {
+                // fall back to sequential finite differences
+                gradient_workers.clear();
+                break;
+            }
+            worker_rate->optimizing_params = optimizing_params;
+            memcpy(worker_rate->prop, prop, sizeof(double)*ncategory);
+            memcpy(worker_rate->rates, rates, sizeof(double)*ncategory);
+            worker_rate->phylo_tree->clearAllPartialLH();
+        }
+
+        if (phylo_tree->params->check_gradient && hasAnalyticGradient())
+            cout << "FreeRate proportion gradient: max relative error " << convertDoubleToString(checkDerivativeFunk(variables)) << " to central differences" << endl;
+
 //        if (optimizing_params == 2 && optimize_alg.find("-EM") != string::npos)
 //            score = optimizeWeights();
 //        else 
@@ -68,6 +68,22 @@ public:
 	*/
 	virtual double targetFunk(double x[]);
 
+	/**
+		analytic gradient when only proportions are optimized, otherwise finite differences.
+		Only BFGS needs it: the default -optalg 2-BFGS,EM updates the proportions by EM, so it
+		is used with -optalg 2-BFGS, --robust-phy and --robust-median
+		@param x the input vector x
+		@param dfx the derivative at x
+		@return the function value at x
+	*/
+	virtual double derivativeFunk(double x[], double dfx[]);
+
+	/**
+		@return TRUE if derivativeFunk computes the gradient analytically: only the proportions
+		are optimized, without +I, fused mixture rates or +ASC
+	*/
+	bool hasAnalyticGradient();
+
 	/**
 	 * setup the bounds for joint optimization with BFGS
 	 */
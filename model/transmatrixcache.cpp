@@ -0,0 +1,149 @@
+/*
+ * transmatrixcache.cpp
+ *
+ *  Cache of transition matrices of ModelFactory
+ */
+#include "transmatrixcache.h"
+#include <string.h>
+#include <math.h>
+
+TransMatrixCache::TransMatrixCache() : shards(TRANS_CACHE_SHARDS) {
+    mat_size = 0;
+    max_entries = 0;
+    for (Shard &shard : shards) {
+        shard.hits = shard.misses = shard.evictions = 0;
+#ifdef _OPENMP
+        omp_init_lock(&shard.lock);
+#endif
+    }
+}
+
+TransMatrixCache::~TransMatrixCache() {
+    for (Shard &shard : shards) {
+        clearShard(shard);
+#ifdef _OPENMP
+        omp_destroy_lock(&shard.lock);
+#endif
+    }
+}
+
+void TransMatrixCache::init(int mat_size, int64_t max_bytes) {
+    for (Shard &shard : shards) {
+        clearShard(shard);
+        shard.hits = shard.misses = shard.evictions = 0;
+    }
+    this->mat_size = mat_size;
+    max_entries = max_bytes / (3 * mat_size * sizeof(double)) / TRANS_CACHE_SHARDS;
+    if (max_entries < 1)
+        max_entries = 1;
+}
+
+TransMatrixCache::Key TransMatrixCache::makeKey(int64_t version, int mixture, double time) {
+    Key key;
+    key.version = version;
+    key.time = (int64_t)round(time * 1e6);
+    key.mixture = mixture;
+    return key;
+}
+
+void TransMatrixCache::lock(Shard &shard) {
+#ifdef _OPENMP
+    omp_set_lock(&shard.lock);
+#endif
+}
+
+void TransMatrixCache::unlock(Shard &shard) {
+#ifdef _OPENMP
+    omp_unset_lock(&shard.lock);
+#endif
+}
+
+void TransMatrixCache::clearShard(Shard &shard) {
+    for (Entry &entry : shard.lru)
+        delete [] entry.mat;
+    shard.lru.clear();
+    shard.index.clear();
+}
+
+bool TransMatrixCache::get(int64_t version, int mixture, double time, double *trans_matrix,
+    double *trans_derv1, double *trans_derv2)
+{
+    Key key = makeKey(version, mixture, time);
+    Shard &shard = getShard(key);
+    lock(shard);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end() || (trans_derv1 && !it->second->has_derv)) {
+        shard.misses++;
+        unlock(shard);
+        return false;
+    }
+    // move to front of the LRU list
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    double *mat = it->second->mat;
+    memcpy(trans_matrix, mat, mat_size * sizeof(double));
+    if (trans_derv1) {
+        memcpy(trans_derv1, mat + mat_size, mat_size * sizeof(double));
+        memcpy(trans_derv2, mat + 2*mat_size, mat_size * sizeof(double));
+    }
+    shard.hits++;
+    unlock(shard);
+    return true;
+}
+
+void TransMatrixCache::put(int64_t version, int mixture, double time, double *trans_matrix,
+    double *trans_derv1, double *trans_derv2)
+{
+    Key key = makeKey(version, mixture, time);
+    Shard &shard = getShard(key);
+    lock(shard);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        // another thread inserted it meanwhile, or derivatives are added to an entry
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    } else if (shard.lru.size() >= max_entries) {
+        // recycle the least recently used entry
+        shard.lru.splice(shard.lru.begin(), shard.lru, --shard.lru.end());
+        shard.index.erase(shard.lru.front().key);
+        shard.lru.front().key = key;
+        shard.lru.front().has_derv = false;
+        shard.index[key] = shard.lru.begin();
+        shard.evictions++;
+    } else {
+        Entry entry;
+        entry.key = key;
+        entry.has_derv = false;
+        entry.mat = new double[3 * mat_size];
+        shard.lru.push_front(entry);
+        shard.index[key] = shard.lru.begin();
+    }
+    Entry &entry = shard.lru.front();
+    memcpy(entry.mat, trans_matrix, mat_size * sizeof(double));
+    if (trans_derv1) {
+        memcpy(entry.mat + mat_size, trans_derv1, mat_size * sizeof(double));
+        memcpy(entry.mat + 2*mat_size, trans_derv2, mat_size * sizeof(double));
+        entry.has_derv = true;
+    }
+    unlock(shard);
+}
+
+void TransMatrixCache::clear() {
+    for (Shard &shard : shards) {
+        lock(shard);
+        clearShard(shard);
+        unlock(shard);
+    }
+}
+
+void TransMatrixCache::report(ostream &out) {
+    int64_t hits = 0, misses = 0, evictions = 0, entries = 0;
+    for (Shard &shard : shards) {
+        hits += shard.hits;
+        misses += shard.misses;
+        evictions += shard.evictions;
+        entries += shard.lru.size();
+    }
+    out << "Transition matrix cache: " << hits << " hits, " << misses << " misses";
+    if (hits + misses > 0)
+        out << " (" << (100.0 * hits) / (hits + misses) << "% hit rate)";
+    out << ", " << evictions << " evictions, " << entries << " entries" << endl;
+}
@@ -0,0 +1,136 @@
+/*
+ * transmatrixcache.h
+ *
+ *  Cache of transition matrices of ModelFactory
+ */
+#ifndef TRANSMATRIXCACHE_H
+#define TRANSMATRIXCACHE_H
+
+#include <list>
+#include "utils/tools.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/** number of independently locked shards of TransMatrixCache */
+const int TRANS_CACHE_SHARDS = 16;
+
+/**
+Bounded cache of transition probability matrices and their 1st and 2nd derivatives.
+Entries are keyed by (eigen decomposition version, mixture class, time rounded to 1e-6),
+where the time already includes the rate of the category.
+The cache is split into shards with one lock each so that threads of the likelihood kernel
+can look up different branches concurrently. Each shard evicts its least recently used
+entry once it holds its share of the memory cap.
+*/
+class TransMatrixCache
+{
+public:
+
+    TransMatrixCache();
+
+    ~TransMatrixCache();
+
+    /**
+        (re)initialize the cache, dropping all entries and statistics
+        @param mat_size number of entries of one matrix (num_states * num_states)
+        @param max_bytes memory cap for all entries together
+    */
+    void init(int mat_size, int64_t max_bytes);
+
+    /**
+        @return TRUE if init() was called with this matrix size
+    */
+    bool isInitialized(int mat_size) { return this->mat_size == mat_size; }
+
+    /**
+        look up an entry
+        @param version eigen decomposition version, see ModelSubst::getEigenVersion()
+        @param mixture mixture class
+        @param time branch length times rate
+        @param[out] trans_matrix transition matrix, copied on a hit
+        @param[out] trans_derv1, trans_derv2 (optional) derivatives, copied on a hit.
+            If requested, an entry stored without derivatives is a miss.
+        @return TRUE on hit
+    */
+    bool get(int64_t version, int mixture, double time, double *trans_matrix,
+        double *trans_derv1 = NULL, double *trans_derv2 = NULL);
+
+    /**
+        insert or update an entry, evicting the least recently used entry of the shard if full
+        @param trans_derv1, trans_derv2 (optional) derivatives to store as well
+    */
+    void put(int64_t version, int mixture, double time, double *trans_matrix,
+        double *trans_derv1 = NULL, double *trans_derv2 = NULL);
+
+    /**
+        drop all entries, keeping the statistics
+    */
+    void clear();
+
+    /**
+        print number of hits, misses, evictions and entries
+    */
+    void report(ostream &out);
+
+private:
+
+    struct Key {
+        int64_t version;
+        int64_t time;
+        int mixture;
+        bool operator==(const Key &other) const {
+            return version == other.version && time == other.time && mixture == other.mixture;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key &key) const {
+            uint64_t h = (uint64_t)key.time * 0x9E3779B97F4A7C15ULL;
+            h ^= (uint64_t)key.version + 0x632BE59BD9B4E019ULL + (h << 6) + (h >> 2);
+            h ^= (uint64_t)key.mixture + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+            return h;
+        }
+    };
+
+    struct Entry {
+        Key key;
+        /** TRUE if mat also holds the two derivative matrices */
+        bool has_derv;
+        /** transition matrix followed by 1st and 2nd derivative, 3*mat_size entries */
+        double *mat;
+    };
+
+    struct Shard {
+        /** entries, most recently used first */
+        list<Entry> lru;
+        unordered_map<Key, list<Entry>::iterator, KeyHash> index;
+        int64_t hits, misses, evictions;
+#ifdef _OPENMP
+        omp_lock_t lock;
+#endif
+    };
+
+    Key makeKey(int64_t version, int mixture, double time);
+
+    Shard &getShard(const Key &key) {
+        return shards[KeyHash()(key) % TRANS_CACHE_SHARDS];
+    }
+
+    void lock(Shard &shard);
+
+    void unlock(Shard &shard);
+
+    /** free all entries of a shard */
+    void clearShard(Shard &shard);
+
+    /** number of entries of one matrix */
+    int mat_size;
+
+    /** maximal number of entries per shard */
+    size_t max_entries;
+
+    vector<Shard> shards;
+};
+
+#endif // TRANSMATRIXCACHE_H
@@ -0,0 +1,75 @@
+#!/bin/bash -
+#===============================================================================
+#
+#          FILE: check_float_lh.sh
+#
+#         USAGE: ./check_float_lh.sh <iqtree_binary> [<iqtree_flags_in_quotes>]
+#
+#   DESCRIPTION: Regression check of --float-lh: on a fixed tree, the optimal
+#                log-likelihood with single-precision partial likelihoods must
+#                match the double-precision one within a relative tolerance
+#
+#       OPTIONS: ---
+#  REQUIREMENTS: ---
+#          BUGS: ---
+#         NOTES: ---
+#        AUTHOR: ---
+#  ORGANIZATION:
+#       CREATED: 2026-10-17
+#      REVISION:  ---
+#===============================================================================
+
+set -o nounset                              # Treat unset variables as an error
+
+if [ "$#" -lt 1 ]
+then
+    echo "USAGE: $0 <iqtree_binary> [<iqtree_flags_in_quotes>]" >&2
+    exit 1
+fi
+
+binary=$1
+flags=${2:-}
+dataDir=$(dirname $0)/test_data
+outDir=$(mktemp -d)
+# relative tolerance of the log-likelihood
+tolerance=1e-6
+
+# alignment and model of each case, -safe checks the per-category scaling,
+# GTR the finite-difference gradient of the model parameters
+cases=(
+    "example.phy GTR+R4"
+    "example.phy HKY+G -safe"
+    "d59_8.phy GTR+G"
+    "example.phy GTR+I+G"
+    "prot_M126_27_269.phy LG+G"
+    "prot_M126_27_269.phy WAG+R3 -safe"
+)
+
+log_likelihood() {
+    grep "^BEST SCORE FOUND :" $1.log | tail -1 | awk '{print $5}'
+}
+
+failed=0
+for i in ${!cases[@]}; do
+    set -- ${cases[$i]}
+    aln=$1
+    shift
+    pre=${outDir}/case$i
+    # fixed starting tree without tree search
+    $binary -s ${dataDir}/${aln} -m "$@" -n 0 -seed 1 -pre ${pre}.start -quiet ${flags} || exit 1
+    $binary -s ${dataDir}/${aln} -m "$@" -te ${pre}.start.treefile -pre ${pre}.double -quiet ${flags} || exit 1
+    $binary -s ${dataDir}/${aln} -m "$@" -te ${pre}.start.treefile -pre ${pre}.float -quiet --float-lh ${flags} || exit 1
+    lh_double=$(log_likelihood ${pre}.double)
+    lh_float=$(log_likelihood ${pre}.float)
+    if [ -n "$lh_double" ] && [ -n "$lh_float" ] &&
+        awk -v d=$lh_double -v f=$lh_float -v t=$tolerance 'BEGIN { e = d-f; if (e < 0) e = -e; exit !(e <= -t*d) }'
+    then
+        echo "OK     ${cases[$i]}: double $lh_double float $lh_float"
+    else
+        echo "ERROR  ${cases[$i]}: double $lh_double float $lh_float"
+        failed=1
+    fi
+done
+
+rm -rf ${outDir}
+exit $failed
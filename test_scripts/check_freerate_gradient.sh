@@ -0,0 +1,63 @@
+#!/bin/bash -
+#===============================================================================
+#
+#          FILE: check_freerate_gradient.sh
+#
+#         USAGE: ./check_freerate_gradient.sh <iqtree_binary> [<iqtree_flags_in_quotes>]
+#
+#   DESCRIPTION: Regression check of the analytic gradient of the FreeRate
+#                proportions: with --check-grad, every BFGS optimization of
+#                the proportions compares it with central differences, and
+#                the relative error must stay below a tolerance
+#
+#       OPTIONS: ---
+#  REQUIREMENTS: ---
+#          BUGS: ---
+#         NOTES: ---
+#        AUTHOR: ---
+#  ORGANIZATION:
+#       CREATED: 2026-10-17
+#      REVISION:  ---
+#===============================================================================
+
+set -o nounset                              # Treat unset variables as an error
+
+if [ "$#" -lt 1 ]
+then
+    echo "USAGE: $0 <iqtree_binary> [<iqtree_flags_in_quotes>]" >&2
+    exit 1
+fi
+
+binary=$1
+flags=${2:-}
+dataDir=$(dirname $0)/test_data
+outDir=$(mktemp -d)
+# central differences agree with the analytic gradient to about 1e-5
+tolerance=1e-4
+
+# alignment and model of each case
+cases=(
+    "example.phy HKY+R4"
+    "example.phy GTR+R3"
+    "prot_M126_27_269.phy LG+R4"
+)
+
+failed=0
+for i in ${!cases[@]}; do
+    set -- ${cases[$i]}
+    pre=${outDir}/case$i
+    # -optalg 2-BFGS optimizes the proportions by BFGS instead of EM
+    $binary -s ${dataDir}/$1 -m $2 -optalg 2-BFGS --check-grad -n 0 -seed 1 -pre ${pre} -quiet ${flags} || exit 1
+    max_err=$(grep "^FreeRate proportion gradient: max relative error" ${pre}.log |
+        awk 'BEGIN { m = -1 } { if ($7 > m) m = $7 } END { print m }')
+    if awk -v e=$max_err -v t=$tolerance 'BEGIN { exit !(e >= 0 && e <= t) }'
+    then
+        echo "OK     ${cases[$i]}: max relative error $max_err"
+    else
+        echo "ERROR  ${cases[$i]}: max relative error $max_err"
+        failed=1
+    fi
+done
+
+rm -rf ${outDir}
+exit $failed
@@ -10,6 +10,24 @@
 #include "candidateset.h"
 #include "utils/MPIHelper.h"
 
+/**
+    bit mixer of splitmix64
+*/
+static inline uint64_t mixBits(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+    @return random key of a taxon, \a which = 0 or 1 selects one of two independent keys
+*/
+static inline uint64_t getTaxonKey(Node *leaf, int which) {
+    // the root of a rooted tree is a pseudo taxon, its ID is not a taxon ID after parsing
+    uint64_t id = (leaf->name == ROOT_NAME) ? 0xFFFFFFFFULL : (uint64_t)leaf->id;
+    return mixBits((id * 2 + which + 1) * 0x9E3779B97F4A7C15ULL);
+}
+
 void CandidateSet::init(Alignment *aln, int maxSize) {
     this->aln = aln;
     this->maxSize = maxSize;
@@ -229,7 +247,7 @@ void CandidateSet::initParentTrees() {
 }
 
 
-int CandidateSet::update(string newTree, double newScore) {
+int CandidateSet::update(string newTree, double newScore, MTree *tree) {
     // Do not update candidate set if the new tree has worse score than the
     // worst tree in the candidate set
     auto front = begin();
@@ -238,8 +256,13 @@ int CandidateSet::update(string newTree, double newScore) {
     }
     CandidateTree candidate;
     candidate.score = newScore;
-    candidate.topology = convertTreeString(newTree);
     candidate.tree = newTree;
+    if (tree) {
+        computeSignature(tree, candidate);
+    } else {
+        MTree mtree(newTree, Params::getInstance().is_rooted);
+        computeSignature(&mtree, candidate);
+    }
 
     int treePos;
     CandidateSet::iterator candidateTreeIt;
@@ -249,14 +272,14 @@ int CandidateSet::update(string newTree, double newScore) {
         double oldScore = topologies[candidate.topology];
         if (oldScore < newScore) {
             removeCandidateTree(candidate.topology);
-            insert(CandidateSet::value_type(newScore, candidate));
+            insertCandidate(candidate);
             topologies[candidate.topology] = newScore;
         }
         ASSERT(topologies.size() == size());
         return -1;
     }
 
-    candidateTreeIt = insert(CandidateSet::value_type(newScore, candidate));
+    candidateTreeIt = insertCandidate(candidate);
     topologies[candidate.topology] = newScore;
 
     if (size() > maxSize) {
@@ -269,6 +292,77 @@ int CandidateSet::update(string newTree, double newScore) {
     return treePos;
 }
 
+CandidateSet::iterator CandidateSet::insertCandidate(const CandidateTree &candidate) {
+    for (uint64_t split : candidate.splits)
+        splitCounts[split]++;
+    return insert(CandidateSet::value_type(candidate.score, candidate));
+}
+
+void CandidateSet::eraseCandidate(iterator it) {
+    for (uint64_t split : it->second.splits) {
+        auto count = splitCounts.find(split);
+        ASSERT(count != splitCounts.end());
+        if (--count->second == 0)
+            splitCounts.erase(count);
+    }
+    erase(it);
+}
+
+Node *CandidateSet::findFirstTaxon(MTree *tree) {
+    NodeVector taxa;
+    tree->getTaxa(taxa);
+    for (Node *leaf : taxa)
+        if (leaf->id == 0 && leaf->name != ROOT_NAME)
+            return leaf;
+    ASSERT(0 && "taxon 0 not found");
+    return NULL;
+}
+
+void CandidateSet::computeSignature(MTree *tree, CandidateTree &candidate) {
+    candidate.topology.first = candidate.topology.second = 0;
+    candidate.splits.clear();
+    candidate.splits.reserve(tree->branchNum);
+    uint64_t key1, key2;
+    hashSplits(findFirstTaxon(tree), NULL, key1, key2, candidate, NULL);
+}
+
+void CandidateSet::hashSplits(Node *node, Node *dad, uint64_t &key1, uint64_t &key2, CandidateTree &candidate, Split *taxa) {
+    if (dad && node->isLeaf()) {
+        key1 = getTaxonKey(node, 0);
+        key2 = getTaxonKey(node, 1);
+        if (taxa)
+            taxa->addTaxon((node->name == ROOT_NAME) ? taxa->getNTaxa() - 1 : node->id);
+    } else {
+        key1 = key2 = 0;
+        FOR_NEIGHBOR_IT(node, dad, it) {
+            uint64_t child_key1, child_key2;
+            if (taxa) {
+                Split child_taxa(taxa->getNTaxa());
+                hashSplits((*it)->node, node, child_key1, child_key2, candidate, &child_taxa);
+                *taxa += child_taxa;
+            } else {
+                hashSplits((*it)->node, node, child_key1, child_key2, candidate, NULL);
+            }
+            key1 += child_key1;
+            key2 += child_key2;
+        }
+    }
+    if (!dad)
+        return;
+    // the tree is traversed from taxon 0, so every split is hashed by its side without taxon 0
+    if (taxa) {
+        if (splitTaxa.find(key1) == splitTaxa.end()) {
+            Split &sp = splitTaxa.insert(make_pair(key1, *taxa)).first->second;
+            if (sp.shouldInvert())
+                sp.invert();
+        }
+    } else {
+        candidate.splits.push_back(key1);
+        candidate.topology.first += mixBits(key1);
+        candidate.topology.second += mixBits(key2 ^ 0x632BE59BD9B4E019ULL);
+    }
+}
+
 vector<double> CandidateSet::getBestScores(int numBestScore) {
     if (numBestScore == 0)
         numBestScore = size();
@@ -324,7 +418,7 @@ string CandidateSet::getTopology(string tree) {
     return ostr.str();
 }
 
-double CandidateSet::getTopologyScore(string topology) {
+double CandidateSet::getTopologyScore(const TopologyHash &topology) {
     ASSERT(topologies.find(topology) != topologies.end());
     return topologies[topology];
 }
@@ -332,6 +426,8 @@ double CandidateSet::getTopologyScore(string topology) {
 void CandidateSet::clear() {
     multimap<double, CandidateTree>::clear();
     clearTopologies();
+    // splitTaxa is kept, candSplits may still point to it
+    splitCounts.clear();
 }
 
 void CandidateSet::clearTopologies() {
@@ -364,15 +460,18 @@ void CandidateSet::getAllTrees(vector<string> &trees, vector<double> &scores, in
     }
 }
 
-bool CandidateSet::treeTopologyExist(string topo) {
+bool CandidateSet::treeTopologyExist(const TopologyHash &topo) {
     return (topologies.find(topo) != topologies.end());
 }
 
 bool CandidateSet::treeExist(string tree) {
-    return treeTopologyExist(convertTreeString(tree));
+    MTree mtree(tree, Params::getInstance().is_rooted);
+    CandidateTree candidate;
+    computeSignature(&mtree, candidate);
+    return treeTopologyExist(candidate.topology);
 }
 
-CandidateSet::iterator CandidateSet::getCandidateTree(string topology) {
+CandidateSet::iterator CandidateSet::getCandidateTree(const TopologyHash &topology) {
     for (CandidateSet::reverse_iterator rit = rbegin(); rit != rend(); rit++) {
         if (rit->second.topology == topology)
             return --(rit.base());
@@ -380,7 +479,7 @@ CandidateSet::iterator CandidateSet::getCandidateTree(string topology) {
     return end();
 }
 
-void CandidateSet::removeCandidateTree(string topology) {
+void CandidateSet::removeCandidateTree(const TopologyHash &topology) {
     bool removed = false;
     double treeScore;
     // Find the score of the topology
@@ -393,7 +492,7 @@ void CandidateSet::removeCandidateTree(string topology) {
     CandidateSet::iterator it;
     for (it = treeItPair.first; it != treeItPair.second; ++it) {
         if (it->second.topology == topology) {
-            erase(it);
+            eraseCandidate(it);
             removed = true;
             break;
         }
@@ -404,38 +503,43 @@ void CandidateSet::removeCandidateTree(string topology) {
 
 void CandidateSet::removeWorstTree() {
     topologies.erase(begin()->second.topology);
-    erase(begin());
+    eraseCandidate(begin());
 }
 
 int CandidateSet::computeSplitOccurences(double supportThreshold) {
-    candSplits.clear();
-    candSplits.setNumTree(size());
-
-    /* Store all splits in the best trees in candSplits.
-     * The variable numTree in SpitInMap is the number of trees, from which the splits are converted.
+    /* The occurences of all splits are counted by update(), only the taxon sets
+     * of splits that entered the candidate set since the last call are read from the trees.
      */
     CandidateSet::iterator treeIt;
-    //vector<string> taxaNames = aln->getSeqNames();
     for (treeIt = begin(); treeIt != end(); treeIt++) {
-        MTree tree(treeIt->second.tree, Params::getInstance().is_rooted);
-        SplitGraph splits;
-        tree.convertSplits(splits);
-        SplitGraph::iterator itg;
-        for (itg = splits.begin(); itg != splits.end(); itg++) {
-            int value;
-            Split *sp = candSplits.findSplit(*itg, value);
-            if (sp != NULL) {
-                int newHashWeight = value + 1;
-                double newSupport = (double) newHashWeight / (double) candSplits.getNumTree();
-                sp->setWeight(newSupport);
-                candSplits.setValue(sp, newHashWeight);
-            }
-            else {
-                sp = new Split(*(*itg));
-                sp->setWeight(1.0 / (double) candSplits.getNumTree());
-                candSplits.insertSplit(sp, 1);
+        bool known = true;
+        for (uint64_t split : treeIt->second.splits)
+            if (splitTaxa.find(split) == splitTaxa.end()) {
+                known = false;
+                break;
             }
+        if (known)
+            continue;
+        MTree tree(treeIt->second.tree, Params::getInstance().is_rooted);
+        Split taxa(tree.leafNum);
+        uint64_t key1, key2;
+        hashSplits(findFirstTaxon(&tree), NULL, key1, key2, treeIt->second, &taxa);
+    }
+
+    /* Store all splits in the best trees in candSplits.
+     * The variable numTree in SpitInMap is the number of trees, from which the splits are converted.
+     */
+    candSplits.clear();
+    candSplits.setNumTree(size());
+    for (auto it = splitTaxa.begin(); it != splitTaxa.end(); ) {
+        auto count = splitCounts.find(it->first);
+        if (count == splitCounts.end()) {
+            it = splitTaxa.erase(it);
+            continue;
         }
+        it->second.setWeight((double) count->second / (double) candSplits.getNumTree());
+        candSplits.insertSplit(&it->second, count->second);
+        it++;
     }
     int newNumStableSplits = countStableSplits(supportThreshold);
     if (verbose_mode >= VB_MED) {
@@ -501,7 +605,7 @@ void CandidateSet::printTrees(string suffix) {
     outLHs.precision(15);
     for (reverse_iterator rit = rbegin(); rit != rend(); rit++) {
         outLHs << rit->first << endl;
-        outTrees << rit->second.topology << endl;
+        outTrees << getTopology(rit->second.tree) << endl;
     }
     outTrees.close();
     outLHs.close();
@@ -32,6 +32,23 @@
 
 class IQTree;
 
+/**
+ * 128-bit hash of a tree topology, independent of the root position and the order of children
+ */
+struct TopologyHash {
+    uint64_t first, second;
+
+    bool operator==(const TopologyHash &other) const {
+        return first == other.first && second == other.second;
+    }
+};
+
+struct hashfunc_TopologyHash {
+    size_t operator()(const TopologyHash &topo) const {
+        return topo.first;
+    }
+};
+
 struct CandidateTree {
 
 	/**
@@ -41,11 +58,14 @@ struct CandidateTree {
 	string tree;
 
 	/**
-	 * tree topology WITHOUT branch lengths
-	 * and WITH TAXON ID (instead of taxon names)
-	 * for sorting purpose
+	 * hash of the tree topology, to find duplicated topologies
 	 */
-	string topology;
+	TopologyHash topology;
+
+	/**
+	 * hashes of the splits of all branches, see CandidateSet::computeSignature()
+	 */
+	vector<uint64_t> splits;
 
 	/**
 	 * log-likelihood or parsimony score
@@ -120,12 +140,14 @@ public:
      * 	    The new tree string (with branch lengths)
      *  @param score
      * 	    The score (ML or parsimony) of \a tree
+     *  @param tree
+     *      (optional) the tree object printed as \a newTree, to hash its topology without parsing \a newTree
      *  @return
      *      Relative position of the new tree to the current best tree.
      *      Return -1 if the tree topology already existed
      *      Return -2 if the candidate set is not updated
      */
-    int update(string newTree, double newScore);
+    int update(string newTree, double newScore, MTree *tree = NULL);
 
     /**
      *  Get the \a numBestScores best scores in the candidate set
@@ -182,9 +204,9 @@ public:
      * 	Check if tree topology \a topo already exists
      *
      * 	@param topo
-     * 		Newick string of the tree topology
+     * 		hash of the tree topology
      */
-    bool treeTopologyExist(string topo);
+    bool treeTopologyExist(const TopologyHash &topo);
 
     /**
      * 	Check if tree \a tree already exists
@@ -222,11 +244,22 @@ public:
      * return the score of \a topology
      *
      * @param topology
-     * 		Newick topology
+     * 		hash of the topology
      * @return
      * 		Score of the topology
      */
-    double getTopologyScore(string topology);
+    double getTopologyScore(const TopologyHash &topology);
+
+    /**
+     *  Compute the topology hash and the split hashes of a tree.
+     *  A split is hashed by the sum of random keys of its taxa on the side without taxon 0,
+     *  the topology by the sum of mixed split hashes, so neither depends on the root or the order of children.
+     *
+     *  @param tree
+     *      the tree, leaf IDs must be taxon IDs
+     *  @param candidate [OUT] topology and splits are set
+     */
+    void computeSignature(MTree *tree, CandidateTree &candidate);
 
     /**
      *  Empty the candidate set
@@ -240,6 +273,7 @@ public:
 
     /**
      *  Collect all splits from the set of current best trees and compute for each of them the number of occurances.
+     *  The occurences are kept up to date by update(), only the taxon sets of new splits are read from the trees.
      *
      *  @param supportThres
      *      a number in (0,1] representing the support value threshold for stable splits
@@ -275,13 +309,13 @@ public:
      * @param topology
      * @return
      */
-    iterator getCandidateTree(string topology);
+    iterator getCandidateTree(const TopologyHash &topology);
 
     /**
      * Remove candidate trees with topology equal to the specified topology
      * @param topology
      */
-    void removeCandidateTree(string topology);
+    void removeCandidateTree(const TopologyHash &topology);
 
     /**
      *  Remove the worst tree in the candidate set
@@ -291,7 +325,7 @@ public:
     /* Getter and Setter function */
 	void setAln(Alignment* aln);
 
-	const StringDoubleHashMap& getTopologies() const {
+	const unordered_map<TopologyHash, double, hashfunc_TopologyHash>& getTopologies() const {
 		return topologies;
 	}
 
@@ -378,9 +412,42 @@ private:
 	SplitIntMap candSplits;
 
     /**
-     *  Map data structure storing <topology_string, score>
+     *  Map data structure storing <topology_hash, score>
+     */
+    unordered_map<TopologyHash, double, hashfunc_TopologyHash> topologies;
+
+    /**
+     *  Number of candidate trees containing each split, by split hash
+     */
+    unordered_map<uint64_t, int> splitCounts;
+
+    /**
+     *  Taxon sets of the splits in splitCounts, by split hash, filled by computeSplitOccurences()
+     */
+    unordered_map<uint64_t, Split> splitTaxa;
+
+    /**
+     *  hash the splits of all branches below \a node, see computeSignature()
+     *  @param key1, key2 [OUT] sums of the two taxon keys of the taxa below \a node
+     *  @param taxa (optional) [OUT] taxa below \a node, then taxon sets of splits not in splitTaxa are added to it
+     */
+    void hashSplits(Node *node, Node *dad, uint64_t &key1, uint64_t &key2, CandidateTree &candidate, Split *taxa);
+
+    /**
+     *  @return leaf of taxon 0 of \a tree
+     */
+    Node *findFirstTaxon(MTree *tree);
+
+    /**
+     *  insert a candidate tree, counting its splits
+     *  @return iterator to the inserted tree
+     */
+    iterator insertCandidate(const CandidateTree &candidate);
+
+    /**
+     *  erase a candidate tree, uncounting its splits
      */
-    StringDoubleHashMap topologies;
+    void eraseCandidate(iterator it);
 
     /**
      *  Trees used for reproduction
@@ -50,6 +50,8 @@ void IQTree::init() {
     k_delete = k_delete_min = k_delete_max = k_delete_stay = 0;
     dist_matrix = NULL;
     var_matrix = NULL;
+    boot_rell_buffer = NULL;
+    boot_rell_buffer_size = 0;
 //    curScore = 0.0; // Current score of the tree
     cur_pars_score = -1;
 //    enable_parsimony = false;
@@ -104,38 +106,63 @@ void IQTree::saveUFBoot(Checkpoint *checkpoint) {
     if (MPIHelper::getInstance().isWorker()) {
         CKP_SAVE(sample_start);
         CKP_SAVE(sample_end);
-        checkpoint->startList(boot_samples.size());
-        checkpoint->setListElement(sample_start-1);
-        for (int id = sample_start; id != sample_end; id++) {
-            checkpoint->addListElement();
-            stringstream ss;
-            ss.precision(10);
-            ss << boot_counts[id] << " " << boot_logl[id] << " " << boot_orig_logl[id] << " " << boot_trees[id];
-            checkpoint->put("", ss.str());
-        }
-        checkpoint->endList();
+        saveUFBootSamples(checkpoint, sample_start, sample_end);
     } else {
         CKP_SAVE(logl_cutoff);
         int boot_splits_size = boot_splits.size();
         CKP_SAVE(boot_splits_size);
-        checkpoint->startList(boot_samples.size());
-        for (int id = 0; id != boot_samples.size(); id++) {
-            checkpoint->addListElement();
-            stringstream ss;
-            ss.precision(10);
-            ss << boot_counts[id] << " " << boot_logl[id] << " " << boot_orig_logl[id] << " " << boot_trees[id];
-            checkpoint->put("", ss.str());
+        saveUFBootSamples(checkpoint, 0, boot_samples.size());
+    }
+    checkpoint->endStruct();
+}
+
+void IQTree::saveUFBootSamples(Checkpoint *checkpoint, int start, int end) {
+    // number the distinct trees in order of first occurrence
+    unordered_map<int, int> tree_pos;
+    IntVector sample_pos;
+    StrVector trees;
+    int id;
+    for (id = start; id != end; id++) {
+        if (boot_trees[id] < 0) {
+            sample_pos.push_back(-1);
+            continue;
         }
-        checkpoint->endList();
+        auto it = tree_pos.find(boot_trees[id]);
+        if (it == tree_pos.end()) {
+            it = tree_pos.insert({boot_trees[id], (int)trees.size()}).first;
+            trees.push_back(boot_tree_pool.getTree(boot_trees[id]));
+        }
+        sample_pos.push_back(it->second);
+    }
+    int num_boot_trees = trees.size();
+    CKP_SAVE(num_boot_trees);
+    checkpoint->startStruct("Trees");
+    checkpoint->startList(num_boot_trees);
+    for (auto it = trees.begin(); it != trees.end(); it++) {
+        checkpoint->addListElement();
+        checkpoint->put("", *it);
     }
+    checkpoint->endList();
     checkpoint->endStruct();
+
+    checkpoint->startList(boot_samples.size());
+    if (start > 0)
+        checkpoint->setListElement(start-1);
+    for (id = start; id != end; id++) {
+        checkpoint->addListElement();
+        stringstream ss;
+        ss.precision(10);
+        ss << boot_counts[id] << " " << boot_logl[id] << " " << boot_orig_logl[id] << " " << sample_pos[id-start];
+        checkpoint->put("", ss.str());
+    }
+    checkpoint->endList();
 }
 
 void IQTree::saveCheckpoint() {
     stop_rule.saveCheckpoint();
     candidateTrees.saveCheckpoint();
     
-    if (boot_samples.size() > 0 && !boot_trees.front().empty()) {
+    if (boot_samples.size() > 0 && boot_trees.front() >= 0) {
         saveUFBoot(checkpoint);
         // boot_splits
         int id = 0;
@@ -153,23 +180,57 @@ void IQTree::saveCheckpoint() {
 
 void IQTree::restoreUFBoot(Checkpoint *checkpoint) {
     checkpoint->startStruct("UFBoot");
-    // save boot_samples and boot_trees
-    int id;
-    checkpoint->startList(params->gbo_replicates);
     int sample_start, sample_end;
     CKP_RESTORE(sample_start);
     CKP_RESTORE(sample_end);
-    checkpoint->setListElement(sample_start-1);
-    for (id = sample_start; id != sample_end; id++) {
+    restoreUFBootSamples(checkpoint, sample_start, sample_end);
+    checkpoint->endStruct();
+}
+
+void IQTree::restoreUFBootSamples(Checkpoint *checkpoint, int start, int end) {
+    // checkpoints of older versions store the tree string of every sample instead
+    int num_boot_trees = -1;
+    bool tree_strings = !CKP_RESTORE(num_boot_trees);
+    if (tree_strings)
+        num_boot_trees = 0;
+    StrVector trees;
+    trees.resize(num_boot_trees);
+    checkpoint->startStruct("Trees");
+    checkpoint->startList(num_boot_trees);
+    for (auto it = trees.begin(); it != trees.end(); it++) {
+        checkpoint->addListElement();
+        checkpoint->getString("", *it);
+        ASSERT(!it->empty());
+    }
+    checkpoint->endList();
+    checkpoint->endStruct();
+
+    checkpoint->startList(params->gbo_replicates);
+    if (start > 0)
+        checkpoint->setListElement(start-1);
+    for (int id = start; id != end; id++) {
         checkpoint->addListElement();
         string str;
         checkpoint->getString("", str);
         ASSERT(!str.empty());
         stringstream ss(str);
-        ss >> boot_counts[id] >> boot_logl[id] >> boot_orig_logl[id] >> boot_trees[id];
+        ss >> boot_counts[id] >> boot_logl[id] >> boot_orig_logl[id];
+        if (ss.fail())
+            outError("Checkpoint has a corrupt UFBoot sample " + convertIntToString(id) + ", rerun with -redo");
+        if (tree_strings) {
+            string tree_str;
+            if (ss >> tree_str)
+                setBootTree(id, tree_str);
+            continue;
+        }
+        int pos = -1;
+        ss >> pos;
+        if (ss.fail() || pos >= num_boot_trees)
+            outError("Checkpoint has a corrupt UFBoot sample " + convertIntToString(id) + ", rerun with -redo");
+        if (pos >= 0)
+            setBootTree(id, trees[pos]);
     }
     checkpoint->endList();
-    checkpoint->endStruct();
 }
 
 void IQTree::restoreCheckpoint() {
@@ -181,27 +242,18 @@ void IQTree::restoreCheckpoint() {
         checkpoint->startStruct("UFBoot");
 //        CKP_RESTORE(max_candidate_trees);
         CKP_RESTORE(logl_cutoff);
-        // save boot_samples and boot_trees
-        int id = 0;
-        checkpoint->startList(params->gbo_replicates);
-        boot_trees.resize(params->gbo_replicates);
+        // restore boot_samples and boot_trees
+        boot_trees.resize(params->gbo_replicates, -1);
         boot_logl.resize(params->gbo_replicates);
         boot_orig_logl.resize(params->gbo_replicates);
         boot_counts.resize(params->gbo_replicates);
-        for (id = 0; id < params->gbo_replicates; id++) {
-            checkpoint->addListElement();
-            string str;
-            checkpoint->getString("", str);
-            stringstream ss(str);
-            ss >> boot_counts[id] >> boot_logl[id] >> boot_orig_logl[id] >> boot_trees[id];
-        }
-        checkpoint->endList();
+        restoreUFBootSamples(checkpoint, 0, params->gbo_replicates);
         int boot_splits_size = 0;
         CKP_RESTORE(boot_splits_size);
         checkpoint->endStruct();
 
         // boot_splits
-        for (id = 0; id < boot_splits_size; id++) {
+        for (int id = 0; id < boot_splits_size; id++) {
             checkpoint->startStruct("UFBootSplit" + convertIntToString(id));
             SplitGraph *sg = new SplitGraph;
             sg->createBlocks();
@@ -366,18 +418,19 @@ void IQTree::initSettings(Params &params) {
 #else
         size_t nptn = get_safe_upper_limit(orig_nptn);
 #endif
-        BootValType *mem = aligned_alloc<BootValType>(nptn * (size_t)(params.gbo_replicates));
-        memset(mem, 0, nptn * (size_t)(params.gbo_replicates) * sizeof(BootValType));
+        BootCountType *mem = aligned_alloc<BootCountType>(nptn * (size_t)(params.gbo_replicates));
+        memset(mem, 0, nptn * (size_t)(params.gbo_replicates) * sizeof(BootCountType));
         for (i = 0; i < params.gbo_replicates; i++)
             boot_samples[i] = mem + i*nptn;
+        boot_samples_overflow.resize(params.gbo_replicates);
 
         if (boot_trees.empty()) {
             boot_logl.resize(params.gbo_replicates, -DBL_MAX);
             boot_orig_logl.resize(params.gbo_replicates, -DBL_MAX);
-            boot_trees.resize(params.gbo_replicates, "");
+            boot_trees.resize(params.gbo_replicates, -1);
             boot_counts.resize(params.gbo_replicates, 0);
         } else {
-            cout << "CHECKPOINT: " << boot_trees.size() << " UFBoot trees and " << boot_splits.size() << " UFBootSplits restored" << endl;
+            cout << "CHECKPOINT: " << boot_trees.size() << " UFBoot trees (" << boot_tree_pool.getNumTrees() << " distinct) and " << boot_splits.size() << " UFBootSplits restored" << endl;
         }
         VerboseMode saved_mode = verbose_mode;
         verbose_mode = VB_QUIET;
@@ -390,15 +443,13 @@ void IQTree::initSettings(Params &params) {
                     bootstrap_alignment = new Alignment;
                 IntVector this_sample;
                 bootstrap_alignment->createBootstrapAlignment(aln, &this_sample, params.bootstrap_spec);
-                for (size_t j = 0; j < orig_nptn; j++)
-                    boot_samples[i][j] = this_sample[j];
+                setBootSample(i, this_sample);
                 bootstrap_alignment->printAlignment(params.aln_output_format, bootaln_name.c_str(), true);
                 delete bootstrap_alignment;
             } else {
                 IntVector this_sample;
                 aln->createBootstrapAlignment(this_sample, params.bootstrap_spec);
-                for (size_t j = 0; j < orig_nptn; j++)
-                    boot_samples[i][j] = this_sample[j];
+                setBootSample(i, this_sample);
             }
         }
         verbose_mode = saved_mode;
@@ -420,7 +471,7 @@ void IQTree::initSettings(Params &params) {
             for (size_t i = 0; i < params.gbo_replicates; i++) {
                 boot_samples_int[i].resize(nptn, 0);
                 for (size_t j = 0; j < orig_nptn; j++)
-                    boot_samples_int[i][j] = boot_samples[i][j];
+                    boot_samples_int[i][j] = getBootCount(i, j);
                }
         }
 
@@ -449,6 +500,10 @@ IQTree::~IQTree() {
         aligned_free(boot_samples[0]); // free memory
         boot_samples.clear();
     }
+    aligned_free(boot_rell_buffer);
+
+    deleteNNIWorkers();
+    deleteSearchWorkers();
 }
 
 extern const char *aa_model_names_rax[];
@@ -671,9 +726,10 @@ void IQTree::computeInitialTree(LikelihoodKernel kernel, istream* in) {
     }
 }
 
-int IQTree::addTreeToCandidateSet(string treeString, double score, bool updateStopRule, int sourceProcID) {
+int IQTree::addTreeToCandidateSet(string treeString, double score, bool updateStopRule, int sourceProcID,
+                                  MTree *tree) {
     double curBestScore = candidateTrees.getBestScore();
-    int pos = candidateTrees.update(treeString, score);
+    int pos = candidateTrees.update(treeString, score, tree);
     if (updateStopRule) {
         stop_rule.setCurIt(stop_rule.getCurIt() + 1);
         if (score > curBestScore) {
@@ -853,7 +909,7 @@ void IQTree::initCandidateTreeSet(int nParTrees, int nNNITrees) {
 //        cout << "curScore: " << curScore << "  Tree before NNI: " << getTreeString() << endl;
         doNNISearch();
         string treeString = getTreeString();
-        addTreeToCandidateSet(treeString, curScore, true, MPIHelper::getInstance().getProcessID());
+        addTreeToCandidateSet(treeString, curScore, true, MPIHelper::getInstance().getProcessID(), this);
         if (Params::getInstance().writeDistImdTrees)
             intermediateTrees.update(treeString, curScore);
     }
@@ -2257,6 +2313,16 @@ double IQTree::doTreeSearch() {
 
     setRootNode(params->root);
 
+    if (params->lazy_spr_radius > 0 && (!isLazySPRSupported() || !constraintTree.empty()))
+        outWarning("Lazy SPR search (--spr-radius) does not support this tree, only NNIs are used");
+
+    int num_search_workers = 0;
+    if (params->num_search_workers > 1) {
+        num_search_workers = createSearchWorkers();
+        if (num_search_workers == 0)
+            outWarning("Concurrent search (--search-workers) does not support this analysis, iterations run one at a time");
+    }
+
     if (!getCheckpoint()->getBool("finishedCandidateSet"))
         cout << "CHECKPOINT: " << stop_rule.getCurIt() << " search iterations restored" << endl;
 
@@ -2301,21 +2367,32 @@ double IQTree::doTreeSearch() {
 
         Alignment *saved_aln = aln;
 
-        string curTree;
-        /*----------------------------------------
-         * Perturb the tree
-         *---------------------------------------*/
-        doTreePerturbation();
-
-        /*----------------------------------------
-         * Optimize tree with NNI
-         *----------------------------------------*/
-        pair<int, int> nniInfos; // <num_NNIs, num_steps>
-        nniInfos = doNNISearch();
-        curTree = getTreeString();
-        int pos = addTreeToCandidateSet(curTree, curScore, true, MPIHelper::getInstance().getProcessID());
-        if (pos != -2 && pos != -1 && (Params::getInstance().fixStableSplits || Params::getInstance().adaptPertubation))
-            candidateTrees.computeSplitOccurences(Params::getInstance().stableSplitThreshold);
+        if (num_search_workers > 1) {
+            /*----------------------------------------
+             * Perturb and optimize trees concurrently, never running more iterations than the stop rule allows
+             *---------------------------------------*/
+            int num_iterations = 1;
+            while (num_iterations < num_search_workers &&
+                   !stop_rule.meetStopCondition(stop_rule.getCurIt() + num_iterations, cur_correlation))
+                num_iterations++;
+            doSearchWorkerRound(num_iterations);
+        } else {
+            string curTree;
+            /*----------------------------------------
+             * Perturb the tree
+             *---------------------------------------*/
+            doTreePerturbation();
+
+            /*----------------------------------------
+             * Optimize tree with NNI
+             *----------------------------------------*/
+            pair<int, int> nniInfos; // <num_NNIs, num_steps>
+            nniInfos = doNNISearch();
+            curTree = getTreeString();
+            int pos = addTreeToCandidateSet(curTree, curScore, true, MPIHelper::getInstance().getProcessID(), this);
+            if (pos != -2 && pos != -1 && (Params::getInstance().fixStableSplits || Params::getInstance().adaptPertubation))
+                candidateTrees.computeSplitOccurences(Params::getInstance().stableSplitThreshold);
+        }
 
         if (MPIHelper::getInstance().isWorker() || MPIHelper::getInstance().gotMessage())
             syncCurrentTree();
@@ -2412,6 +2489,8 @@ double IQTree::doTreeSearch() {
         
     }
     
+    deleteSearchWorkers();
+
     if(params->ufboot2corr) refineBootTrees();
 
     if (!early_stop)
@@ -2546,7 +2625,7 @@ void IQTree::refineBootTrees(){
         }
 
 
-        tree = boot_trees[sample];
+        tree = getBootTree(sample);
         // Read the bootstrap tree
 //        cout << tree << endl;
 
@@ -2591,7 +2670,7 @@ void IQTree::refineBootTrees(){
         stringstream ostr;
         printTree(ostr, WT_TAXON_ID | WT_SORT_TAXA);
         tree = ostr.str();
-        boot_trees[sample] = getTreeString();
+        setBootTree(sample, getTreeString());
         boot_logl[sample] = curScore;
 
         printTree(btreea, WT_NEWLINE | WT_SORT_TAXA);
@@ -2746,9 +2825,9 @@ void IQTree::refineBootTrees() {
         // load the current ufboot tree
         // 2019-02-06: fix crash with -sp and -bnni
         if (isSuperTree())
-            boot_tree->PhyloTree::readTreeString(boot_trees[sample]);
+            boot_tree->PhyloTree::readTreeString(getBootTree(sample));
         else
-            boot_tree->readTreeString(boot_trees[sample]);
+            boot_tree->readTreeString(getBootTree(sample));
         
         if (boot_tree->isSuperTree() && params->partition_type == BRLEN_OPTIMIZE) {
             if (((PhyloSuperTree*)boot_tree)->size() > 1) {
@@ -2783,7 +2862,7 @@ void IQTree::refineBootTrees() {
             boot_tree->printTree(ostr, WT_TAXON_ID | WT_SORT_TAXA | WT_BR_LEN | WT_BR_LEN_SHORT);
         else
             boot_tree->printTree(ostr, WT_TAXON_ID | WT_SORT_TAXA);
-        boot_trees[sample] = ostr.str();
+        setBootTree(sample, ostr.str());
         boot_logl[sample] = boot_tree->curScore;
 
 
@@ -2962,6 +3041,8 @@ pair<int, int> IQTree::doNNISearch(bool write_info) {
         readTreeString(string(pllInst->tree_string));
     } else {
         prepareToComputeDistances();
+        if (params->lazy_spr_radius > 0 && constraintTree.empty())
+            optimizeLazySPR(params->lazy_spr_radius);
         nniInfos = optimizeNNI(Params::getInstance().speednni);
         doneComputingDistances();
         if (isSuperTree()) {
@@ -3273,7 +3354,7 @@ void IQTree::pllInitUFBootData(){
                 if(!pllUFBootDataPtr->boot_samples[i]) outError("Not enough dynamic memory!");
                 for(int j = 0; j < pllAlignment->sequenceLength; j++){
                     pllUFBootDataPtr->boot_samples[i][j] =
-                        boot_samples[i][pll2iqtree_pattern_index[j]];
+                        getBootCount(i, pll2iqtree_pattern_index[j]);
                 }
             }
 
@@ -3332,6 +3413,13 @@ void IQTree::pllDestroyUFBootData(){
 
 void IQTree::doNNIs(vector<NNIMove> &compatibleNNIs, bool changeBran) {
     for (vector<NNIMove>::iterator it = compatibleNNIs.begin(); it != compatibleNNIs.end(); it++) {
+        if (!nni_worker_trees.empty()) {
+            // replayed on the NNI workers by syncNNIWorkers()
+            nni_worker_pending.push_back(it->node1->id);
+            nni_worker_pending.push_back(it->node2->id);
+            nni_worker_pending.push_back(it->node1Nei_it - it->node1->neighbors.begin());
+            nni_worker_pending.push_back(it->node2Nei_it - it->node2->neighbors.begin());
+        }
         doNNI(*it);
         if (!params->leastSquareNNI && changeBran) {
             // apply new branch lengths
@@ -3424,6 +3512,8 @@ void IQTree::setDelete(int _delete) {
 }
 
 void IQTree::evaluateNNIs(Branches &nniBranches, vector<NNIMove>  &positiveNNIs) {
+    if (params->num_nni_workers > 1 && evaluateNNIsParallel(nniBranches, positiveNNIs))
+        return;
     for (Branches::iterator it = nniBranches.begin(); it != nniBranches.end(); it++) {
         NNIMove nni = getBestNNIForBran((PhyloNode*) it->second.first, (PhyloNode*) it->second.second, NULL);
         if (nni.newloglh > curScore) {
@@ -3438,6 +3528,437 @@ void IQTree::evaluateNNIs(Branches &nniBranches, vector<NNIMove>  &positiveNNIs)
     }
 }
 
+bool IQTree::evaluateNNIsParallel(Branches &nniBranches, vector<NNIMove> &positiveNNIs) {
+#ifdef _OPENMP
+    if (nniBranches.size() < 2 || omp_in_parallel() || createNNIWorkers() < 2)
+        return false;
+    int num_workers = nni_worker_trees.size();
+    syncNNIWorkers();
+    vector<vector<PhyloNode*> > &node_map = nni_worker_node_map, &worker_map = nni_worker_map;
+
+    vector<Branch> branches;
+    for (Branches::iterator it = nniBranches.begin(); it != nniBranches.end(); it++)
+        branches.push_back(it->second);
+    vector<NNIMove> moves(branches.size());
+
+#pragma omp parallel for schedule(dynamic) num_threads(num_workers)
+    for (int i = 0; i < branches.size(); i++) {
+        int w = omp_get_thread_num();
+        NNIMove nni = nni_worker_trees[w]->getBestNNIForBran(
+            node_map[w][branches[i].first->id], node_map[w][branches[i].second->id], NULL);
+        // translate the move back to this tree, which has the same neighbor order
+        NNIMove &move = moves[i];
+        move = nni;
+        move.node1 = worker_map[w][nni.node1->id];
+        move.node2 = worker_map[w][nni.node2->id];
+        move.node1Nei_it = move.node1->neighbors.begin() + (nni.node1Nei_it - nni.node1->neighbors.begin());
+        move.node2Nei_it = move.node2->neighbors.begin() + (nni.node2Nei_it - nni.node2->neighbors.begin());
+    }
+
+    // same order as the sequential evaluation
+    for (NNIMove &move : moves)
+        if (move.newloglh > curScore)
+            positiveNNIs.push_back(move);
+
+    // synchronize tree during optimization step
+    if (MPIHelper::getInstance().isMaster() && candidateset_changed.size() > 0
+        && MPIHelper::getInstance().gotMessage()) {
+        syncCurrentTree();
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+int IQTree::createNNIWorkers() {
+    return createNNIWorkers(params->num_nni_workers);
+}
+
+int IQTree::createNNIWorkers(int max_workers) {
+    int num_workers = min(max_workers, num_threads);
+    if (num_workers < 2 || isSuperTree() || isMixlen() || rooted || !model_factory ||
+        !model->useRevKernel() || model->isSiteSpecificModel() || params->lh_mem_save == LM_MEM_SAVE ||
+        save_all_trees == 2 || !constraintTree.empty()) {
+        deleteNNIWorkers();
+        return 0;
+    }
+    if (nni_worker_trees.size() == num_workers && nni_worker_trees[0]->getModelFactory() == model_factory)
+        return num_workers;
+    deleteNNIWorkers();
+    for (int i = 0; i < num_workers; i++) {
+        IQTree *worker = new IQTree(aln);
+        worker->setParams(params);
+        worker->optimize_by_newton = optimize_by_newton;
+        worker->setNumThreads(1);
+        nni_worker_trees.push_back(worker);
+    }
+    nni_worker_node_map.resize(num_workers);
+    nni_worker_map.resize(num_workers);
+    if (verbose_mode >= VB_MED)
+        cout << "Using " << num_workers << " NNI workers" << endl;
+    return num_workers;
+}
+
+/**
+    @return smallest leaf ID of the subtree below node, also stored for every node ID of the subtree in min_leaf
+*/
+static int computeMinLeafID(Node *node, Node *dad, IntVector &min_leaf) {
+    int min_id = node->isLeaf() ? node->id : INT_MAX;
+    FOR_NEIGHBOR_IT(node, dad, it)
+        min_id = min(min_id, computeMinLeafID((*it)->node, node, min_leaf));
+    min_leaf[node->id] = min_id;
+    return min_id;
+}
+
+/**
+    match the nodes of a copy of a tree, identified by the smallest leaf ID of their subtrees,
+    and put the neighbors of the copy in the same order as in the tree
+*/
+static void mapTreeCopyNodes(Node *node, Node *dad, Node *copy_node, Node *copy_dad,
+    IntVector &min_leaf, IntVector &copy_min_leaf, vector<PhyloNode*> &node_map, vector<PhyloNode*> &copy_map)
+{
+    node_map[node->id] = (PhyloNode*)copy_node;
+    copy_map[copy_node->id] = (PhyloNode*)node;
+    NeighborVec neighbors;
+    for (Neighbor *nei : node->neighbors) {
+        for (Neighbor *copy_nei : copy_node->neighbors) {
+            bool match = (copy_nei->node == copy_dad) ? (nei->node == dad) :
+                (nei->node != dad && copy_min_leaf[copy_nei->node->id] == min_leaf[nei->node->id]);
+            if (match) {
+                copy_nei->length = nei->length;
+                neighbors.push_back(copy_nei);
+                break;
+            }
+        }
+    }
+    ASSERT(neighbors.size() == copy_node->neighbors.size());
+    copy_node->neighbors = neighbors;
+    for (size_t i = 0; i < node->neighbors.size(); i++)
+        if (node->neighbors[i]->node != dad)
+            mapTreeCopyNodes(node->neighbors[i]->node, node, copy_node->neighbors[i]->node, copy_node,
+                min_leaf, copy_min_leaf, node_map, copy_map);
+}
+
+void IQTree::syncNNIWorkers() {
+    // every eigen decomposition and rate change invalidates all partial likelihoods
+    DoubleVector model_state;
+    model_state.push_back(model->getEigenVersion());
+    model_state.push_back(site_rate->getPInvar());
+    for (int c = 0; c < site_rate->getNRate(); c++) {
+        model_state.push_back(site_rate->getRate(c));
+        model_state.push_back(site_rate->getProp(c));
+    }
+    bool model_changed = (model_state != nni_worker_model);
+    nni_worker_model = model_state;
+
+    for (int w = 0; w < nni_worker_trees.size(); w++) {
+        IQTree *worker = nni_worker_trees[w];
+        if (!updateNNIWorker(w)) {
+            copyToNNIWorker(w);
+            continue;
+        }
+        if (model_changed) {
+            worker->clearAllPartialLH();
+            worker->computePtnInvar();
+        }
+        worker->curScore = curScore;
+    }
+    nni_worker_pending.clear();
+}
+
+/**
+    copy the branch lengths below node of a tree into its copy with the same topology and neighbor order
+    @param node_map node of the copy for each node ID
+    @param changed [OUT] set for the node ID of every child whose branch to its dad changed
+    @return true if any branch below node changed
+*/
+static bool copyChangedLengths(Node *node, Node *dad, vector<PhyloNode*> &node_map, vector<bool> &changed) {
+    Node *copy_node = node_map[node->id];
+    bool any_changed = false;
+    for (size_t j = 0; j < node->neighbors.size(); j++) {
+        Neighbor *nei = node->neighbors[j];
+        if (nei->node == dad)
+            continue;
+        Neighbor *copy_nei = copy_node->neighbors[j];
+        if (copy_nei->length != nei->length) {
+            copy_nei->length = nei->length;
+            copy_nei->node->findNeighbor(copy_node)->length = nei->length;
+            changed[nei->node->id] = any_changed = true;
+        }
+        if (copyChangedLengths(nei->node, node, node_map, changed))
+            any_changed = true;
+    }
+    return any_changed;
+}
+
+/**
+    find for every node ID whether a branch in the subtree below the node changed
+    @param changed [IN] tells for every node ID if the branch to its dad changed
+    @param dirty_below [OUT] tells for every node ID if a branch below the node changed
+    @return true if a branch below node or the branch to dad changed
+*/
+static bool markChangedBelow(Node *node, Node *dad, vector<bool> &changed, vector<bool> &dirty_below) {
+    bool dirty = false;
+    FOR_NEIGHBOR_IT(node, dad, it)
+        if (markChangedBelow((*it)->node, node, changed, dirty_below))
+            dirty = true;
+    dirty_below[node->id] = dirty;
+    return dirty || changed[node->id];
+}
+
+/**
+    clear the partial likelihoods of a tree copy that include a changed branch length: towards node
+    if a branch below node changed, away from node if a branch outside its subtree changed
+    @param dirty_above whether a branch outside the subtree of node and its branch to dad changed
+*/
+static void clearChangedPartialLh(Node *node, Node *dad, bool dirty_above, vector<PhyloNode*> &node_map,
+    vector<bool> &changed, vector<bool> &dirty_below)
+{
+    if (dad) {
+        PhyloNode *copy_node = node_map[node->id], *copy_dad = node_map[dad->id];
+        if (dirty_below[node->id])
+            ((PhyloNeighbor*)copy_dad->findNeighbor(copy_node))->clearPartialLh();
+        if (dirty_above)
+            ((PhyloNeighbor*)copy_node->findNeighbor(copy_dad))->clearPartialLh();
+    }
+    FOR_NEIGHBOR_IT(node, dad, it) {
+        // outside the subtree of the child: above node, the branch to dad and the sibling subtrees
+        bool child_above = dirty_above || (dad && changed[node->id]);
+        FOR_NEIGHBOR_DECLARE(node, dad, it2)
+            if (it2 != it && (changed[(*it2)->node->id] || dirty_below[(*it2)->node->id]))
+                child_above = true;
+        clearChangedPartialLh((*it)->node, node, child_above, node_map, changed, dirty_below);
+    }
+}
+
+bool IQTree::updateNNIWorker(int w) {
+    IQTree *worker = nni_worker_trees[w];
+    vector<PhyloNode*> &node_map = nni_worker_node_map[w], &worker_map = nni_worker_map[w];
+    if (node_map.size() != nodeNum || worker_map.size() != worker->nodeNum || worker->nodeNum != nodeNum)
+        return false;
+
+    // replay the NNIs, neighbors are swapped in place so the positions carry over
+    for (size_t i = 0; i < nni_worker_pending.size(); i += 4) {
+        PhyloNode *node1 = node_map[nni_worker_pending[i]];
+        PhyloNode *node2 = node_map[nni_worker_pending[i+1]];
+        if (node1->degree() != 3 || node2->degree() != 3 || !node1->findNeighbor(node2))
+            return false;
+        NNIMove move;
+        move.node1 = node1;
+        move.node2 = node2;
+        move.node1Nei_it = node1->neighbors.begin() + nni_worker_pending[i+2];
+        move.node2Nei_it = node2->neighbors.begin() + nni_worker_pending[i+3];
+        if ((*move.node1Nei_it)->node == node2 || (*move.node2Nei_it)->node == node1)
+            return false;
+        worker->doNNI(move);
+    }
+
+    // the worker must now have the topology of this tree, compared by node IDs
+    NodeVector nodes;
+    getAllNodesInSubtree(root, NULL, nodes);
+    if (nodes.size() != nodeNum)
+        return false;
+    for (Node *node : nodes) {
+        if (node->id < 0 || node->id >= nodeNum)
+            return false;
+        PhyloNode *worker_node = node_map[node->id];
+        if (worker_node->neighbors.size() != node->neighbors.size())
+            return false;
+        for (size_t j = 0; j < node->neighbors.size(); j++)
+            if (worker_node->neighbors[j]->node != node_map[node->neighbors[j]->node->id])
+                return false;
+    }
+    // this tree may have new node objects with the same IDs
+    for (Node *node : nodes)
+        worker_map[node_map[node->id]->id] = (PhyloNode*)node;
+
+    vector<bool> changed(nodeNum, false), dirty_below(nodeNum, false);
+    if (copyChangedLengths(root, NULL, node_map, changed)) {
+        markChangedBelow(root, NULL, changed, dirty_below);
+        clearChangedPartialLh(root, NULL, false, node_map, changed, dirty_below);
+    }
+    return true;
+}
+
+void IQTree::copyToNNIWorker(int w) {
+    IQTree *worker = nni_worker_trees[w];
+    vector<PhyloNode*> &node_map = nni_worker_node_map[w], &worker_map = nni_worker_map[w];
+    worker->copyPhyloTree(this, true);
+    worker->setModelFactory(model_factory);
+    worker->setLikelihoodKernel(sse);
+    worker->setNumThreads(1);
+    worker->initializeAllPartialLh();
+    worker->computePtnInvar();
+    worker->curScore = curScore;
+
+    // exact branch lengths, the tree string is rounded
+    IntVector min_leaf(nodeNum), worker_min_leaf(worker->nodeNum);
+    Node *leaf = findNodeID(0), *worker_leaf = worker->findNodeID(0);
+    computeMinLeafID(leaf, NULL, min_leaf);
+    computeMinLeafID(worker_leaf, NULL, worker_min_leaf);
+    node_map.assign(nodeNum, NULL);
+    worker_map.assign(worker->nodeNum, NULL);
+    mapTreeCopyNodes(leaf, NULL, worker_leaf, NULL, min_leaf, worker_min_leaf, node_map, worker_map);
+}
+
+void IQTree::evaluateLazySPRMoves(vector<SPRMove> &moves, int radius) {
+#ifdef _OPENMP
+    if (params->num_nni_workers > 1 && moves.size() >= 2 && !omp_in_parallel() && constraintTree.empty() &&
+        createNNIWorkers() >= 2)
+    {
+        int num_workers = nni_worker_trees.size();
+        syncNNIWorkers();
+        vector<vector<PhyloNode*> > &node_map = nni_worker_node_map, &worker_map = nni_worker_map;
+
+        // consecutive subtrees are neighbors and share most partial likelihoods, keep them together
+#pragma omp parallel for schedule(dynamic, 8) num_threads(num_workers)
+        for (int i = 0; i < moves.size(); i++) {
+            int w = omp_get_thread_num();
+            SPRMove move = moves[i];
+            move.prune_node = node_map[w][move.prune_node->id];
+            move.prune_dad = node_map[w][move.prune_dad->id];
+            nni_worker_trees[w]->evaluateLazySPR(move, radius);
+            moves[i].score = move.score;
+            if (move.regraft_node) {
+                moves[i].regraft_node = worker_map[w][move.regraft_node->id];
+                moves[i].regraft_dad = worker_map[w][move.regraft_dad->id];
+            }
+        }
+        return;
+    }
+#endif
+    PhyloTree::evaluateLazySPRMoves(moves, radius);
+}
+
+void IQTree::deleteNNIWorkers() {
+    for (IQTree *worker : nni_worker_trees) {
+        // the model belongs to this tree
+        worker->setModelFactory(NULL);
+        delete worker;
+    }
+    nni_worker_trees.clear();
+    nni_worker_node_map.clear();
+    nni_worker_map.clear();
+    nni_worker_pending.clear();
+    nni_worker_model.clear();
+}
+
+int IQTree::createSearchWorkers() {
+    int num_workers = min(params->num_search_workers, num_threads);
+    if (num_workers < 2 || MPIHelper::getInstance().getNumProcesses() > 1 || params->pll || !params->snni ||
+        params->iqp || params->adaptPertubation || params->fixStableSplits || params->tabu ||
+        iqp_assess_quartet == IQP_BOOTSTRAP || params->gbo_replicates > 0 || save_all_trees != 0 ||
+        params->write_intermediate_trees || params->writeDistImdTrees ||
+        isSuperTree() || isMixlen() || !model_factory || !model->useRevKernel() ||
+        model->isSiteSpecificModel() || params->lh_mem_save == LM_MEM_SAVE || !constraintTree.empty()) {
+        deleteSearchWorkers();
+        return 0;
+    }
+    if (search_worker_trees.size() == num_workers)
+        return num_workers;
+    deleteSearchWorkers();
+    for (int i = 0; i < num_workers; i++) {
+        IQTree *worker = new IQTree(aln);
+        worker->setParams(params);
+        worker->optimize_by_newton = optimize_by_newton;
+        worker->setNumThreads(1);
+        search_worker_trees.push_back(worker);
+    }
+    cout << "Running " << num_workers << " search iterations concurrently" << endl;
+    return num_workers;
+}
+
+void IQTree::doSearchWorkerRound(int num_iterations) {
+    ASSERT(num_iterations <= search_worker_trees.size());
+    // the random number stream and the candidate set are not thread-safe: perturb one after another
+    for (int i = 0; i < num_iterations; i++) {
+        IQTree *worker = search_worker_trees[i];
+        worker->setModelFactory(model_factory);
+        worker->setLikelihoodKernel(sse);
+        worker->setNumThreads(1);
+        worker->rooted = rooted;
+        if (params->five_plus_five)
+            worker->readTreeString(candidateTrees.getNextCandTree());
+        else
+            worker->readTreeString(candidateTrees.getRandTopTree(params->popSize));
+        worker->initializeAllPartialLh();
+        worker->computePtnInvar();
+        worker->doRandomNNIs();
+    }
+
+    vector<string> trees(num_iterations);
+    DoubleVector scores(num_iterations);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1) num_threads(num_iterations)
+#endif
+    for (int i = 0; i < num_iterations; i++) {
+        IQTree *worker = search_worker_trees[i];
+        // same steps as doNNISearch()
+        worker->computeLogL();
+        worker->prepareToComputeDistances();
+        if (params->lazy_spr_radius > 0)
+            worker->optimizeLazySPR(params->lazy_spr_radius);
+        worker->optimizeNNI(params->speednni);
+        worker->doneComputingDistances();
+        if (params->print_trees_site_posterior)
+            worker->computePatternCategories();
+        trees[i] = worker->getTreeString();
+        scores[i] = worker->getCurScore();
+    }
+
+    if (params->print_trees_site_posterior) {
+        for (int i = 0; i < num_iterations; i++) {
+            vector<uint64_t> &worker_mask = search_worker_trees[i]->ptn_cat_mask;
+            if (ptn_cat_mask.empty())
+                ptn_cat_mask.resize(worker_mask.size(), 0);
+            for (size_t ptn = 0; ptn < worker_mask.size(); ptn++)
+                ptn_cat_mask[ptn] |= worker_mask[ptn];
+        }
+    }
+
+    for (int i = 0; i < num_iterations; i++) {
+        IQTree *tree = search_worker_trees[i];
+        if (scores[i] > candidateTrees.getBestScore() + params->modelEps) {
+            // the model is shared by all workers, re-optimize it only here (the sNNI algorithm)
+            readTreeString(trees[i]);
+            computeLogL();
+            optimizeModelParameters(false, params->modelEps * 10);
+            getModelFactory()->saveCheckpoint();
+            if (rooted && params->root_move_dist > 0)
+                optimizeRootPosition(params->root_move_dist, true, params->modelEps * 10);
+            trees[i] = getTreeString();
+            scores[i] = getCurScore();
+            tree = this;
+
+            // the remaining trees were scored with the old model: rescore them with the new one
+            int num_rescore = num_iterations - i - 1;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1) num_threads(max(num_rescore, 1)) if (num_rescore > 1)
+#endif
+            for (int j = i+1; j < num_iterations; j++) {
+                IQTree *worker = search_worker_trees[j];
+                worker->clearAllPartialLH();
+                worker->computePtnInvar();
+                worker->setCurScore(worker->optimizeAllBranches(1));
+                trees[j] = worker->getTreeString();
+                scores[j] = worker->getCurScore();
+            }
+        }
+        addTreeToCandidateSet(trees[i], scores[i], true, MPIHelper::getInstance().getProcessID(), tree);
+    }
+    MPIHelper::getInstance().setNumNNISearch(MPIHelper::getInstance().getNumNNISearch() + num_iterations);
+}
+
+void IQTree::deleteSearchWorkers() {
+    for (IQTree *worker : search_worker_trees) {
+        // the model belongs to this tree
+        worker->setModelFactory(NULL);
+        delete worker;
+    }
+    search_worker_trees.clear();
+}
+
 //Branches IQTree::getReducedListOfNNIBranches(Branches &previousNNIBranches) {
 //    Branches resBranches;
 //    for (Branches::iterator it = previousNNIBranches.begin(); it != previousNNIBranches.end(); it++) {
@@ -3593,6 +4114,36 @@ void IQTree::saveCurrentTree(double cur_logl) {
         else
             printTree(ostr, WT_TAXON_ID + WT_SORT_TAXA);
         tree_str = ostr.str();
+        // samples only refer to the pooled tree, unused trees are freed after the loop
+        int tree_id = boot_tree_pool.findOrAdd(tree_str);
+
+        // RELL log-likelihoods of all samples: boot_samples is a contiguous (sample x pattern)
+        // matrix of counts, multiplied with pattern_lh in chunks of samples
+        const int chunk_size = 32;
+        BootValType *boot_rell = aligned_alloc<BootValType>(sample_end - sample_start);
+        size_t thread_buffer_size = getDotProductMatrixBufferSize(chunk_size);
+    #ifdef _OPENMP
+        int num_buffers = omp_get_max_threads();
+    #else
+        int num_buffers = 1;
+    #endif
+        if (boot_rell_buffer_size < thread_buffer_size*num_buffers) {
+            aligned_free(boot_rell_buffer);
+            boot_rell_buffer_size = thread_buffer_size*num_buffers;
+            boot_rell_buffer = aligned_alloc<BootValType>(boot_rell_buffer_size);
+        }
+    #ifdef _OPENMP
+        #pragma omp parallel for schedule(static)
+    #endif
+        for (int start = sample_start; start < sample_end; start += chunk_size) {
+    #ifdef _OPENMP
+            BootValType *buffer = boot_rell_buffer + thread_buffer_size*omp_get_thread_num();
+    #else
+            BootValType *buffer = boot_rell_buffer;
+    #endif
+            (this->*dotProductMatrix)(pattern_lh, boot_samples[start], &boot_samples_overflow[start], maxnptn,
+                min(chunk_size, sample_end - start), maxnptn, boot_rell + (start - sample_start), buffer);
+        }
 
     #ifdef _OPENMP
         int rand_seed = random_int(1000);
@@ -3605,16 +4156,7 @@ void IQTree::saveCurrentTree(double cur_logl) {
         int *rstream = randstream;
     #endif
         for (int sample = sample_start; sample < sample_end; sample++) {
-            double rell = 0.0;
-
-            {
-                // SSE optimized version of the above loop
-                BootValType *boot_sample = boot_samples[sample];
-
-                BootValType res = (this->*dotProduct)(pattern_lh, boot_sample, nptn);
-
-                rell = res;
-            }
+            double rell = boot_rell[sample - sample_start];
 
             bool better = rell > boot_logl[sample] + params->ufboot_epsilon;
             if (!better && rell > boot_logl[sample] - params->ufboot_epsilon) {
@@ -3628,13 +4170,20 @@ void IQTree::saveCurrentTree(double cur_logl) {
                 }
                 boot_logl[sample] = max(boot_logl[sample], rell);
                 boot_orig_logl[sample] = cur_logl;
-                boot_trees[sample] = tree_str;
+                if (boot_trees[sample] != tree_id) {
+                    boot_tree_pool.addRef(tree_id);
+                    if (boot_trees[sample] >= 0)
+                        boot_tree_pool.releaseRef(boot_trees[sample]);
+                    boot_trees[sample] = tree_id;
+                }
             }
         }
     #ifdef _OPENMP
         finish_random(rstream);
         }
     #endif
+        aligned_free(boot_rell);
+        boot_tree_pool.removeUnused();
     }
     if (Params::getInstance().print_tree_lh) {
         out_treelh << cur_logl;
@@ -3783,15 +4332,130 @@ void IQTree::summarizeBootstrap(Params &params, MTreeSet &trees) {
 
 }
 
+int BootTreePool::findOrAdd(const string &tree_str) {
+    size_t key = std::hash<string>()(tree_str);
+    auto range = tree_index.equal_range(key);
+    for (auto it = range.first; it != range.second; it++)
+        if (trees[it->second] == tree_str)
+            return it->second;
+    int tree_id;
+    if (free_ids.empty()) {
+        tree_id = trees.size();
+        trees.push_back(tree_str);
+        refs.push_back(0);
+    } else {
+        tree_id = free_ids.back();
+        free_ids.pop_back();
+        trees[tree_id] = tree_str;
+        ASSERT(refs[tree_id] == 0);
+    }
+    tree_index.insert({key, tree_id});
+    return tree_id;
+}
+
+void BootTreePool::removeUnused() {
+    for (int tree_id = 0; tree_id < trees.size(); tree_id++) {
+        if (refs[tree_id] > 0 || trees[tree_id].empty())
+            continue;
+        auto range = tree_index.equal_range(std::hash<string>()(trees[tree_id]));
+        for (auto it = range.first; it != range.second; it++)
+            if (it->second == tree_id) {
+                tree_index.erase(it);
+                break;
+            }
+        // release the memory of the string
+        string().swap(trees[tree_id]);
+        free_ids.push_back(tree_id);
+    }
+}
+
+void BootTreePool::clear() {
+    trees.clear();
+    refs.clear();
+    tree_index.clear();
+    free_ids.clear();
+}
+
+int IQTree::getBootCount(int sample, int ptn) {
+    BootCountType count = boot_samples[sample][ptn];
+    if (count < BOOT_COUNT_MAX)
+        return count;
+    BootCountOverflow &overflow = boot_samples_overflow[sample];
+    auto it = lower_bound(overflow.begin(), overflow.end(), make_pair(ptn, 0));
+    ASSERT(it != overflow.end() && it->first == ptn);
+    return it->second;
+}
+
+void IQTree::setBootSample(int sample, IntVector &ptn_count) {
+    setBootSample(ptn_count.data(), ptn_count.size(), boot_samples[sample], boot_samples_overflow[sample]);
+}
+
+void IQTree::setBootSample(int *ptn_count, size_t nptn, BootCountType *counts, BootCountOverflow &overflow) {
+    overflow.clear();
+    for (size_t ptn = 0; ptn < nptn; ptn++) {
+        if (ptn_count[ptn] < BOOT_COUNT_MAX) {
+            counts[ptn] = ptn_count[ptn];
+        } else {
+            counts[ptn] = BOOT_COUNT_MAX;
+            overflow.push_back({(int)ptn, ptn_count[ptn]});
+        }
+    }
+}
+
+void IQTree::setBootTree(int sample, const string &tree_str) {
+    int tree_id = boot_tree_pool.findOrAdd(tree_str);
+    if (boot_trees[sample] == tree_id)
+        return;
+    boot_tree_pool.addRef(tree_id);
+    if (boot_trees[sample] >= 0)
+        boot_tree_pool.releaseRef(boot_trees[sample]);
+    boot_trees[sample] = tree_id;
+    boot_tree_pool.removeUnused();
+}
+
+string IQTree::getBootTree(int sample) {
+    if (boot_trees[sample] < 0)
+        return "";
+    return boot_tree_pool.getTree(boot_trees[sample]);
+}
+
+void IQTree::getBootTrees(MTreeSet &trees, IntVector *sample_trees) {
+    unordered_map<int, int> tree_pos;
+    StrVector tree_strs;
+    IntVector weights;
+    if (sample_trees)
+        sample_trees->clear();
+    for (auto id = boot_trees.begin(); id != boot_trees.end(); id++) {
+        int pos = -1;
+        if (*id >= 0) {
+            auto it = tree_pos.find(*id);
+            if (it == tree_pos.end()) {
+                it = tree_pos.insert({*id, (int)tree_strs.size()}).first;
+                tree_strs.push_back(boot_tree_pool.getTree(*id));
+                weights.push_back(0);
+            }
+            pos = it->second;
+            weights[pos]++;
+        }
+        if (sample_trees)
+            sample_trees->push_back(pos);
+    }
+    // each distinct tree is parsed only once
+    trees.init(tree_strs, rooted);
+    trees.tree_weights = weights;
+}
+
 void IQTree::writeUFBootTrees(Params &params) {
     MTreeSet trees;
-//    IntVector tree_weights;
+    IntVector sample_trees;
     int i, j;
     string filename = params.out_prefix;
     filename += ".ufboot";
     ofstream out(filename.c_str());
 
-    trees.init(boot_trees, rooted);
+    getBootTrees(trees, &sample_trees);
+    StrVector tree_strs;
+    tree_strs.resize(trees.size());
     for (i = 0; i < trees.size(); i++) {
         NodeVector taxa;
         // change the taxa name from ID to real name
@@ -3802,13 +4466,17 @@ void IQTree::writeUFBootTrees(Params &params) {
             // reinsert removed seqs into each tree
             trees[i]->insertTaxa(removed_seqs, twin_seqs);
         }
-        // now print to file
-        for (j = 0; j < trees.tree_weights[i]; j++)
-            if (params.print_ufboot_trees == 1)
-                trees[i]->printTree(out, WT_NEWLINE);
-            else
-                trees[i]->printTree(out, WT_NEWLINE + WT_BR_LEN);
+        stringstream ss;
+        if (params.print_ufboot_trees == 1)
+            trees[i]->printTree(ss, WT_NEWLINE);
+        else
+            trees[i]->printTree(ss, WT_NEWLINE + WT_BR_LEN);
+        tree_strs[i] = ss.str();
     }
+    // now print to file in the order of samples
+    for (auto it = sample_trees.begin(); it != sample_trees.end(); it++)
+        if (*it >= 0)
+            out << tree_strs[*it];
     cout << "UFBoot trees printed to " << filename << endl;
     out.close();
 }
@@ -3816,14 +4484,14 @@ void IQTree::writeUFBootTrees(Params &params) {
 void IQTree::summarizeBootstrap(Params &params) {
     setRootNode(params.root);
     MTreeSet trees;
-    trees.init(boot_trees, rooted);
+    getBootTrees(trees);
     summarizeBootstrap(params, trees);
 }
 
 void IQTree::summarizeBootstrap(SplitGraph &sg) {
     MTreeSet trees;
     //SplitGraph sg;
-    trees.init(boot_trees, rooted);
+    getBootTrees(trees);
     SplitIntMap hash_ss;
     // make the taxa name
     vector<string> taxname;
@@ -3903,9 +4571,9 @@ void IQTree::computeRootstrap(MTreeSet &trees, bool use_taxid) {
             if (other.shouldInvert())
                 other.invert();
             // count how often both splits occur in the tree set
-            for (auto splits : ssvec) {
-                if (splits.findSplit(sg[i]) && splits.findSplit(&other)) {
-                    rootstrap++;
+            for (int j = 0; j < ssvec.size(); j++) {
+                if (ssvec[j].findSplit(sg[i]) && ssvec[j].findSplit(&other)) {
+                    rootstrap += trees.tree_weights[j];
                 }
             }
 
@@ -3931,16 +4599,16 @@ void IQTree::computeRootstrap(MTreeSet &trees, bool use_taxid) {
             }
             
             // count how often both splits occur in the tree set
-            for (auto splits : ssvec) {
-                if (splits.findSplit(left) && splits.findSplit(right)) {
-                    rootstrap++;
+            for (int j = 0; j < ssvec.size(); j++) {
+                if (ssvec[j].findSplit(left) && ssvec[j].findSplit(right)) {
+                    rootstrap += trees.tree_weights[j];
                 }
             }
             delete right;
             delete left;
         }
         
-        double rootstrap_dbl = (double)rootstrap*100.0 / trees.size();
+        double rootstrap_dbl = (double)rootstrap*100.0 / trees.sumTreeWeights();
         //branch.first->findNeighbor(branch.second)->putAttr("rootstrap", rootstrap_dbl);
         Neighbor *nei = branch.second->findNeighbor(branch.first);
         nei->putAttr("rootstrap", rootstrap_dbl);
@@ -4133,8 +4801,10 @@ void IQTree::pllConvertUFBootData2IQTree(){
 
     //boot_trees
     boot_trees.clear();
+    boot_tree_pool.clear();
+    boot_trees.resize(params->gbo_replicates, -1);
     for(int i = 0; i < params->gbo_replicates; i++)
-        boot_trees.push_back(pllUFBootDataPtr->boot_trees[i]);
+        setBootTree(i, pllUFBootDataPtr->boot_trees[i]);
 
 }
 
@@ -75,6 +75,82 @@ inline int int_branch_cmp(const IntBranchInfo a, const IntBranchInfo b) {
  */
 typedef multiset<RepLeaf*, nodeheightcmp> RepresentLeafSet;
 
+/**
+    Pool of distinct UFBoot trees. Each tree string is stored once with the
+    number of bootstrap samples referring to it, samples only keep the tree ID.
+ */
+class BootTreePool {
+public:
+
+    /**
+        @param tree_str tree string
+        @return ID of tree_str, added to the pool without references if not found
+     */
+    int findOrAdd(const string &tree_str);
+
+    /**
+        add one reference to a tree, safe to call within OpenMP loops
+        @param tree_id tree ID
+     */
+    void addRef(int tree_id) {
+        #ifdef _OPENMP
+        #pragma omp atomic
+        #endif
+        refs[tree_id]++;
+    }
+
+    /**
+        remove one reference from a tree, safe to call within OpenMP loops.
+        The tree is only freed by removeUnused()
+        @param tree_id tree ID
+     */
+    void releaseRef(int tree_id) {
+        #ifdef _OPENMP
+        #pragma omp atomic
+        #endif
+        refs[tree_id]--;
+    }
+
+    /**
+        free all trees without references
+     */
+    void removeUnused();
+
+    /**
+        @param tree_id tree ID
+        @return tree string
+     */
+    const string &getTree(int tree_id) const {
+        return trees[tree_id];
+    }
+
+    /**
+        @return number of distinct trees currently stored
+     */
+    int getNumTrees() const {
+        return trees.size() - free_ids.size();
+    }
+
+    /**
+        remove all trees
+     */
+    void clear();
+
+protected:
+
+    /** tree strings, empty for freed IDs */
+    StrVector trees;
+
+    /** number of references to each tree */
+    IntVector refs;
+
+    /** map from string hash to tree IDs */
+    unordered_multimap<size_t, int> tree_index;
+
+    /** freed IDs to be reused */
+    IntVector free_ids;
+};
+
 /**
     Main class for tree search
  */
@@ -126,6 +202,22 @@ public:
     */
     void restoreUFBoot(Checkpoint *checkpoint);
 
+    /**
+        save the samples from start to end, and their distinct trees only once
+        @param checkpoint Checkpoint object
+        @param start first sample
+        @param end last sample + 1
+    */
+    void saveUFBootSamples(Checkpoint *checkpoint, int start, int end);
+
+    /**
+        restore the samples from start to end saved by saveUFBootSamples()
+        @param checkpoint Checkpoint object
+        @param start first sample
+        @param end last sample + 1
+    */
+    void restoreUFBootSamples(Checkpoint *checkpoint, int start, int end);
+
     /**
      * setup all necessary parameters  (declared as virtual needed for phylosupertree)
      */
@@ -449,6 +541,104 @@ public:
      */
     void evaluateNNIs(Branches &nniBranches, vector<NNIMove> &outNNIMoves);
 
+    /**
+     * @brief Evaluate the NNIs of different branches concurrently, one NNI worker per thread (--nni-workers)
+     *
+     * @param nniBranches [IN] branches the branches on which NNIs will be evaluated
+     * @return FALSE if NNI workers cannot be used for this tree, then nothing is evaluated
+     */
+    bool evaluateNNIsParallel(Branches &nniBranches, vector<NNIMove> &outNNIMoves);
+
+    /**
+     * @brief Create the NNI workers unless they already exist: copies of this tree with their own
+     * partial likelihood and NNI buffers that share the model of this tree. Models that are not
+     * read-only during NNI evaluation (e.g. non-reversible or mixed branch lengths), partitions,
+     * constraint trees, UFBoot tree saving and -mem memory saving get no workers.
+     * @return number of workers
+     */
+    int createNNIWorkers();
+
+    /**
+     * @brief Create up to max_workers NNI workers (at most one per thread) unless they already exist,
+     * see createNNIWorkers(). evaluateTrees() also uses them to evaluate trees concurrently.
+     * @param max_workers maximal number of workers
+     * @return number of workers
+     */
+    int createNNIWorkers(int max_workers);
+
+    /**
+     * @brief Bring every NNI worker up to date with this tree, afterwards nni_worker_node_map and
+     * nni_worker_map translate between the nodes. A worker that was synchronized before gets the
+     * NNIs done by doNNIs() since then and the changed branch lengths, and recomputes only the
+     * partial likelihoods these affect; other workers get a full copy.
+     */
+    void syncNNIWorkers();
+
+    /**
+     * @brief Copy topology and branch lengths of this tree into an NNI worker, with the same
+     * neighbor order at every node, so that NNIMove iterators and branch lengths carry over
+     * @param w index of the NNI worker
+     */
+    void copyToNNIWorker(int w);
+
+    /**
+     * @brief Replay the NNIs of nni_worker_pending on an NNI worker, then copy the branch lengths
+     * and clear the partial likelihoods depending on changed lengths
+     * @param w index of the NNI worker
+     * @return false if the worker no longer has the topology of this tree and needs a full copy
+     */
+    bool updateNNIWorker(int w);
+
+    /** delete the NNI workers */
+    void deleteNNIWorkers();
+
+    /**
+     * @brief Find the best regraft position of every pruned subtree, on the NNI workers
+     * concurrently if there are any, see PhyloTree::evaluateLazySPR()
+     * @param moves [IN/OUT] subtrees to prune, best regraft positions and scores
+     * @param radius maximal number of branches between prune and regraft point
+     */
+    virtual void evaluateLazySPRMoves(vector<SPRMove> &moves, int radius);
+
+    /** copies of this tree to evaluate NNIs concurrently, see createNNIWorkers() */
+    vector<IQTree*> nni_worker_trees;
+
+    /** node of each NNI worker for each node ID of this tree, see syncNNIWorkers() */
+    vector<vector<PhyloNode*> > nni_worker_node_map;
+
+    /** node of this tree for each node ID of each NNI worker */
+    vector<vector<PhyloNode*> > nni_worker_map;
+
+    /** NNIs done by doNNIs() since the last syncNNIWorkers(): IDs of node1 and node2 and positions of the swapped neighbors */
+    IntVector nni_worker_pending;
+
+    /** eigen version and rates of the model that the NNI workers were synchronized with */
+    DoubleVector nni_worker_model;
+
+    /**
+     * @brief Create the search workers unless they already exist: copies of this tree sharing its
+     * model that each run a whole search iteration (perturbation and NNI search). Only the default
+     * perturbation by random NNIs is supported, without UFBoot, MPI, partitions or constraint trees.
+     * @return number of workers, 0 if iterations must run one at a time
+     */
+    int createSearchWorkers();
+
+    /**
+     * @brief Run one round of search iterations on the search workers concurrently.
+     * Start trees are drawn from the candidate set and perturbed one after another, so that the
+     * random number stream gives the same trees as a sequential run with the same seed. The NNI
+     * searches run in parallel and their trees are added to the candidate set in worker order.
+     * A better tree re-optimizes the model, the trees not yet added are then rescored with it.
+     * @param num_iterations number of iterations of this round, at most the number of workers
+     */
+    void doSearchWorkerRound(int num_iterations);
+
+    /** delete the search workers */
+    void deleteSearchWorkers();
+
+    /** copies of this tree to run search iterations concurrently, see createSearchWorkers() */
+    vector<IQTree*> search_worker_trees;
+
     double optimizeNNIBranches(Branches &nniBranches);
 
     /**
@@ -678,11 +868,14 @@ public:
      *      the score of the new tree
      *  @param updateStopRule
      *      Whether or not to update the stop rule
+     *  @param tree
+     *      (optional) the tree object printed as treeString, saves parsing treeString
      *  @return relative position of the new tree to the current best.
      *      -1 if duplicated
      *      -2 if the candidate set is not updated
      */
-    int addTreeToCandidateSet(string treeString, double score, bool updateStopRule, int sourceProcID);
+    int addTreeToCandidateSet(string treeString, double score, bool updateStopRule, int sourceProcID,
+                              MTree *tree = NULL);
 
     /**
         MPI: synchronize candidate trees between all processes
@@ -771,8 +964,39 @@ public:
     /** log-likelihood threshold (l_min) */
     double logl_cutoff;
 
-    /** vector of bootstrap alignments generated */
-    vector<BootValType* > boot_samples;
+    /** pattern counts of the bootstrap alignments generated, rows of a contiguous (sample x pattern) matrix */
+    vector<BootCountType* > boot_samples;
+
+    /** pattern counts of the bootstrap alignments that do not fit into BootCountType */
+    vector<BootCountOverflow> boot_samples_overflow;
+
+    /** buffers of dotProductMatrix for all threads in saveCurrentTree(), kept between calls */
+    BootValType *boot_rell_buffer;
+
+    /** number of elements of boot_rell_buffer */
+    size_t boot_rell_buffer_size;
+
+    /**
+        @param sample sample ID
+        @param ptn pattern ID
+        @return number of times the pattern occurs in the bootstrap alignment
+     */
+    int getBootCount(int sample, int ptn);
+
+    /**
+        store the pattern counts of a bootstrap alignment
+        @param sample sample ID
+        @param ptn_count number of times each pattern occurs in the bootstrap alignment
+     */
+    void setBootSample(int sample, IntVector &ptn_count);
+
+    /**
+        store the pattern counts of a bootstrap alignment as bytes
+        @param ptn_count number of times each of nptn patterns occurs in the bootstrap alignment
+        @param[out] counts byte counts, BOOT_COUNT_MAX marks a count stored in overflow
+        @param[out] overflow (pattern, count) pairs with count >= BOOT_COUNT_MAX, sorted by pattern
+     */
+    static void setBootSample(int *ptn_count, size_t nptn, BootCountType *counts, BootCountOverflow &overflow);
 
     /** starting sample for UFBoot, used for MPI */
     int sample_start;
@@ -780,8 +1004,11 @@ public:
     /** end sample for UFBoot, used for MPI */
     int sample_end;
 
-    /** newick string of corresponding bootstrap trees */
-    StrVector boot_trees;
+    /** distinct bootstrap trees, as newick strings with taxon IDs */
+    BootTreePool boot_tree_pool;
+
+    /** ID in boot_tree_pool of the bootstrap tree of each sample, -1 if not yet assigned */
+    IntVector boot_trees;
 
     /** bootstrap tree strings with branch lengths, for -wbtl option */
 //    StrVector boot_trees_brlen;
@@ -807,6 +1034,26 @@ public:
     /** Corresponding map for set of splits occurring in bootstrap trees */
     //SplitIntMap boot_splits_map;
 
+    /**
+        assign a bootstrap tree to a sample, not thread-safe
+        @param sample sample ID
+        @param tree_str newick string with taxon IDs
+     */
+    void setBootTree(int sample, const string &tree_str);
+
+    /**
+        @param sample sample ID
+        @return newick string of the bootstrap tree of the sample, empty if not yet assigned
+     */
+    string getBootTree(int sample);
+
+    /**
+        parse the distinct bootstrap trees, each weighted by the number of samples having it
+        @param[out] trees distinct bootstrap trees in order of first occurrence
+        @param[out] sample_trees if not NULL, index into trees for each sample, -1 if not yet assigned
+     */
+    void getBootTrees(MTreeSet &trees, IntVector *sample_trees = NULL);
+
     /** summarize all bootstrap trees */
     void summarizeBootstrap(Params &params, MTreeSet &trees);
 
@@ -45,17 +45,17 @@ void MemSlotVector::reset() {
     for (iterator it = begin(); it != end(); it++) {
         it->status = 0;
         it->nei = NULL;
+        it->referenced = false;
     }
-    nei_id_map.clear();
     free_count = 0;
+    clock_hand = 0;
 }
 
 
 MemSlotVector::iterator MemSlotVector::findNei(PhyloNeighbor *nei) {
-    auto it = nei_id_map.find(nei);
-    ASSERT(it != nei_id_map.end());
-//    assert(at(it->second).nei == nei);
-    return begin()+it->second;
+    ASSERT(nei->slot_id >= 0 && nei->slot_id < size());
+//    assert(at(nei->slot_id).nei == nei);
+    return begin()+nei->slot_id;
 }
 
 void MemSlotVector::addNei(PhyloNeighbor *nei, iterator it) {
@@ -63,7 +63,8 @@ void MemSlotVector::addNei(PhyloNeighbor *nei, iterator it) {
     nei->partial_lh = it->partial_lh;
     nei->scale_num = it->scale_num;
     it->nei = nei;
-    nei_id_map[nei] = it-begin();
+    it->referenced = true;
+    nei->slot_id = it-begin();
 }
 
 
@@ -75,17 +76,17 @@ void MemSlotVector::addSpecialNei(PhyloNeighbor *nei) {
     ms.nei = nei;
     ms.partial_lh = nei->partial_lh;
     ms.scale_num = nei->scale_num;
+    ms.referenced = false;
     push_back(ms);
-    nei_id_map[nei] = size()-1;
+    nei->slot_id = size()-1;
 }
 
 void MemSlotVector::eraseSpecialNei() {
     if (Params::getInstance().lh_mem_save != LM_MEM_SAVE)
         return;
-    while (back().status & MEM_SPECIAL) {
-        nei_id_map.erase(back().nei);
+    // the special neighbors are already deleted
+    while (back().status & MEM_SPECIAL)
         pop_back();
-    }
 }
 
 
@@ -99,6 +100,7 @@ bool MemSlotVector::lock(PhyloNeighbor *nei) {
         return false;
     ASSERT((id->status & MEM_LOCKED) == 0);
     id->status |= MEM_LOCKED;
+    id->referenced = true;
     return true;
 }
 
@@ -143,19 +145,21 @@ int MemSlotVector::allocate(PhyloNeighbor *nei) {
         return it-begin();
     }
 
-    int min_size = INT_MAX;
+    // no free slot found, two rounds of the clock hand visit every unlocked slot
+    // once with and once without its reference bit
     iterator best = end();
-
-
-    // no free slot found, find an unlocked slot with minimal size
-    for (iterator it = begin(); it != end(); it++)
-        if ((it->status & MEM_LOCKED) == 0 && (it->status & MEM_SPECIAL) == 0 && min_size > it->nei->size) {
+    for (size_t step = 0; step < 2*size() && best == end(); step++) {
+        if (clock_hand >= size())
+            clock_hand = 0;
+        iterator it = begin() + (clock_hand++);
+        if (it->status & (MEM_LOCKED | MEM_SPECIAL))
+            continue;
+        // 2 is the minimum size
+        if (it->referenced && it->nei->size > 2)
+            it->referenced = false;
+        else
             best = it;
-            min_size = it->nei->size;
-            // 2 is the minimum size
-            if (min_size == 2)
-                break;
-        }
+    }
 
     if (best == end())
         return -1;
@@ -215,8 +219,8 @@ void MemSlotVector::takeover(PhyloNeighbor *nei, PhyloNeighbor *taken_nei) {
     iterator id = findNei(taken_nei);
 //    if (id->status & MEM_SPECIAL)
 //        return;
-    nei_id_map.erase(nei_id_map.find(taken_nei));
-    nei_id_map[nei] = id - begin();
+    taken_nei->slot_id = -1;
+    nei->slot_id = id - begin();
     if (id->nei == taken_nei) {
         id->nei = nei;
     }
@@ -232,8 +236,7 @@ void MemSlotVector::replace(PhyloNeighbor *new_nei, PhyloNeighbor *old_nei) {
     it->partial_lh = new_nei->partial_lh;
     it->scale_num = new_nei->scale_num;
     it->status = MEM_LOCKED + MEM_SPECIAL;
-    nei_id_map[new_nei] = it-begin();
-//    nei_id_map.erase(old_nei);
+    new_nei->slot_id = it-begin();
     cout << "slot " << distance(begin(), it) << " replaced" << endl;
 }
 
@@ -242,13 +245,12 @@ void MemSlotVector::restore(PhyloNeighbor *new_nei, PhyloNeighbor *old_nei) {
         return;
     iterator it = findNei(new_nei);
     ASSERT(it->nei == new_nei);
-    ASSERT(nei_id_map[old_nei] == it-begin());
+    ASSERT(old_nei->slot_id == it-begin());
     it->nei = it->saved_nei;
     it->saved_nei = NULL;
     it->partial_lh = old_nei->partial_lh;
     it->scale_num = old_nei->scale_num;
     it->status = 0;
-    nei_id_map.erase(new_nei);
-//    nei_id_map[old_nei] = it;
+    new_nei->slot_id = -1;
     cout << "slot " << distance(begin(), it) << " restored" << endl;
 }
@@ -34,12 +34,15 @@ struct MemSlot {
     PhyloNeighbor *nei; // neighbor assigned to this slot
     double *partial_lh; // partial_lh assigned to this slot
     UBYTE *scale_num; // scale_num assigned to this slot
+    bool referenced; // used since the clock hand last passed, see MemSlotVector::allocate
 
     PhyloNeighbor *saved_nei;
 };
 
 /**
-    all memory slots, used for memory saving technique
+    all memory slots, used for memory saving technique.
+    The slot of a neighbor is stored in PhyloNeighbor::slot_id, so all operations
+    are O(1) except allocate(), which evicts slots in clock (second-chance) order
 */
 class MemSlotVector : public vector<MemSlot> {
 public:
@@ -60,7 +63,12 @@ public:
     /** test if the memory assigned to nei is locked or not */
     bool locked(PhyloNeighbor *nei);
 
-    /** allocate free or unlocked memory to nei */
+    /** 
+        allocate free or unlocked memory to nei. If no slot is free, the clock hand
+        evicts the first unlocked slot not used since its last round, giving no second
+        chance to cherries as they are the cheapest to recompute
+        @return slot ID, -1 if all slots are locked
+    */
     int allocate(PhyloNeighbor *nei);
 
     /** update neighbor */
@@ -96,15 +104,12 @@ public:
 protected:
 
 
-    /** 
-        map from neighbor to slot ID for fast lookup
-        IMPORTANT: mapping to ID instead of (unsafe) iterator
-    */
-    unordered_map<PhyloNeighbor*, int> nei_id_map;
-
     /** counter of free slot ID */
     int free_count;
 
+    /** next slot examined for eviction */
+    int clock_hand;
+
 };
 
 
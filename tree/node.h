@@ -126,6 +126,19 @@ public:
     virtual Neighbor* newNeighbor() {
         return (new Neighbor(this));
     }
+
+    /**
+     reset this Neighbor to a copy of another one of the same type, like newNeighbor()
+     but reusing the memory of this object
+     @param nei another Neighbor
+     */
+    virtual void copyNeighbor(Neighbor *nei) {
+        node = nei->node;
+        length = nei->length;
+        id = nei->id;
+        split = NULL;
+        attributes = nei->attributes;
+    }
     
 
     /**
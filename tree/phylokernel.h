@@ -69,6 +69,74 @@ Numeric PhyloTree::dotProductSIMD(Numeric *x, Numeric *y, int size) {
     return horizontal_add(res);
 }
 
+/**
+    Four rows are multiplied together to share each load of x, and the columns are
+    traversed in blocks so that a block of x stays in L1 cache for all rows.
+    The counts of a block are converted into the buffer of the thread right before use,
+    so the matrix is only read in its compact form.
+    Each row is summed in the same order as dotProductSIMD, giving identical results.
+*/
+template <class Numeric, class VectorClass>
+void PhyloTree::dotProductMatrixSIMD(Numeric *x, BootCountType *mat, BootCountOverflow *overflow, size_t stride, int nrows, int size, Numeric *res,
+    Numeric *buffer)
+{
+    const int VCSIZE = VectorClass::size();
+    const int block_size = DOT_MATRIX_BLOCK;
+    ASSERT(VCSIZE <= 16 && block_size % VCSIZE == 0);
+    int row, i, j;
+    Numeric *buf = buffer;
+    Numeric *acc = buffer + 4*block_size;
+    memset(acc, 0, sizeof(Numeric)*nrows*VCSIZE);
+    for (int start = 0; start < size; start += block_size) {
+        int len = min(block_size, size - start);
+        for (row = 0; row < nrows; row += 4) {
+            int nvec = min(4, nrows - row);
+            // convert the counts of this block
+            for (j = 0; j < nvec; j++) {
+                BootCountType *counts = mat + (row+j)*stride + start;
+                Numeric *y = buf + j*block_size;
+#ifdef _OPENMP
+                #pragma omp simd
+#endif
+                for (i = 0; i < len; i++)
+                    y[i] = counts[i];
+                BootCountOverflow &large = overflow[row+j];
+                for (auto it = lower_bound(large.begin(), large.end(), make_pair(start, 0));
+                     it != large.end() && it->first < start + len; it++)
+                    y[it->first - start] = it->second;
+            }
+            if (nvec == 4) {
+                VectorClass res0, res1, res2, res3;
+                res0.load_a(&acc[row*VCSIZE]);
+                res1.load_a(&acc[(row+1)*VCSIZE]);
+                res2.load_a(&acc[(row+2)*VCSIZE]);
+                res3.load_a(&acc[(row+3)*VCSIZE]);
+                for (i = 0; i < len; i += VCSIZE) {
+                    VectorClass xi = VectorClass().load_a(&x[start+i]);
+                    res0 = mul_add(xi, VectorClass().load_a(&buf[i]), res0);
+                    res1 = mul_add(xi, VectorClass().load_a(&buf[block_size+i]), res1);
+                    res2 = mul_add(xi, VectorClass().load_a(&buf[2*block_size+i]), res2);
+                    res3 = mul_add(xi, VectorClass().load_a(&buf[3*block_size+i]), res3);
+                }
+                res0.store_a(&acc[row*VCSIZE]);
+                res1.store_a(&acc[(row+1)*VCSIZE]);
+                res2.store_a(&acc[(row+2)*VCSIZE]);
+                res3.store_a(&acc[(row+3)*VCSIZE]);
+            } else {
+                for (j = 0; j < nvec; j++) {
+                    VectorClass res0;
+                    res0.load_a(&acc[(row+j)*VCSIZE]);
+                    for (i = 0; i < len; i += VCSIZE)
+                        res0 = mul_add(VectorClass().load_a(&x[start+i]), VectorClass().load_a(&buf[j*block_size+i]), res0);
+                    res0.store_a(&acc[(row+j)*VCSIZE]);
+                }
+            }
+        }
+    }
+    for (row = 0; row < nrows; row++)
+        res[row] = horizontal_add(VectorClass().load_a(&acc[row*VCSIZE]));
+}
+
 /************************************************************************************************
  *
  *   Highly optimized vectorized versions of likelihood functions
@@ -1438,6 +1506,17 @@ inline UINT fast_popcount(Vec8ui &x) {
 
 }
 
+#if INSTRSET >= 9
+inline UINT fast_popcount(Vec16ui &x) {
+    MEM_ALIGN_BEGIN uint64_t vec[8] MEM_ALIGN_END;
+    x.store(vec);
+    UINT res = 0;
+    for (int i = 0; i < 8; i++)
+        res += static_cast<UINT>(_mm_popcnt_u64(vec[i]));
+    return res;
+}
+#endif
+
 inline void horizontal_popcount(Vec4ui &x) {
     MEM_ALIGN_BEGIN UINT vec[4] MEM_ALIGN_END;
     x.store_a(vec);
@@ -1815,6 +1894,115 @@ int PhyloTree::computeParsimonyBranchFastSIMD(PhyloNeighbor *dad_branch, PhyloNo
     return score;
 }
 
+/**
+    Fitch score of the tree after inserting a new node between the subtrees x and y and attaching
+    the subtree z to it, without storing the partial parsimony of the new node
+    @param x, y, z partial parsimony of the three subtrees
+    @param score sum of the scores of the three subtrees
+    @param lower_bound stop as soon as the score reaches this bound
+*/
+template<class VectorClass>
+inline UINT computeParsimonyInsertScore(UINT *x_pars, UINT *y_pars, UINT *z_pars, int nstates, int nsites,
+    UINT score, UINT lower_bound)
+{
+    int entry_size = nstates * VectorClass::size();
+    switch (nstates) {
+    case 4:
+        for (int site = 0; site < nsites && score < lower_bound; site++) {
+            size_t offset = entry_size*site;
+            VectorClass *x = (VectorClass*)(x_pars + offset);
+            VectorClass *y = (VectorClass*)(y_pars + offset);
+            VectorClass *z = (VectorClass*)(z_pars + offset);
+            VectorClass u0 = x[0] & y[0], u1 = x[1] & y[1], u2 = x[2] & y[2], u3 = x[3] & y[3];
+            VectorClass w = ~(u0 | u1 | u2 | u3);
+            u0 |= w & (x[0] | y[0]);
+            u1 |= w & (x[1] | y[1]);
+            u2 |= w & (x[2] | y[2]);
+            u3 |= w & (x[3] | y[3]);
+            VectorClass v = ~((u0 & z[0]) | (u1 & z[1]) | (u2 & z[2]) | (u3 & z[3]));
+            score += fast_popcount(w) + fast_popcount(v);
+        }
+        break;
+    default:
+        for (int site = 0; site < nsites && score < lower_bound; site++) {
+            size_t offset = entry_size*site;
+            VectorClass *x = (VectorClass*)(x_pars + offset);
+            VectorClass *y = (VectorClass*)(y_pars + offset);
+            VectorClass *z = (VectorClass*)(z_pars + offset);
+            int i;
+            VectorClass w = 0, v = 0;
+            for (i = 0; i < nstates; i++)
+                w |= x[i] & y[i];
+            w = ~w;
+            for (i = 0; i < nstates; i++)
+                v |= ((x[i] & y[i]) | (w & (x[i] | y[i]))) & z[i];
+            v = ~v;
+            score += fast_popcount(w) + fast_popcount(v);
+        }
+        break;
+    }
+    return score;
+}
+
+template<class VectorClass>
+UINT PhyloTree::computeParsimonyInsertFastSIMD(PhyloNeighbor *added_branch, PhyloNode *added_node,
+    NodeVector &nodes1, NodeVector &nodes2, int &best_id)
+{
+    if ((added_branch->partial_lh_computed & 2) == 0)
+        computePartialParsimonyFastSIMD<VectorClass>(added_branch, added_node);
+    int nstates = aln->getMaxNumStates();
+    const int NUM_BITS = VectorClass::size() * UINT_BITS;
+    int nsites = (aln->num_parsimony_sites + NUM_BITS - 1)/NUM_BITS;
+    int scoreid = nsites*nstates*VectorClass::size();
+    int num_branches = nodes1.size();
+
+    // first bring the partial parsimony of both directions of every branch up to date,
+    // then the branches are only read and can be scored in parallel
+    for (int id = 0; id < num_branches; id++) {
+        PhyloNeighbor *dad_branch = (PhyloNeighbor*) nodes2[id]->findNeighbor(nodes1[id]);
+        PhyloNeighbor *node_branch = (PhyloNeighbor*) nodes1[id]->findNeighbor(nodes2[id]);
+        if ((dad_branch->partial_lh_computed & 2) == 0)
+            computePartialParsimonyFastSIMD<VectorClass>(dad_branch, (PhyloNode*)nodes2[id]);
+        if ((node_branch->partial_lh_computed & 2) == 0)
+            computePartialParsimonyFastSIMD<VectorClass>(node_branch, (PhyloNode*)nodes1[id]);
+    }
+
+    UINT best_score = UINT_MAX;
+    best_id = -1;
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(num_threads) if(num_threads > 1 && num_branches >= 2*num_threads)
+#endif
+    {
+        // each thread visits its branches in increasing order, so a branch that only ties
+        // the best score of the thread can be dropped early: the first one on ties wins
+        UINT thread_best = UINT_MAX;
+        int thread_best_id = -1;
+#ifdef _OPENMP
+        #pragma omp for schedule(dynamic, 4)
+#endif
+        for (int id = 0; id < num_branches; id++) {
+            PhyloNeighbor *dad_branch = (PhyloNeighbor*) nodes2[id]->findNeighbor(nodes1[id]);
+            PhyloNeighbor *node_branch = (PhyloNeighbor*) nodes1[id]->findNeighbor(nodes2[id]);
+            UINT score = dad_branch->partial_pars[scoreid] + node_branch->partial_pars[scoreid] +
+                added_branch->partial_pars[scoreid];
+            score = computeParsimonyInsertScore<VectorClass>(dad_branch->partial_pars, node_branch->partial_pars,
+                added_branch->partial_pars, nstates, nsites, score, thread_best);
+            if (score < thread_best) {
+                thread_best = score;
+                thread_best_id = id;
+            }
+        }
+#ifdef _OPENMP
+        #pragma omp critical
+#endif
+        if (thread_best_id >= 0 && (thread_best < best_score || (thread_best == best_score && thread_best_id < best_id))) {
+            best_score = thread_best;
+            best_id = thread_best_id;
+        }
+    }
+    return best_score;
+}
+
 /****************************************************************************
  Sankoff parsimony function
  ****************************************************************************/
@@ -27,8 +27,10 @@
 void PhyloTree::setDotProductFMA() {
 #ifdef BOOT_VAL_FLOAT
 		dotProduct = &PhyloTree::dotProductSIMD<float, Vec8f>;
+		dotProductMatrix = &PhyloTree::dotProductMatrixSIMD<float, Vec8f>;
 #else
 		dotProduct = &PhyloTree::dotProductSIMD<double, Vec4d>;
+		dotProductMatrix = &PhyloTree::dotProductMatrixSIMD<double, Vec4d>;
 #endif
         dotProductDouble = &PhyloTree::dotProductSIMD<double, Vec4d>;
 }
@@ -841,6 +841,139 @@ inline void dotProductExp(VectorClass *A, VectorClass *B, Numeric D, VectorClass
         X = mul_add(exp(A[i]*D), B[i], X);
 }
 
+#ifndef KERNEL_FIX_STATES
+/**
+    partial likelihoods of the pattern vector at offset of a node
+    @param buffer NULL if partial_lh is stored in double precision, otherwise
+        block*VectorClass::size() entries to convert the single-precision values into
+*/
+template <class VectorClass>
+inline VectorClass *loadPartialLh(double *partial_lh, size_t offset, size_t block, double *buffer) {
+    if (!buffer)
+        return (VectorClass*)(partial_lh + offset);
+    float *float_lh = (float*)partial_lh + offset;
+    size_t size = block*VectorClass::size();
+#ifdef _OPENMP
+    #pragma omp simd
+#endif
+    for (size_t i = 0; i < size; i++)
+        buffer[i] = float_lh[i];
+    return (VectorClass*)buffer;
+}
+
+/**
+    where to compute the partial likelihoods of the pattern vector at offset of a node:
+    in place, or in buffer if they are stored in single precision (see storePartialLh)
+*/
+template <class VectorClass>
+inline VectorClass *outputPartialLh(double *partial_lh, size_t offset, double *buffer) {
+    return buffer ? (VectorClass*)buffer : (VectorClass*)(partial_lh + offset);
+}
+
+/** store the partial likelihoods computed in buffer in single precision, nothing to do if buffer is NULL */
+template <class VectorClass>
+inline void storePartialLh(double *partial_lh, size_t offset, size_t block, double *buffer) {
+    if (!buffer)
+        return;
+    float *float_lh = (float*)partial_lh + offset;
+    size_t size = block*VectorClass::size();
+#ifdef _OPENMP
+    #pragma omp simd
+#endif
+    for (size_t i = 0; i < size; i++)
+        float_lh[i] = buffer[i];
+}
+
+/**
+    single-precision vector holding two consecutive pattern vectors of VectorClass,
+    for computePartialLikelihoodFloatSIMD(). load() and store() take the addresses of
+    the VectorClass::size() floats of the low and the high pattern vector
+*/
+template <class VectorClass>
+struct FloatPair;
+
+template <>
+struct FloatPair<Vec2d> {
+    typedef Vec4f type;
+    static inline Vec4f load(float *low, float *high) {
+        return _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (__m64*)low), (__m64*)high);
+    }
+    static inline void store(Vec4f const &x, float *low, float *high) {
+        _mm_storel_pi((__m64*)low, x);
+        _mm_storeh_pi((__m64*)high, x);
+    }
+};
+
+template <>
+struct FloatPair<Vec4d> {
+    typedef Vec8f type;
+    static inline Vec8f load(float *low, float *high) {
+        return Vec8f(Vec4f().load(low), Vec4f().load(high));
+    }
+    static inline void store(Vec8f const &x, float *low, float *high) {
+        x.get_low().store(low);
+        x.get_high().store(high);
+    }
+};
+
+#if MAX_VECTOR_SIZE >= 512
+template <>
+struct FloatPair<Vec8d> {
+    typedef Vec16f type;
+    static inline Vec16f load(float *low, float *high) {
+        return Vec16f(Vec8f().load(low), Vec8f().load(high));
+    }
+    static inline void store(Vec16f const &x, float *low, float *high) {
+        x.get_low().store(low);
+        x.get_high().store(high);
+    }
+};
+#endif
+
+/**
+    load block entries of the single-precision partial likelihoods of a pair of pattern vectors
+    @param partial_lh float partial_lh of a node at the low pattern vector
+*/
+template <class VectorClass>
+inline void loadFloatPair(typename FloatPair<VectorClass>::type *X, float *partial_lh, size_t block) {
+    float *high = partial_lh + block*VectorClass::size();
+    for (size_t i = 0; i < block; i++)
+        X[i] = FloatPair<VectorClass>::load(partial_lh + i*VectorClass::size(), high + i*VectorClass::size());
+}
+
+/** store block entries of a pair of pattern vectors to the single-precision partial_lh, see loadFloatPair */
+template <class VectorClass>
+inline void storeFloatPair(typename FloatPair<VectorClass>::type *X, float *partial_lh, size_t block) {
+    float *high = partial_lh + block*VectorClass::size();
+    for (size_t i = 0; i < block; i++)
+        FloatPair<VectorClass>::store(X[i], partial_lh + i*VectorClass::size(), high + i*VectorClass::size());
+}
+
+/**
+    the N single-precision partial likelihoods were computed scaled up by 2^SCALING_THRESHOLD_FLOAT_EXP,
+    so that the product of two children close to the threshold does not underflow. Keep that scaling
+    for the patterns whose maximum lh_max underflows and that are not invariant (invar = 0), and undo it
+    for the other patterns
+    @param scale_num scale number of the first pattern, that of pattern x is at scale_num[x*scale_step]
+*/
+template <class FloatVector>
+inline void unscaleFloatLikelihood(FloatVector const &lh_max, FloatVector const &invar, FloatVector *partial_lh,
+    size_t N, UBYTE *scale_num, size_t scale_step)
+{
+    auto underflown = (lh_max < 1.0f) & (invar == 0.0f);
+    if (horizontal_or(underflown)) {
+        for (size_t x = 0; x < FloatVector::size(); x++)
+            if (underflown[x])
+                scale_num[x*scale_step] += 1;
+        if (horizontal_and(underflown))
+            return;
+    }
+    FloatVector unscale = select(underflown, FloatVector(1.0f), FloatVector(ldexp(1.0f, -SCALING_THRESHOLD_FLOAT_EXP)));
+    for (size_t i = 0; i < N; i++)
+        partial_lh[i] *= unscale;
+}
+#endif
+
 #ifdef KERNEL_FIX_STATES
 template <class VectorClass, const bool SAFE_NUMERIC, const size_t nstates>
 inline void scaleLikelihood(VectorClass &lh_max, double *invar, double *dad_partial_lh, UBYTE *dad_scale_num,
@@ -1112,33 +1245,7 @@ void PhyloTree::computePartialInfo(TraversalInfo &info, VectorClass* buffer, dou
 #ifndef KERNEL_FIX_STATES
 template<class VectorClass>
 inline void computeBounds(int threads, int packets, size_t elements, vector<size_t> &limits) {
-    //It is assumed that threads divides packets evenly
-    limits.reserve(packets+1);
-    elements = roundUpToMultiple(elements, VectorClass::size());
-    size_t block_start = 0;
-    
-    for (int wave = packets/threads; wave>=1; --wave) {
-        size_t elementsThisWave = (elements-block_start);
-        if (1<wave) {
-            elementsThisWave = (elementsThisWave * 3) / 4;
-        }
-        elementsThisWave = roundUpToMultiple(elementsThisWave, VectorClass::size());
-        size_t stopElementThisWave = block_start + elementsThisWave;
-        for (int threads_to_go=threads; 1<=threads_to_go; --threads_to_go) {
-            limits.push_back(block_start);
-            size_t block_size = (stopElementThisWave - block_start)/threads_to_go;
-            block_size = roundUpToMultiple(block_size, VectorClass::size());
-            block_start += block_size;
-        }
-    }
-    limits.push_back(elements);
-    
-    if (limits.size() != packets+1) {
-        if (Params::getInstance().num_threads == 0)
-            outError("Too many threads may slow down analysis [-nt option]. Reduce threads");
-        else
-            outError("Too many threads may slow down analysis [-nt option]. Reduce threads or use -nt AUTO to automatically determine it");
-    }
+    computePacketBounds(threads, packets, elements, VectorClass::size(), limits);
 }
 #endif
 
@@ -1261,6 +1368,20 @@ void PhyloTree::computeTraversalInfo(PhyloNode *node, PhyloNode *dad, bool compu
         }
     }
 
+    if (params->lh_site_repeats) {
+        if (model->useRevKernel() && !model->isSiteSpecificModel() && !isMixlen()) {
+            size_t max_orig_nptn = roundUpToMultiple(aln->size(), VectorClass::size());
+            updateRepeatClasses(max_orig_nptn, roundUpToMultiple(max_orig_nptn+model_factory->unobserved_ptns.size(), VectorClass::size()));
+        } else {
+            // classes are not kept up to date by other kernels
+            repeat_epoch = repeat_counter;
+        }
+    }
+
+    // partition trees of PhyloSuperTreePlen share the mapping of the super tree
+    if (params->lh_scratch_dir)
+        prefetchTraversalPartialLh();
+
     if (compute_partial_lh) {
         vector<size_t> limits;
         size_t orig_nptn = roundUpToMultiple(aln->size(), VectorClass::size());
@@ -1268,13 +1389,15 @@ void PhyloTree::computeTraversalInfo(PhyloNode *node, PhyloNode *dad, bool compu
         computeBounds<VectorClass>(num_threads, num_packets, nptn, limits);
 
         #ifdef _OPENMP
-        #pragma omp parallel for schedule(dynamic,1) num_threads(num_threads)
+        #pragma omp parallel for schedule(runtime) num_threads(num_threads)
         #endif
         for (int packet_id = 0; packet_id < num_packets; ++packet_id) {
             for (auto it = traversal_info.begin(); it != traversal_info.end(); it++) {
                 computePartialLikelihood(*it, limits[packet_id], limits[packet_id+1], packet_id);
             }
         }
+        if (params->lh_scratch_dir)
+            writeBackTraversalPartialLh();
         traversal_info.clear();
     }
     return;
@@ -1349,9 +1472,15 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
             num_leaves++;
 	}
 
-    // precomputed buffer to save times
-    size_t thread_buf_size        = (2*block+nstates)*VectorClass::size();
+    // precomputed buffer to save times, the site-repeat kernel needs one more block
+    size_t thread_buf_size        = ((params->lh_site_repeats ? 3 : 2)*block+nstates+(params->lh_site_repeats ? 1 : 0))*VectorClass::size();
     double *buffer_partial_lh_ptr = buffer_partial_lh + (getBufferPartialLhSize() - thread_buf_size*num_packets);
+    // single-precision partial likelihoods (--float-lh) are computed in double one pattern vector at a time
+    double *float_dad = float_partial_lh ? buffer_float_lh + getBufferFloatLhSize()*packet_id : NULL;
+    double *float_left = float_partial_lh ? float_dad + block*VectorClass::size() : NULL;
+    double *float_right = float_partial_lh ? float_left + block*VectorClass::size() : NULL;
+    const double scaling_threshold = float_partial_lh ? SCALING_THRESHOLD_FLOAT : SCALING_THRESHOLD;
+    const int scaling_exp = float_partial_lh ? SCALING_THRESHOLD_FLOAT_EXP : SCALING_THRESHOLD_EXP;
     double *echildren = NULL;
     double *partial_lh_leaves = NULL;
 
@@ -1404,7 +1533,28 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
         len_right = etmp;
 	}
 
-    if (node->degree() > 3) {
+#ifdef KERNEL_FIX_STATES
+    if (!SITE_MODEL && float_partial_lh && node->degree() == 3) {
+        // pairs of pattern vectors in single precision, a remaining single one in double below
+        size_t float_upper = ptn_upper - (ptn_upper-ptn_lower) % (2*VectorClass::size());
+        if (float_upper > ptn_lower)
+            computePartialLikelihoodFloatSIMD<VectorClass, SAFE_NUMERIC, nstates, FMA>(info, left, right, eleft, eright,
+                partial_lh_leaves, ptn_lower, float_upper, packet_id);
+        ptn_lower = float_upper;
+        scale_size = SAFE_NUMERIC ? (ptn_upper-ptn_lower) * ncat_mix : (ptn_upper-ptn_lower);
+    }
+#endif
+
+    if (!SITE_MODEL && node->degree() == 3 && dad_branch->repeats.num_classes > 0 && dad_branch->repeats.version > repeat_epoch) {
+        /*--------------------- site repeats ------------------*/
+#ifdef KERNEL_FIX_STATES
+        computePartialRepeatsSIMD<VectorClass, SAFE_NUMERIC, nstates, FMA>(info, left, right, eleft, eright, partial_lh_leaves, ptn_lower, ptn_upper,
+            buffer_partial_lh_ptr + thread_buf_size*packet_id, packet_id);
+#else
+        computePartialRepeatsGenericSIMD<VectorClass, SAFE_NUMERIC, FMA>(info, left, right, eleft, eright, partial_lh_leaves, ptn_lower, ptn_upper,
+            buffer_partial_lh_ptr + thread_buf_size*packet_id, packet_id);
+#endif
+    } else if (node->degree() > 3) {
         /*--------------------- multifurcating node ------------------*/
 
         // now for-loop computing partial_lh over all site-patterns
@@ -1459,7 +1609,7 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
                     } else {
                         // internal node
                         VectorClass *partial_lh = partial_lh_all;
-                        VectorClass *partial_lh_child = (VectorClass*)(child->partial_lh + ptn*block);
+                        VectorClass *partial_lh_child = loadPartialLh<VectorClass>(child->partial_lh, ptn*block, block, float_left);
                         if (!SAFE_NUMERIC) {
                             for (size_t i = 0; i < VectorClass::size(); i++)
                                 dad_branch->scale_num[ptn+i] += child->scale_num[ptn+i];
@@ -1526,7 +1676,7 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
                     } else {
                         // internal node
                         VectorClass *partial_lh = partial_lh_all;
-                        VectorClass *partial_lh_child = (VectorClass*)(child->partial_lh + ptn*block);
+                        VectorClass *partial_lh_child = loadPartialLh<VectorClass>(child->partial_lh, ptn*block, block, float_left);
                         if (!SAFE_NUMERIC) {
                             for (size_t i = 0; i < VectorClass::size(); i++)
                                 dad_branch->scale_num[ptn+i] += child->scale_num[ptn+i];
@@ -1563,7 +1713,7 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
                         for (size_t x = 0; x < nstates; x++)
                             lh_max = max(lh_max,abs(partial_lh_tmp[x]));
                         // check if one should scale partial likelihoods
-                        auto underflown = ((lh_max < SCALING_THRESHOLD) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0));
+                        auto underflown = ((lh_max < scaling_threshold) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0));
                         if (horizontal_or(underflown)) { // at least one site has numerical underflown
                             for (size_t x = 0; x < VectorClass::size(); x++)
                             if (underflown[x]) {
@@ -1571,7 +1721,7 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
                                 // now do the likelihood scaling
                                 double *partial_lh = (double*)partial_lh_tmp + (x);
                                 for (size_t i = 0; i < nstates; i++)
-                                    partial_lh[i*VectorClass::size()] = ldexp(partial_lh[i*VectorClass::size()], SCALING_THRESHOLD_EXP);
+                                    partial_lh[i*VectorClass::size()] = ldexp(partial_lh[i*VectorClass::size()], scaling_exp);
                                 dad_branch->scale_num[(ptn+x)*ncat_mix+c] += 1;
                             }
                         }
@@ -1582,14 +1732,14 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
                     VectorClass lh_max = 0.0;
                     for (size_t x = 0; x < block; x++)
                         lh_max = max(lh_max,abs(partial_lh_all[x]));
-                    auto underflown = (lh_max < SCALING_THRESHOLD) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0);
+                    auto underflown = (lh_max < scaling_threshold) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0);
                     if (horizontal_or(underflown)) { // at least one site has numerical underflown
                         for (size_t x = 0; x < VectorClass::size(); x++) {
                             if (underflown[x]) {
                                 double *partial_lh = (double*)partial_lh_all + (x);
                                 // now do the likelihood scaling
                                 for (size_t i = 0; i < block; i++) {
-                                    partial_lh[i*VectorClass::size()] = ldexp(partial_lh[i*VectorClass::size()], SCALING_THRESHOLD_EXP);
+                                    partial_lh[i*VectorClass::size()] = ldexp(partial_lh[i*VectorClass::size()], scaling_exp);
                                 }
                                 //                        sum_scale += LOG_SCALING_THRESHOLD * ptn_freq[ptn+x];
                                 dad_branch->scale_num[ptn+x] += 1;
@@ -1603,7 +1753,7 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
         
             // compute dot-product with inv_eigenvector
             VectorClass *partial_lh_tmp = partial_lh_all;
-            VectorClass *partial_lh = (VectorClass*)(dad_branch->partial_lh + ptn*block);
+            VectorClass *partial_lh = outputPartialLh<VectorClass>(dad_branch->partial_lh, ptn*block, float_dad);
             VectorClass lh_max = 0.0;
             double *inv_evec_ptr = SITE_MODEL ? &inv_evec[ptn*states_square] : NULL;
             for (size_t c = 0; c < ncat_mix; c++) {
@@ -1625,6 +1775,7 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
                 partial_lh += nstates;
                 partial_lh_tmp += nstates;
             }
+            storePartialLh<VectorClass>(dad_branch->partial_lh, ptn*block, block, float_dad);
 
         } // for ptn
 
@@ -1648,7 +1799,7 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
         auto unknown = aln->STATE_UNKNOWN;
 
         for (size_t ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size()) {
-            VectorClass *partial_lh = (VectorClass*)(dad_branch->partial_lh + ptn*block);
+            VectorClass *partial_lh = outputPartialLh<VectorClass>(dad_branch->partial_lh, ptn*block, float_dad);
 
             if (SITE_MODEL) {
                 VectorClass* expleft = (VectorClass*) vec_left;
@@ -1742,6 +1893,7 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
                     partial_lh += nstates;
                 } // FOR category
             } // IF SITE_MODEL
+            storePartialLh<VectorClass>(dad_branch->partial_lh, ptn*block, block, float_dad);
 		} // FOR LOOP
 
 
@@ -1765,8 +1917,9 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
         auto unknown = aln->STATE_UNKNOWN;
         
         for (size_t ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size()) {
-            VectorClass *partial_lh = (VectorClass*)(dad_branch->partial_lh + ptn*block);
-            VectorClass *partial_lh_right = (VectorClass*)(right->partial_lh + ptn*block);
+            VectorClass *partial_lh_dad = outputPartialLh<VectorClass>(dad_branch->partial_lh, ptn*block, float_dad);
+            VectorClass *partial_lh = partial_lh_dad;
+            VectorClass *partial_lh_right = loadPartialLh<VectorClass>(right->partial_lh, ptn*block, block, float_right);
             VectorClass lh_max = 0.0;
 
             if (SITE_MODEL) {
@@ -1798,15 +1951,15 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
 #endif
                     // check if one should scale partial likelihoods
                     if (SAFE_NUMERIC) {
-                        auto underflown = ((lh_max < SCALING_THRESHOLD) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0));
+                        auto underflown = ((lh_max < scaling_threshold) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0));
                         if (horizontal_or(underflown)) { // at least one site has numerical underflown
                             for (size_t x = 0; x < VectorClass::size(); x++)
                             if (underflown[x]) {
                                 // BQM 2016-05-03: only scale for non-constant sites
                                 // now do the likelihood scaling
-                                double *partial_lh = dad_branch->partial_lh + (ptn*block + c*nstates*VectorClass::size() + x);
+                                double *partial_lh = (double*)partial_lh_dad + (c*nstates*VectorClass::size() + x);
                                 for (size_t i = 0; i < nstates; i++)
-                                    partial_lh[i*VectorClass::size()] = ldexp(partial_lh[i*VectorClass::size()], SCALING_THRESHOLD_EXP);
+                                    partial_lh[i*VectorClass::size()] = ldexp(partial_lh[i*VectorClass::size()], scaling_exp);
                                 dad_branch->scale_num[(ptn+x)*ncat_mix+c] += 1;
                             }
                         }
@@ -1866,15 +2019,15 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
     #endif
                     // check if one should scale partial likelihoods
                     if (SAFE_NUMERIC) {
-                        auto underflown = ((lh_max < SCALING_THRESHOLD) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0));
+                        auto underflown = ((lh_max < scaling_threshold) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0));
                         if (horizontal_or(underflown)) { // at least one site has numerical underflown
                             for (size_t x = 0; x < VectorClass::size(); x++) {
                                 if (underflown[x]) {
                                     // BQM 2016-05-03: only scale for non-constant sites
                                     // now do the likelihood scaling
-                                    double *partial_lh = dad_branch->partial_lh + (ptn*block + c*nstates*VectorClass::size() + x);
+                                    double *partial_lh = (double*)partial_lh_dad + (c*nstates*VectorClass::size() + x);
                                     for (size_t i = 0; i < nstates; i++)
-                                        partial_lh[i*VectorClass::size()] = ldexp(partial_lh[i*VectorClass::size()], SCALING_THRESHOLD_EXP);
+                                        partial_lh[i*VectorClass::size()] = ldexp(partial_lh[i*VectorClass::size()], scaling_exp);
                                     dad_branch->scale_num[(ptn+x)*ncat_mix+c] += 1;
                                 }
                             }
@@ -1887,20 +2040,21 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
             } // IF SITE_MODEL
 
             if (!SAFE_NUMERIC) {
-                auto underflown = (lh_max < SCALING_THRESHOLD) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0);
+                auto underflown = (lh_max < scaling_threshold) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0);
                 if (horizontal_or(underflown)) { // at least one site has numerical underflown
                     for (size_t x = 0; x < VectorClass::size(); x++)
                     if (underflown[x]) {
-                        double *partial_lh = dad_branch->partial_lh + (ptn*block + x);
+                        double *partial_lh = (double*)partial_lh_dad + (x);
                         // now do the likelihood scaling
                         for (size_t i = 0; i < block; i++) {
-                            partial_lh[i*VectorClass::size()] = ldexp(partial_lh[i*VectorClass::size()], SCALING_THRESHOLD_EXP);
+                            partial_lh[i*VectorClass::size()] = ldexp(partial_lh[i*VectorClass::size()], scaling_exp);
                         }
 //                        sum_scale += LOG_SCALING_THRESHOLD * ptn_freq[ptn+x];
                         dad_branch->scale_num[ptn+x] += 1;
                     }
                 }
             }
+            storePartialLh<VectorClass>(dad_branch->partial_lh, ptn*block, block, float_dad);
 
 		} // big for loop over ptn
 
@@ -1911,9 +2065,10 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
         VectorClass *partial_lh_tmp
             = (VectorClass*)(buffer_partial_lh_ptr + thread_buf_size * packet_id);
 		for (size_t ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size()) {
-			VectorClass *partial_lh = (VectorClass*)(dad_branch->partial_lh + ptn*block);
-			VectorClass *partial_lh_left = (VectorClass*)(left->partial_lh + ptn*block);
-			VectorClass *partial_lh_right = (VectorClass*)(right->partial_lh + ptn*block);
+			VectorClass *partial_lh_dad = outputPartialLh<VectorClass>(dad_branch->partial_lh, ptn*block, float_dad);
+			VectorClass *partial_lh = partial_lh_dad;
+			VectorClass *partial_lh_left = loadPartialLh<VectorClass>(left->partial_lh, ptn*block, block, float_left);
+			VectorClass *partial_lh_right = loadPartialLh<VectorClass>(right->partial_lh, ptn*block, block, float_right);
             VectorClass lh_max = 0.0;
             UBYTE *scale_dad, *scale_left, *scale_right;
 
@@ -1992,15 +2147,15 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
 
                 // check if one should scale partial likelihoods
                 if (SAFE_NUMERIC) {
-                    auto underflown = ((lh_max < SCALING_THRESHOLD) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0));
+                    auto underflown = ((lh_max < scaling_threshold) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0));
                     if (horizontal_or(underflown))
                         for (size_t x = 0; x < VectorClass::size(); x++)
                         if (underflown[x]) {
                             // BQM 2016-05-03: only scale for non-constant sites
                             // now do the likelihood scaling
-                            double *partial_lh = dad_branch->partial_lh + (ptn*block + c*nstates*VectorClass::size() + x);
+                            double *partial_lh = (double*)partial_lh_dad + (c*nstates*VectorClass::size() + x);
                             for (size_t i = 0; i < nstates; i++)
-                                partial_lh[i*VectorClass::size()] = ldexp(partial_lh[i*VectorClass::size()], SCALING_THRESHOLD_EXP);
+                                partial_lh[i*VectorClass::size()] = ldexp(partial_lh[i*VectorClass::size()], scaling_exp);
                             scale_dad[x*ncat_mix] += 1;
                         }
                     scale_dad++;
@@ -2014,20 +2169,21 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
 
             if (!SAFE_NUMERIC) {
                 // check if one should scale partial likelihoods
-                auto underflown = (lh_max < SCALING_THRESHOLD) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0);
+                auto underflown = (lh_max < scaling_threshold) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0);
                 if (horizontal_or(underflown)) { // at least one site has numerical underflown
                     for (size_t x = 0; x < VectorClass::size(); x++)
                     if (underflown[x]) {
-                        double *partial_lh = dad_branch->partial_lh + (ptn*block + x);
+                        double *partial_lh = (double*)partial_lh_dad + (x);
                         // now do the likelihood scaling
                         for (size_t i = 0; i < block; i++) {
-                            partial_lh[i*VectorClass::size()] = ldexp(partial_lh[i*VectorClass::size()], SCALING_THRESHOLD_EXP);
+                            partial_lh[i*VectorClass::size()] = ldexp(partial_lh[i*VectorClass::size()], scaling_exp);
                         }
 //                        sum_scale += LOG_SCALING_THRESHOLD * ptn_freq[ptn+x];
                         dad_branch->scale_num[ptn+x] += 1;
                     }
                 }
             }
+            storePartialLh<VectorClass>(dad_branch->partial_lh, ptn*block, block, float_dad);
         } // big for loop over ptn
     }
 
@@ -2038,6 +2194,430 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info
 
 }
 
+#ifdef KERNEL_FIX_STATES
+/*******************************************************
+ *
+ * partial likelihood of a bifurcating node in single precision (--float-lh)
+ *
+ ******************************************************/
+
+template <class VectorClass, const bool SAFE_NUMERIC, const int nstates, const bool FMA>
+void PhyloTree::computePartialLikelihoodFloatSIMD(TraversalInfo &info, PhyloNeighbor *left, PhyloNeighbor *right,
+    double *eleft, double *eright, double *partial_lh_leaves, size_t ptn_lower, size_t ptn_upper, int packet_id)
+{
+    typedef FloatPair<VectorClass> Pair;
+    typedef typename Pair::type FloatVector;
+    const size_t V = VectorClass::size();
+    const size_t FV = FloatVector::size();
+    PhyloNeighbor *dad_branch = info.dad_branch;
+    size_t orig_nptn = aln->size();
+    size_t max_orig_nptn = roundUpToMultiple(orig_nptn, V);
+    size_t nptn = max_orig_nptn+model_factory->unobserved_ptns.size();
+    size_t ncat_mix = (model_factory->fused_mix_rate) ? site_rate->getNRate() : site_rate->getNRate()*model->getNMixtures();
+    size_t block = nstates * ncat_mix;
+    size_t leaf_block = (aln->STATE_UNKNOWN+1)*block;
+    size_t scale_size = SAFE_NUMERIC ? (ptn_upper-ptn_lower) * ncat_mix : (ptn_upper-ptn_lower);
+    auto unknown = aln->STATE_UNKNOWN;
+
+    // workspace of this packet, see getBufferFloatLhSize()
+    FloatVector *vec_left = (FloatVector*)(buffer_float_lh + getBufferFloatLhSize()*packet_id);
+    FloatVector *vec_right = vec_left + block;
+    FloatVector *partial_lh_all = vec_right + block;
+    FloatVector *partial_lh_tmp = partial_lh_all + block;
+    float *inv_evec = (float*)(partial_lh_tmp + nstates);
+    float *float_eleft = inv_evec + nstates*nstates;
+    float *float_eright = float_eleft + block*nstates;
+    float *float_leaves = float_eright + block*nstates;
+
+    // flush subnormal floats to zero: the scaled-up child keeps the maximum of a pattern in the normal
+    // range, but entries far below it would otherwise take the slow subnormal path
+    uint32_t control_word = get_control_word();
+    no_subnormals();
+
+    // no mixture (useFloatPartialLh), all categories share the inverse eigenvectors
+    double *model_inv_evec = model->getInverseEigenvectors();
+    for (size_t i = 0; i < nstates*nstates; i++)
+        inv_evec[i] = model_inv_evec[i];
+    // left is a leaf if one of the children is
+    size_t num_leaves = (left->node->isLeaf() ? 1 : 0) + (right->node->isLeaf() ? 1 : 0);
+    for (size_t i = 0; i < leaf_block*num_leaves; i++)
+        float_leaves[i] = partial_lh_leaves[i];
+    // scale up one internal child, see unscaleFloatLikelihood()
+    float scale_up = ldexp(1.0f, SCALING_THRESHOLD_FLOAT_EXP);
+    if (!left->node->isLeaf())
+        for (size_t i = 0; i < block*nstates; i++)
+            float_eleft[i] = eleft[i] * scale_up;
+    if (!right->node->isLeaf()) {
+        float scale_right = left->node->isLeaf() ? scale_up : 1.0f;
+        for (size_t i = 0; i < block*nstates; i++)
+            float_eright[i] = eright[i] * scale_right;
+    }
+
+    if (left->node->isLeaf() && right->node->isLeaf()) {
+
+        /*--------------------- TIP-TIP (cherry) case ------------------*/
+
+        float *partial_lh_left = float_leaves;
+        float *partial_lh_right = float_leaves + leaf_block;
+        // scale number must be ZERO
+        memset(dad_branch->scale_num + (SAFE_NUMERIC ? ptn_lower*ncat_mix : ptn_lower), 0, scale_size * sizeof(UBYTE));
+        auto leftStateRow  = this->getConvertedSequenceByNumber(left->node->id);
+        auto rightStateRow = this->getConvertedSequenceByNumber(right->node->id);
+
+        for (size_t ptn = ptn_lower; ptn < ptn_upper; ptn += FV) {
+            // load data for tip
+            for (size_t x = 0; x < FV; x++) {
+                int leftState;
+                int rightState;
+                if (ptn+x < orig_nptn) {
+                    leftState  = leftStateRow ? leftStateRow[ptn+x] : (aln->at(ptn+x))[left->node->id];
+                    rightState = rightStateRow ? rightStateRow[ptn+x] : (aln->at(ptn+x))[right->node->id];
+                } else if (ptn+x >= max_orig_nptn && ptn+x < nptn) {
+                    leftState  = model_factory->unobserved_ptns[ptn+x-max_orig_nptn][left->node->id];
+                    rightState = model_factory->unobserved_ptns[ptn+x-max_orig_nptn][right->node->id];
+                } else {
+                    leftState  = unknown;
+                    rightState = unknown;
+                }
+                float *tip_left  = partial_lh_left  + block*leftState;
+                float *tip_right = partial_lh_right + block*rightState;
+                float *this_vec_left  = (float*)vec_left + x;
+                float *this_vec_right = (float*)vec_right + x;
+                for (size_t i = 0; i < block; i++) {
+                    this_vec_left[i*FV]  = tip_left[i];
+                    this_vec_right[i*FV] = tip_right[i];
+                }
+            }
+
+            FloatVector *vleft = vec_left;
+            FloatVector *vright = vec_right;
+            FloatVector *partial_lh = partial_lh_all;
+            for (size_t c = 0; c < ncat_mix; c++) {
+                // compute real partial likelihood vector
+                for (size_t x = 0; x < nstates; x++)
+                    partial_lh_tmp[x] = vleft[x] * vright[x];
+                // compute dot-product with inv_eigenvector
+                productVecMat<FloatVector, float, nstates, FMA>(partial_lh_tmp, inv_evec, partial_lh);
+                vleft += nstates;
+                vright += nstates;
+                partial_lh += nstates;
+            }
+            storeFloatPair<VectorClass>(partial_lh_all, (float*)dad_branch->partial_lh + ptn*block, block);
+        }
+
+    } else if (left->node->isLeaf()) {
+
+        /*--------------------- TIP-INTERNAL NODE case ------------------*/
+
+        // only take scale_num from the right subtree
+        memcpy(
+            dad_branch->scale_num + (SAFE_NUMERIC ? ptn_lower*ncat_mix : ptn_lower),
+            right->scale_num + (SAFE_NUMERIC ? ptn_lower*ncat_mix : ptn_lower),
+            scale_size * sizeof(UBYTE));
+        float *partial_lh_left = float_leaves;
+        auto leftStateRow = this->getConvertedSequenceByNumber(left->node->id);
+
+        for (size_t ptn = ptn_lower; ptn < ptn_upper; ptn += FV) {
+            // load data for tip
+            for (size_t x = 0; x < FV; x++) {
+                int state;
+                if (ptn+x < orig_nptn)
+                    state = leftStateRow ? leftStateRow[ptn+x] : (aln->at(ptn+x))[left->node->id];
+                else if (ptn+x >= max_orig_nptn && ptn+x < nptn)
+                    state = model_factory->unobserved_ptns[ptn+x-max_orig_nptn][left->node->id];
+                else
+                    state = unknown;
+                float *tip = partial_lh_left + block*state;
+                float *this_vec_left = (float*)vec_left + x;
+                for (size_t i = 0; i < block; i++)
+                    this_vec_left[i*FV] = tip[i];
+            }
+            loadFloatPair<VectorClass>(vec_right, (float*)right->partial_lh + ptn*block, block);
+            FloatVector invar = compress(VectorClass().load_a(&ptn_invar[ptn]), VectorClass().load_a(&ptn_invar[ptn+V]));
+
+            FloatVector *vleft = vec_left;
+            FloatVector *partial_lh_right = vec_right;
+            FloatVector *partial_lh = partial_lh_all;
+            FloatVector lh_max = 0.0f;
+            float *eright_ptr = float_eright;
+            for (size_t c = 0; c < ncat_mix; c++) {
+                if (SAFE_NUMERIC)
+                    lh_max = 0.0f;
+                // compute real partial likelihood vector
+                for (size_t x = 0; x < nstates; x++) {
+                    FloatVector vright;
+                    dotProductVec<FloatVector, float, nstates, FMA>(eright_ptr, partial_lh_right, vright);
+                    eright_ptr += nstates;
+                    partial_lh_tmp[x] = vleft[x] * vright;
+                }
+                // compute dot-product with inv_eigenvector
+                productVecMat<FloatVector, float, nstates, FMA>(partial_lh_tmp, inv_evec, partial_lh, lh_max);
+                // check if one should scale partial likelihoods
+                if (SAFE_NUMERIC)
+                    unscaleFloatLikelihood(lh_max, invar, partial_lh, nstates, dad_branch->scale_num + ptn*ncat_mix + c, ncat_mix);
+                vleft += nstates;
+                partial_lh_right += nstates;
+                partial_lh += nstates;
+            }
+            if (!SAFE_NUMERIC)
+                unscaleFloatLikelihood(lh_max, invar, partial_lh_all, block, dad_branch->scale_num + ptn, 1);
+            storeFloatPair<VectorClass>(partial_lh_all, (float*)dad_branch->partial_lh + ptn*block, block);
+        }
+
+    } else {
+
+        /*--------------------- INTERNAL-INTERNAL NODE case ------------------*/
+
+        for (size_t ptn = ptn_lower; ptn < ptn_upper; ptn += FV) {
+            loadFloatPair<VectorClass>(vec_left, (float*)left->partial_lh + ptn*block, block);
+            loadFloatPair<VectorClass>(vec_right, (float*)right->partial_lh + ptn*block, block);
+            FloatVector invar = compress(VectorClass().load_a(&ptn_invar[ptn]), VectorClass().load_a(&ptn_invar[ptn+V]));
+            UBYTE *scale_dad, *scale_left, *scale_right;
+            if (SAFE_NUMERIC) {
+                size_t addr = ptn*ncat_mix;
+                scale_dad   = dad_branch->scale_num + addr;
+                scale_left  = left->scale_num + addr;
+                scale_right = right->scale_num + addr;
+            } else {
+                scale_dad   = dad_branch->scale_num + ptn;
+                scale_left  = left->scale_num + ptn;
+                scale_right = right->scale_num + ptn;
+                for (size_t i = 0; i < FV; i++)
+                    scale_dad[i] = scale_left[i] + scale_right[i];
+            }
+
+            FloatVector *partial_lh_left = vec_left;
+            FloatVector *partial_lh_right = vec_right;
+            FloatVector *partial_lh = partial_lh_all;
+            FloatVector lh_max = 0.0f;
+            float *eleft_ptr = float_eleft;
+            float *eright_ptr = float_eright;
+            for (size_t c = 0; c < ncat_mix; c++) {
+                if (SAFE_NUMERIC) {
+                    lh_max = 0.0f;
+                    for (size_t x = 0; x < FV; x++)
+                        scale_dad[x*ncat_mix] = scale_left[x*ncat_mix] + scale_right[x*ncat_mix];
+                }
+                // compute real partial likelihood vector
+                for (size_t x = 0; x < nstates; x++) {
+                    dotProductDualVec<FloatVector, float, nstates, FMA>(eleft_ptr, partial_lh_left, eright_ptr, partial_lh_right, partial_lh_tmp[x]);
+                    eleft_ptr += nstates;
+                    eright_ptr += nstates;
+                }
+                // compute dot-product with inv_eigenvector
+                productVecMat<FloatVector, float, nstates, FMA>(partial_lh_tmp, inv_evec, partial_lh, lh_max);
+                // check if one should scale partial likelihoods
+                if (SAFE_NUMERIC) {
+                    unscaleFloatLikelihood(lh_max, invar, partial_lh, nstates, scale_dad, ncat_mix);
+                    scale_dad++;
+                    scale_left++;
+                    scale_right++;
+                }
+                partial_lh_left += nstates;
+                partial_lh_right += nstates;
+                partial_lh += nstates;
+            }
+            if (!SAFE_NUMERIC)
+                unscaleFloatLikelihood(lh_max, invar, partial_lh_all, block, scale_dad, 1);
+            storeFloatPair<VectorClass>(partial_lh_all, (float*)dad_branch->partial_lh + ptn*block, block);
+        }
+    }
+    set_control_word(control_word);
+}
+#endif
+
+/*******************************************************
+ *
+ * partial likelihood of a bifurcating node, computed once per repeat class
+ *
+ ******************************************************/
+
+#ifdef KERNEL_FIX_STATES
+template <class VectorClass, const bool SAFE_NUMERIC, const int nstates, const bool FMA>
+void PhyloTree::computePartialRepeatsSIMD(TraversalInfo &info, PhyloNeighbor *left, PhyloNeighbor *right,
+    double *eleft, double *eright, double *partial_lh_leaves, size_t ptn_lower, size_t ptn_upper,
+    double *buffer, int packet_id)
+#else
+template <class VectorClass, const bool SAFE_NUMERIC, const bool FMA>
+void PhyloTree::computePartialRepeatsGenericSIMD(TraversalInfo &info, PhyloNeighbor *left, PhyloNeighbor *right,
+    double *eleft, double *eright, double *partial_lh_leaves, size_t ptn_lower, size_t ptn_upper,
+    double *buffer, int packet_id)
+#endif
+{
+    PhyloNeighbor *dad_branch = info.dad_branch;
+#ifndef KERNEL_FIX_STATES
+    size_t nstates = aln->num_states;
+#endif
+    const size_t V = VectorClass::size();
+    size_t max_orig_nptn = roundUpToMultiple(aln->size(), V);
+    size_t ncat = site_rate->getNRate();
+    size_t ncat_mix = (model_factory->fused_mix_rate) ? ncat : ncat*model->getNMixtures();
+    ASSERT(packet_id < repeat_workspace.size());
+    RepeatWorkspace &ws = repeat_workspace[packet_id];
+    ws.mix_addr.resize(ncat_mix);
+    size_t *mix_addr = ws.mix_addr.data();
+    size_t denom = (model_factory->fused_mix_rate) ? 1 : ncat;
+    for (size_t c = 0; c < ncat_mix; c++)
+        mix_addr[c] = (c/denom)*nstates*nstates;
+    size_t block = nstates * ncat_mix;
+    size_t scale_block = SAFE_NUMERIC ? ncat_mix : 1;
+    double *inv_evec = model->getInverseEigenvectors();
+    bool left_leaf = left->node->isLeaf(), right_leaf = right->node->isLeaf();
+    double *partial_lh_right_leaf = partial_lh_leaves + (left_leaf && right_leaf ? (aln->STATE_UNKNOWN+1)*block : 0);
+
+    // representative (first) pattern of each class occurring in [ptn_lower, ptn_upper)
+    int *pattern_class = dad_branch->repeats.pattern_class.data();
+    size_t num_ptns = ptn_upper-ptn_lower;
+    ws.class_rep.resize(dad_branch->repeats.num_classes, SIZE_MAX);
+    ws.reps.resize(num_ptns);
+    ws.rep_start.resize(num_ptns+1);
+    ws.rep_ptns.resize(num_ptns);
+    ws.scale.resize(V*scale_block);
+    size_t *class_rep = ws.class_rep.data(), *reps = ws.reps.data();
+    size_t *rep_start = ws.rep_start.data(), *rep_ptns = ws.rep_ptns.data();
+    UBYTE *scale = ws.scale.data();
+    size_t num_reps = 0;
+    for (size_t ptn = ptn_lower; ptn < ptn_upper; ptn++) {
+        size_t &rep = class_rep[pattern_class[ptn]];
+        if (rep == SIZE_MAX) {
+            rep = num_reps;
+            reps[num_reps++] = ptn;
+        }
+    }
+
+    // patterns sorted by representative: count, prefix sums, place, shift back
+    memset(rep_start, 0, sizeof(size_t)*(num_reps+1));
+    for (size_t ptn = ptn_lower; ptn < ptn_upper; ptn++)
+        rep_start[class_rep[pattern_class[ptn]]+1]++;
+    for (size_t i = 0; i < num_reps; i++)
+        rep_start[i+1] += rep_start[i];
+    for (size_t ptn = ptn_lower; ptn < ptn_upper; ptn++)
+        rep_ptns[rep_start[class_rep[pattern_class[ptn]]]++] = ptn;
+    for (size_t i = num_reps; i > 0; i--)
+        rep_start[i] = rep_start[i-1];
+    rep_start[0] = 0;
+    // leave class_rep unset for the next call
+    for (size_t i = 0; i < num_reps; i++)
+        class_rep[pattern_class[reps[i]]] = SIZE_MAX;
+
+    VectorClass *vec_left = (VectorClass*)buffer;
+    VectorClass *vec_right = vec_left + block;
+    VectorClass *vec_out = vec_right + block;
+    VectorClass *partial_lh_tmp = vec_out + block;
+    double *invar = (double*)(partial_lh_tmp + nstates);
+
+    // V representatives at a time, the last one repeated to fill up the vector
+    for (size_t first = 0; first < num_reps; first += V) {
+        for (size_t x = 0; x < V; x++) {
+            size_t ptn = reps[min(first+x, num_reps-1)];
+            size_t addr = (ptn - ptn % V)*block + ptn % V;
+            invar[x] = ptn_invar[ptn];
+            double *src_left = left_leaf
+                ? partial_lh_leaves + block*getPatternState((PhyloNode*)left->node, ptn, max_orig_nptn)
+                : left->partial_lh + addr;
+            double *src_right = right_leaf
+                ? partial_lh_right_leaf + block*getPatternState((PhyloNode*)right->node, ptn, max_orig_nptn)
+                : right->partial_lh + addr;
+            size_t left_stride = left_leaf ? 1 : V, right_stride = right_leaf ? 1 : V;
+            double *this_vec_left = (double*)vec_left + x, *this_vec_right = (double*)vec_right + x;
+            for (size_t i = 0; i < block; i++) {
+                this_vec_left[i*V] = src_left[i*left_stride];
+                this_vec_right[i*V] = src_right[i*right_stride];
+            }
+            for (size_t c = 0; c < scale_block; c++) {
+                UBYTE child_scale = 0;
+                if (!left_leaf)
+                    child_scale += left->scale_num[ptn*scale_block+c];
+                if (!right_leaf)
+                    child_scale += right->scale_num[ptn*scale_block+c];
+                scale[x*scale_block+c] = child_scale;
+            }
+        }
+
+        // same arithmetic as computePartialLikelihoodSIMD, so results are identical
+        VectorClass vinvar = VectorClass().load(invar);
+        VectorClass *vleft = vec_left, *vright = vec_right, *partial_lh = vec_out;
+        double *eleft_ptr = eleft, *eright_ptr = eright;
+        VectorClass lh_max = 0.0;
+        for (size_t c = 0; c < ncat_mix; c++) {
+            double *inv_evec_ptr = inv_evec + mix_addr[c];
+            if (left_leaf && right_leaf) {
+                for (size_t x = 0; x < nstates; x++)
+                    partial_lh_tmp[x] = vleft[x] * vright[x];
+#ifdef KERNEL_FIX_STATES
+                productVecMat<VectorClass, double, nstates, FMA>(partial_lh_tmp, inv_evec_ptr, partial_lh);
+#else
+                productVecMat<VectorClass, double, FMA> (partial_lh_tmp, inv_evec_ptr, partial_lh, nstates);
+#endif
+            } else {
+                if (SAFE_NUMERIC)
+                    lh_max = 0.0;
+                for (size_t x = 0; x < nstates; x++) {
+                    if (left_leaf) {
+                        VectorClass vright_x;
+#ifdef KERNEL_FIX_STATES
+                        dotProductVec<VectorClass, double, nstates, FMA>(eright_ptr, vright, vright_x);
+#else
+                        dotProductVec<VectorClass, double, FMA>(eright_ptr, vright, vright_x, nstates);
+#endif
+                        partial_lh_tmp[x] = vleft[x] * (vright_x);
+                    } else {
+#ifdef KERNEL_FIX_STATES
+                        dotProductDualVec<VectorClass, double, nstates, FMA>(eleft_ptr, vleft, eright_ptr, vright, partial_lh_tmp[x]);
+#else
+                        dotProductDualVec<VectorClass, double, FMA>(eleft_ptr, vleft, eright_ptr, vright, partial_lh_tmp[x], nstates);
+#endif
+                        eleft_ptr += nstates;
+                    }
+                    eright_ptr += nstates;
+                }
+#ifdef KERNEL_FIX_STATES
+                productVecMat<VectorClass, double, nstates, FMA>(partial_lh_tmp, inv_evec_ptr, partial_lh, lh_max);
+#else
+                productVecMat<VectorClass, double, FMA> (partial_lh_tmp, inv_evec_ptr, partial_lh, lh_max, nstates);
+#endif
+                if (SAFE_NUMERIC) {
+                    auto underflown = ((lh_max < SCALING_THRESHOLD) & (vinvar == 0.0));
+                    if (horizontal_or(underflown))
+                        for (size_t x = 0; x < V; x++)
+                        if (underflown[x]) {
+                            double *this_partial_lh = (double*)partial_lh + x;
+                            for (size_t i = 0; i < nstates; i++)
+                                this_partial_lh[i*V] = ldexp(this_partial_lh[i*V], SCALING_THRESHOLD_EXP);
+                            scale[x*ncat_mix+c] += 1;
+                        }
+                }
+            }
+            vleft += nstates;
+            vright += nstates;
+            partial_lh += nstates;
+        }
+        if (!SAFE_NUMERIC && !(left_leaf && right_leaf)) {
+            auto underflown = (lh_max < SCALING_THRESHOLD) & (vinvar == 0.0);
+            if (horizontal_or(underflown))
+                for (size_t x = 0; x < V; x++)
+                if (underflown[x]) {
+                    double *this_partial_lh = (double*)vec_out + x;
+                    for (size_t i = 0; i < block; i++)
+                        this_partial_lh[i*V] = ldexp(this_partial_lh[i*V], SCALING_THRESHOLD_EXP);
+                    scale[x] += 1;
+                }
+        }
+
+        // copy the result of each representative to all patterns of its class
+        for (size_t x = 0; x < V && first+x < num_reps; x++) {
+            double *src = (double*)vec_out + x;
+            for (size_t j = rep_start[first+x]; j < rep_start[first+x+1]; j++) {
+                size_t ptn = rep_ptns[j];
+                double *dst = dad_branch->partial_lh + (ptn - ptn % V)*block + ptn % V;
+                for (size_t i = 0; i < block; i++)
+                    dst[i*V] = src[i*V];
+                memcpy(dad_branch->scale_num + ptn*scale_block, scale + x*scale_block, scale_block*sizeof(UBYTE));
+            }
+        }
+    }
+}
+
 /*******************************************************
  *
  * NEW! highly-vectorized log-likelihood derivative function
@@ -2082,6 +2662,11 @@ void PhyloTree::computeLikelihoodBufferGenericSIMD(PhyloNeighbor *dad_branch, Ph
         size_t nmix = getMixlen();
         buffer_partial_lh_ptr += nmix*(nmix+1)*VectorClass::size() + (nmix+3)*nmix*VectorClass::size()*num_packets;
     }
+    // single-precision partial likelihoods (--float-lh), converted one pattern vector at a time
+    double *float_dad = float_partial_lh ? buffer_float_lh + getBufferFloatLhSize()*packet_id : NULL;
+    double *float_node = float_partial_lh ? float_dad + block*VectorClass::size() : NULL;
+    const double scaling_threshold = float_partial_lh ? SCALING_THRESHOLD_FLOAT : SCALING_THRESHOLD;
+    const double log_scaling_threshold = float_partial_lh ? LOG_SCALING_THRESHOLD_FLOAT : LOG_SCALING_THRESHOLD;
 
     // first compute partial_lh
     for (auto it = traversal_info.begin(); it != traversal_info.end(); it++) {
@@ -2098,7 +2683,7 @@ void PhyloTree::computeLikelihoodBufferGenericSIMD(PhyloNeighbor *dad_branch, Ph
         size_t offset     = ptn_lower*block;
         size_t offsetStep = block*VectorClass::size();
         for (size_t ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size(), offset+=offsetStep) {
-            VectorClass *partial_lh_dad = (VectorClass*)(dad_branch->partial_lh + offset);
+            VectorClass *partial_lh_dad = loadPartialLh<VectorClass>(dad_branch->partial_lh, offset, block, float_dad);
             VectorClass *theta = (VectorClass*)(theta_all + offset);
             //load tip vector
             if (!SITE_MODEL) {
@@ -2155,7 +2740,7 @@ void PhyloTree::computeLikelihoodBufferGenericSIMD(PhyloNeighbor *dad_branch, Ph
                         if (scale_dad[c] == min_scale+1) {
                             double *this_theta = &theta_all[ptn*block + c*nstates*VectorClass::size() + i];
                             for (size_t x = 0; x < nstates; x++) {
-                                this_theta[x*VectorClass::size()] *= SCALING_THRESHOLD;
+                                this_theta[x*VectorClass::size()] *= scaling_threshold;
                             }
                         } else if (scale_dad[c] > min_scale+1) {
                             double *this_theta = &theta_all[ptn*block + c*nstates*VectorClass::size() + i];
@@ -2172,7 +2757,7 @@ void PhyloTree::computeLikelihoodBufferGenericSIMD(PhyloNeighbor *dad_branch, Ph
                 }
             }
             VectorClass *buf = (VectorClass*)(buffer_scale_all+ptn);
-            *buf *= LOG_SCALING_THRESHOLD;
+            *buf *= log_scaling_threshold;
 
         } // FOR PTN LOOP
 //            aligned_free(vec_tip);
@@ -2182,8 +2767,8 @@ void PhyloTree::computeLikelihoodBufferGenericSIMD(PhyloNeighbor *dad_branch, Ph
         // now compute theta
         for (size_t ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size()) {
             VectorClass *theta = (VectorClass*)(theta_all + ptn*block);
-            VectorClass *partial_lh_node = (VectorClass*)(node_branch->partial_lh + ptn*block);
-            VectorClass *partial_lh_dad = (VectorClass*)(dad_branch->partial_lh + ptn*block);
+            VectorClass *partial_lh_node = loadPartialLh<VectorClass>(node_branch->partial_lh, ptn*block, block, float_node);
+            VectorClass *partial_lh_dad = loadPartialLh<VectorClass>(dad_branch->partial_lh, ptn*block, block, float_dad);
             for (size_t i = 0; i < block; i++) {
                 theta[i] = partial_lh_node[i] * partial_lh_dad[i];
             }
@@ -2207,7 +2792,7 @@ void PhyloTree::computeLikelihoodBufferGenericSIMD(PhyloNeighbor *dad_branch, Ph
                         if (sum_scale[c] == min_scale+1) {
                             double *this_theta = &theta_all[ptn*block + c*nstates*VectorClass::size() + i];
                             for (size_t x = 0; x < nstates; x++) {
-                                this_theta[x*VectorClass::size()] *= SCALING_THRESHOLD;
+                                this_theta[x*VectorClass::size()] *= scaling_threshold;
                             }
                         } else if (sum_scale[c] > min_scale+1) {
                             double *this_theta = &theta_all[ptn*block + c*nstates*VectorClass::size() + i];
@@ -2225,7 +2810,7 @@ void PhyloTree::computeLikelihoodBufferGenericSIMD(PhyloNeighbor *dad_branch, Ph
                 }
             }
             VectorClass *buf = (VectorClass*)(buffer_scale_all+ptn);
-            *buf *= LOG_SCALING_THRESHOLD;
+            *buf *= log_scaling_threshold;
         } // FOR ptn
     } // internal node
 }
@@ -2292,6 +2877,7 @@ void PhyloTree::computeLikelihoodDervGenericSIMD(PhyloNeighbor *dad_branch, Phyl
     ASSERT(eval);
 
     double *buffer_partial_lh_ptr = buffer_partial_lh;
+    const double scaling_threshold = float_partial_lh ? SCALING_THRESHOLD_FLOAT : SCALING_THRESHOLD;
     vector<size_t> limits;
     computeBounds<VectorClass>(num_threads, num_packets, nptn, limits);
 
@@ -2374,7 +2960,7 @@ void PhyloTree::computeLikelihoodDervGenericSIMD(PhyloNeighbor *dad_branch, Phyl
     
     double all_lh(0.0), all_df(0.0), all_ddf(0.0), all_prob_const(0.0), all_df_const(0.0), all_ddf_const(0.0);
 #ifdef _OPENMP
-#pragma omp parallel for schedule(dynamic,1) num_threads(num_threads) reduction(+:all_lh,all_df,all_ddf,all_prob_const,all_df_const,all_ddf_const)
+#pragma omp parallel for schedule(runtime) num_threads(num_threads) reduction(+:all_lh,all_df,all_ddf,all_prob_const,all_df_const,all_ddf_const)
 #endif
     for (int packet_id = 0; packet_id < num_packets; packet_id++) {
         VectorClass my_df(0.0), my_ddf(0.0), vc_prob_const(0.0), vc_df_const(0.0), vc_ddf_const(0.0);
@@ -2518,9 +3104,9 @@ void PhyloTree::computeLikelihoodDervGenericSIMD(PhyloNeighbor *dad_branch, Phyl
                         double *ddf_ptn_dbl = (double*)&ddf_ptn;
                         for (size_t i = 0; i < VectorClass::size(); i++)
                             if (buffer_scale_all[ptn+i] != 0.0) {
-                                lh_ptn_dbl[i] *= SCALING_THRESHOLD;
-                                df_ptn_dbl[i] *= SCALING_THRESHOLD;
-                                ddf_ptn_dbl[i] *= SCALING_THRESHOLD;
+                                lh_ptn_dbl[i] *= scaling_threshold;
+                                df_ptn_dbl[i] *= scaling_threshold;
+                                ddf_ptn_dbl[i] *= scaling_threshold;
                             }
                     }
                     if (ASC_Holder) {
@@ -2689,6 +3275,8 @@ double PhyloTree::computeLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_branch,
 
     double *val = nullptr;
     double *buffer_partial_lh_ptr = buffer_partial_lh;
+    const double scaling_threshold = float_partial_lh ? SCALING_THRESHOLD_FLOAT : SCALING_THRESHOLD;
+    const double log_scaling_threshold = float_partial_lh ? LOG_SCALING_THRESHOLD_FLOAT : LOG_SCALING_THRESHOLD;
 
     double cat_length[ncat];
     double cat_prop[ncat];
@@ -2789,7 +3377,7 @@ double PhyloTree::computeLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_branch,
         auto unknown  = aln->STATE_UNKNOWN;
     	// now do the real computation
 #ifdef _OPENMP
-#pragma omp parallel for  schedule(dynamic,1) num_threads(num_threads) reduction(+:all_tree_lh,all_prob_const)
+#pragma omp parallel for schedule(runtime) num_threads(num_threads) reduction(+:all_tree_lh,all_prob_const)
 #endif
         for (int packet_id = 0; packet_id < num_packets; packet_id++) {
             VectorClass vc_tree_lh(0.0);
@@ -2805,11 +3393,12 @@ double PhyloTree::computeLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_branch,
                 computePartialLikelihood(*it, ptn_lower, ptn_upper, packet_id);
             }
             double *vec_tip = buffer_partial_lh_ptr + block*VectorClass::size() * packet_id;
+            double *float_dad = float_partial_lh ? buffer_float_lh + getBufferFloatLhSize()*packet_id : NULL;
 
             for (size_t ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size()) {
                 VectorClass lh_ptn(0.0);
                 VectorClass *lh_cat = (VectorClass*)(_pattern_lh_cat + ptn*ncat_mix);
-                VectorClass *partial_lh_dad = (VectorClass*)(dad_branch->partial_lh + ptn*block);
+                VectorClass *partial_lh_dad = loadPartialLh<VectorClass>(dad_branch->partial_lh, ptn*block, block, float_dad);
                 VectorClass *lh_node = SITE_MODEL ? (VectorClass*)&partial_lh_node[ptn*nstates] : (VectorClass*)vec_tip;
 
                 if (SITE_MODEL) {
@@ -2886,7 +3475,7 @@ double PhyloTree::computeLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_branch,
                         for (size_t c = 0; c < ncat_mix; c++) {
                             // rescale lh_cat if neccessary
                             if (scale_dad[c] == min_scale+1) {
-                                this_lh_cat[c*VectorClass::size()] *= SCALING_THRESHOLD;
+                                this_lh_cat[c*VectorClass::size()] *= scaling_threshold;
                             } else if (scale_dad[c] > min_scale+1) {
                                 this_lh_cat[c*VectorClass::size()] = 0.0;
                             }
@@ -2901,7 +3490,7 @@ double PhyloTree::computeLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_branch,
                         vc_min_scale_ptr[i] = dad_branch->scale_num[ptn+i];
                     }
                 }
-                vc_min_scale *= LOG_SCALING_THRESHOLD;
+                vc_min_scale *= log_scaling_threshold;
 
                 // Sum later to avoid underflow of invariant sites
                 lh_ptn = abs(lh_ptn) + VectorClass().load_a(&ptn_invar[ptn]);
@@ -2921,7 +3510,7 @@ double PhyloTree::computeLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_branch,
                         double *lh_ptn_dbl = (double*)&lh_ptn;
                         for (size_t i = 0; i < VectorClass::size(); i++)
                             if (vc_min_scale_ptr[i] != 0.0)
-                                lh_ptn_dbl[i] *= SCALING_THRESHOLD;
+                                lh_ptn_dbl[i] *= scaling_threshold;
                     }
                     if (ASC_Holder)
                         lh_ptn.store_a(&_pattern_lh[ptn]);
@@ -2943,7 +3532,7 @@ double PhyloTree::computeLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_branch,
         //ASSERT(0 && "Don't compute tree log-likelihood from internal branch!");
     	//-------- both dad and node are internal nodes -----------/
 #ifdef _OPENMP
-#pragma omp parallel for schedule(dynamic,1) num_threads(num_threads) reduction(+:all_tree_lh,all_prob_const)
+#pragma omp parallel for schedule(runtime) num_threads(num_threads) reduction(+:all_tree_lh,all_prob_const)
 #endif
         for (int packet_id = 0; packet_id < num_packets; packet_id++) {
             size_t ptn_lower = limits[packet_id];
@@ -2956,14 +3545,16 @@ double PhyloTree::computeLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_branch,
             for (auto it = traversal_info.begin(); it != traversal_info.end(); it++) {
                 computePartialLikelihood(*it, ptn_lower, ptn_upper, packet_id);
             }
+            double *float_dad = float_partial_lh ? buffer_float_lh + getBufferFloatLhSize()*packet_id : NULL;
+            double *float_node = float_partial_lh ? float_dad + block*VectorClass::size() : NULL;
 
             VectorClass vc_tree_lh(0.0);
             VectorClass vc_prob_const(0.0);
             for (size_t ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size()) {
                 VectorClass lh_ptn(0.0);
                 VectorClass *lh_cat = (VectorClass*)(_pattern_lh_cat + ptn*ncat_mix);
-                VectorClass *partial_lh_dad = (VectorClass*)(dad_branch->partial_lh + ptn*block);
-                VectorClass *partial_lh_node = (VectorClass*)(node_branch->partial_lh + ptn*block);
+                VectorClass *partial_lh_dad = loadPartialLh<VectorClass>(dad_branch->partial_lh, ptn*block, block, float_dad);
+                VectorClass *partial_lh_node = loadPartialLh<VectorClass>(node_branch->partial_lh, ptn*block, block, float_node);
 
                 // compute likelihood per category
                 if (SITE_MODEL) {
@@ -3017,7 +3608,7 @@ double PhyloTree::computeLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_branch,
                         double *this_lh_cat = &_pattern_lh_cat[ptn*ncat_mix + i];
                         for (size_t c = 0; c < ncat_mix; c++) {
                             if (sum_scale[c] == min_scale+1) {
-                                this_lh_cat[c*VectorClass::size()] *= SCALING_THRESHOLD;
+                                this_lh_cat[c*VectorClass::size()] *= scaling_threshold;
                             } else if (sum_scale[c] > min_scale+1) {
                                 // reset if category is scaled a lot
                                 this_lh_cat[c*VectorClass::size()] = 0.0;
@@ -3032,7 +3623,7 @@ double PhyloTree::computeLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_branch,
                         vc_min_scale_ptr[i] = dad_branch->scale_num[ptn+i] + node_branch->scale_num[ptn+i];
                     }
                 } // if SAFE_NUMERIC
-                vc_min_scale *= LOG_SCALING_THRESHOLD;
+                vc_min_scale *= log_scaling_threshold;
 
                 // Sum later to avoid underflow of invariant sites
                 lh_ptn = abs(lh_ptn) + VectorClass().load_a(&ptn_invar[ptn]);
@@ -3053,7 +3644,7 @@ double PhyloTree::computeLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_branch,
                         double *lh_ptn_dbl = (double*)&lh_ptn;
                         for (size_t i = 0; i < VectorClass::size(); i++)
                             if (vc_min_scale_ptr[i] != 0.0)
-                                lh_ptn_dbl[i] *= SCALING_THRESHOLD;
+                                lh_ptn_dbl[i] *= scaling_threshold;
                     }
                     if (ASC_Holder)
                         lh_ptn.store_a(&_pattern_lh[ptn]);
@@ -3227,6 +3818,7 @@ double PhyloTree::computeLikelihoodFromBufferGenericSIMD()
     ASSERT(eval);
 
     double *val0 = NULL;
+    const double scaling_threshold = float_partial_lh ? SCALING_THRESHOLD_FLOAT : SCALING_THRESHOLD;
     double cat_length[ncat];
     double cat_prop[ncat];
 
@@ -3310,7 +3902,7 @@ double PhyloTree::computeLikelihoodFromBufferGenericSIMD()
                 double *lh_ptn_dbl = (double*)&lh_ptn;
                 for (size_t i = 0; i < VectorClass::size(); i++)
                     if (buffer_scale_all[ptn+i] != 0.0)
-                        lh_ptn_dbl[i] *= SCALING_THRESHOLD;
+                        lh_ptn_dbl[i] *= scaling_threshold;
             }
             if (ASC_Holder) {
                 lh_ptn.store_a(&_pattern_lh[ptn]);
@@ -3489,7 +4081,7 @@ void PhyloTree::computeLikelihoodDervMixlenGenericSIMD(PhyloNeighbor *dad_branch
     double all_df(0.0), all_ddf(0.0), all_prob_const(0.0), all_df_const(0.0), all_ddf_const(0.0);
 
 #ifdef _OPENMP
-#pragma omp parallel for schedule(dynamic,1) num_threads(num_threads) reduction(+:all_df,all_ddf,all_prob_const,all_df_const,all_ddf_const)
+#pragma omp parallel for schedule(runtime) num_threads(num_threads) reduction(+:all_df,all_ddf,all_prob_const,all_df_const,all_ddf_const)
 #endif
     for (int packet_id = 0; packet_id < num_packets; packet_id++) {
         VectorClass my_df(0.0), my_ddf(0.0), vc_prob_const(0.0), vc_df_const(0.0), vc_ddf_const(0.0);
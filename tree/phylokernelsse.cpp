@@ -34,13 +34,16 @@ void PhyloTree::setParsimonyKernelSSE() {
     // Fitch kernel
 	computeParsimonyBranchPointer = &PhyloTree::computeParsimonyBranchFastSIMD<Vec4ui>;
     computePartialParsimonyPointer = &PhyloTree::computePartialParsimonyFastSIMD<Vec4ui>;
+    computeParsimonyInsertPointer = &PhyloTree::computeParsimonyInsertFastSIMD<Vec4ui>;
 }
 
 void PhyloTree::setDotProductSSE() {
 #ifdef BOOT_VAL_FLOAT
 		dotProduct = &PhyloTree::dotProductSIMD<float, Vec4f>;
+		dotProductMatrix = &PhyloTree::dotProductMatrixSIMD<float, Vec4f>;
 #else
 		dotProduct = &PhyloTree::dotProductSIMD<double, Vec2d>;
+		dotProductMatrix = &PhyloTree::dotProductMatrixSIMD<double, Vec2d>;
 #endif
         dotProductDouble = &PhyloTree::dotProductSIMD<double, Vec2d>;
 }
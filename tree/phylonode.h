@@ -21,6 +21,45 @@ typedef unsigned short UBYTE;
  */
 enum RootDirection {UNDEFINED_DIRECTION, TOWARD_ROOT, AWAYFROM_ROOT};
 
+/**
+    site repeats of the subtree below a neighbor: patterns of the same class have identical
+    tip states in the subtree (and the same invariant-site status), thus identical partial
+    likelihoods. See PhyloTree::computeRepeatClasses()
+*/
+struct RepeatClasses {
+    RepeatClasses() {
+        num_classes = 0;
+        version = child_version[0] = child_version[1] = 0;
+    }
+
+    /** class of each pattern */
+    vector<int> pattern_class;
+
+    /** number of classes, 0 if there are too many for repeats to pay off */
+    int num_classes;
+
+    /** version of these classes and of the child classes they were built from */
+    int64_t version, child_version[2];
+};
+
+/**
+    index workspace of one packet of PhyloTree::computePartialRepeatsSIMD(),
+    grown as needed and reused by later calls
+*/
+struct RepeatWorkspace {
+    /** representative of each class, SIZE_MAX if the class does not occur in the packet */
+    vector<size_t> class_rep;
+
+    /** representatives, start of their patterns in rep_ptns, patterns sorted by representative */
+    vector<size_t> reps, rep_start, rep_ptns;
+
+    /** eigen system offset of each category */
+    vector<size_t> mix_addr;
+
+    /** scaling number of the representatives being computed */
+    vector<UBYTE> scale;
+};
+
 /**
 A neighbor in a phylogenetic tree
 
@@ -52,6 +91,7 @@ public:
         partial_pars = NULL;
         direction = UNDEFINED_DIRECTION;
         size = 0;
+        slot_id = -1;
     }
 
     /**
@@ -68,6 +108,7 @@ public:
         partial_pars = NULL;
         direction = UNDEFINED_DIRECTION;
         size = 0;
+        slot_id = -1;
     }
 
     /**
@@ -82,6 +123,7 @@ public:
         partial_pars = NULL;
         direction = nei->direction;
         size = nei->size;
+        slot_id = -1;
     }
 
     
@@ -93,6 +135,23 @@ public:
         return (new PhyloNeighbor(this));
     }
 
+    /**
+     reset this Neighbor to a copy of another one of the same type, like newNeighbor()
+     but reusing the memory of this object
+     @param nei another Neighbor
+     */
+    virtual void copyNeighbor(Neighbor *nei) {
+        Neighbor::copyNeighbor(nei);
+        partial_lh = NULL;
+        scale_num = NULL;
+        partial_lh_computed = 0;
+        lh_scale_factor = 0.0;
+        partial_pars = NULL;
+        direction = ((PhyloNeighbor*)nei)->direction;
+        size = ((PhyloNeighbor*)nei)->size;
+        slot_id = -1;
+    }
+
     /**
         tell that the partial likelihood vector is not computed
      */
@@ -182,6 +241,12 @@ private:
     /** size of subtree below this neighbor in terms of number of taxa */
     int size;
 
+    /** memory slot last assigned to this neighbor for LM_MEM_SAVE, -1 if none, see MemSlotVector */
+    int slot_id;
+
+    /** site repeats of the subtree below this neighbor (--site-repeats) */
+    RepeatClasses repeats;
+
 };
 
 /**
@@ -52,6 +52,16 @@ public:
         return (new PhyloNeighborMixlen(this));
     }
 
+    /**
+     reset this Neighbor to a copy of another one of the same type, like newNeighbor()
+     but reusing the memory of this object
+     @param nei another Neighbor
+     */
+    virtual void copyNeighbor(Neighbor *nei) {
+        PhyloNeighbor::copyNeighbor(nei);
+        lengths = ((PhyloNeighborMixlen*)nei)->lengths;
+    }
+
     /** branch lengths for mixture */
     DoubleVector lengths;
 
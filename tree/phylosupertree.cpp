@@ -28,12 +28,14 @@ PhyloSuperTree::PhyloSuperTree()
  : IQTree()
 {
 	totalNNIs = evalNNIs = 0;
+    num_heavy_parts = 0;
     rescale_codon_brlen = false;
 	// Initialize the counter for evaluated NNIs on subtrees. FOR THIS CASE IT WON'T BE initialized.
 }
 
 PhyloSuperTree::PhyloSuperTree(SuperAlignment *alignment, bool new_iqtree) :  IQTree(alignment) {
     totalNNIs = evalNNIs = 0;
+    num_heavy_parts = 0;
 
     rescale_codon_brlen = false;
     bool has_codon = false;
@@ -71,6 +73,7 @@ PhyloSuperTree::PhyloSuperTree(SuperAlignment *alignment, bool new_iqtree) :  IQ
 
 PhyloSuperTree::PhyloSuperTree(SuperAlignment *alignment, PhyloSuperTree *super_tree) :  IQTree(alignment) {
 	totalNNIs = evalNNIs = 0;
+    num_heavy_parts = 0;
     rescale_codon_brlen = super_tree->rescale_codon_brlen;
 	part_info = super_tree->part_info;
 	for (vector<Alignment*>::iterator it = alignment->partitions.begin(); it != alignment->partitions.end(); it++) {
@@ -225,9 +228,8 @@ void PhyloSuperTree::changeLikelihoodKernel(LikelihoodKernel lk) {
 }
 
 void PhyloSuperTree::setNumThreads(int num_threads) {
-    PhyloTree::setNumThreads((size() >= num_threads) ? num_threads : 1);
-    for (iterator it = begin(); it != end(); it++)
-        (*it)->setNumThreads((size() >= num_threads) ? 1 : num_threads);
+    PhyloTree::setNumThreads(num_threads);
+    computePartitionSchedule();
 }
 
 void PhyloSuperTree::printResultTree(string suffix) {
@@ -611,6 +613,9 @@ void PhyloSuperTree::linkTrees() {
 }
 
 void PhyloSuperTree::initializeAllPartialLh() {
+    // kernel buffers are sized by the threads of each partition
+    if (isPartitionScheduleStale())
+        computePartitionSchedule();
 	for (iterator it = begin(); it != end(); it++) {
 		(*it)->initializeAllPartialLh();
 	}
@@ -698,6 +703,68 @@ void PhyloSuperTree::computePartitionOrder() {
 #endif // OPENMP
 }
 
+/**
+    @return number of rate categories x mixture classes the kernel of a partition tree loops over
+*/
+static int getPartitionNCat(PhyloTree *part_tree) {
+    int ncat = part_tree->getRate() ? part_tree->getRate()->getNRate() : 1;
+    if (part_tree->getModelFactory() && part_tree->getModel() && !part_tree->getModelFactory()->fused_mix_rate)
+        ncat *= part_tree->getModel()->getNMixtures();
+    return ncat;
+}
+
+bool PhyloSuperTree::isPartitionScheduleStale() {
+    if (part_sched.size() != size())
+        return true;
+    for (int i = 0; i < size(); i++)
+        if (part_sched_ncat[i] != getPartitionNCat(at(i)))
+            return true;
+    return false;
+}
+
+void PhyloSuperTree::computePartitionSchedule() {
+    int i, ntrees = size();
+    part_sched.resize(ntrees);
+    part_sched_ncat.resize(ntrees);
+    num_heavy_parts = 0;
+    if (ntrees == 0)
+        return;
+    double *cost = new double[ntrees];
+    double total_cost = 0.0;
+    for (i = 0; i < ntrees; i++) {
+        PhyloTree *part_tree = at(i);
+        double nstates = part_tree->aln->num_states;
+        int ncat = part_sched_ncat[i] = getPartitionNCat(part_tree);
+        cost[i] = -((double)part_tree->aln->getNPattern())*nstates*nstates*ncat;
+        total_cost -= cost[i];
+        part_sched[i] = i;
+    }
+    quicksort(cost, 0, ntrees-1, &part_sched[0]);
+
+    // a partition costing more than a fair share of what is left cannot be balanced
+    // by distributing whole partitions, so it gets all threads in its own kernel
+    while (num_threads > 1 && num_heavy_parts < ntrees && -cost[num_heavy_parts]*num_threads > total_cost) {
+        total_cost += cost[num_heavy_parts];
+        num_heavy_parts++;
+    }
+    delete [] cost;
+
+    for (i = 0; i < ntrees; i++) {
+        PhyloTree *part_tree = at(part_sched[i]);
+        int threads = (i < num_heavy_parts) ? num_threads : 1;
+        part_tree->setNumThreads(threads);
+        // a partition that became heavy after its kernel buffer was allocated
+        // must stay within the packets of that buffer
+        while (threads > 1 && part_tree->buffer_num_packets > 0 && part_tree->num_packets > part_tree->buffer_num_packets)
+            part_tree->setNumThreads(--threads);
+    }
+
+    if (verbose_mode >= VB_MED && num_threads > 1) {
+        cout << num_heavy_parts << " partitions run with " << num_threads << " threads each, "
+             << ntrees - num_heavy_parts << " partitions run in parallel with 1 thread each" << endl;
+    }
+}
+
 double PhyloSuperTree::computeLikelihood(double *pattern_lh) {
 	double tree_lh = 0.0;
 	int ntrees = size();
@@ -711,15 +778,18 @@ double PhyloSuperTree::computeLikelihood(double *pattern_lh) {
 			pattern_lh += at(i)->getAlnNPattern();
 		}
 	} else {
-        if (part_order.empty()) computePartitionOrder();
-		#ifdef _OPENMP
-		#pragma omp parallel for reduction(+: tree_lh) schedule(dynamic) if(num_threads > 1)
-		#endif
-		for (int j = 0; j < ntrees; j++) {
-            int i = part_order[j];
-			part_info[i].cur_score = at(i)->computeLikelihood();
-			tree_lh += part_info[i].cur_score;
-		}
+        for (int phase = 0; phase < 2; phase++) {
+            int first, last;
+            getScheduleRange(phase, first, last);
+            #ifdef _OPENMP
+            #pragma omp parallel for reduction(+: tree_lh) schedule(dynamic) if(phase == 1 && num_threads > 1)
+            #endif
+            for (int j = first; j < last; j++) {
+                int i = part_sched[j];
+                part_info[i].cur_score = at(i)->computeLikelihood();
+                tree_lh += part_info[i].cur_score;
+            }
+        }
 	}
 	return tree_lh;
 }
@@ -772,17 +842,20 @@ void PhyloSuperTree::computePatternProbabilityCategory(double *ptn_prob_cat, Sit
 double PhyloSuperTree::optimizeAllBranches(int my_iterations, double tolerance, int maxNRStep) {
 	double tree_lh = 0.0;
 	int ntrees = size();
-    if (part_order.empty()) computePartitionOrder();
-	#ifdef _OPENMP
-	#pragma omp parallel for reduction(+: tree_lh) schedule(dynamic) if(num_threads > 1)
-	#endif
-	for (int j = 0; j < ntrees; j++) {
-        int i = part_order[j];
-		part_info[i].cur_score = at(i)->optimizeAllBranches(my_iterations, tolerance/min(ntrees,10), maxNRStep);
-		tree_lh += part_info[i].cur_score;
-		if (verbose_mode >= VB_MAX)
-			at(i)->printTree(cout, WT_BR_LEN + WT_NEWLINE);
-	}
+    for (int phase = 0; phase < 2; phase++) {
+        int first, last;
+        getScheduleRange(phase, first, last);
+        #ifdef _OPENMP
+        #pragma omp parallel for reduction(+: tree_lh) schedule(dynamic) if(phase == 1 && num_threads > 1)
+        #endif
+        for (int j = first; j < last; j++) {
+            int i = part_sched[j];
+            part_info[i].cur_score = at(i)->optimizeAllBranches(my_iterations, tolerance/min(ntrees,10), maxNRStep);
+            tree_lh += part_info[i].cur_score;
+            if (verbose_mode >= VB_MAX)
+                at(i)->printTree(cout, WT_BR_LEN + WT_NEWLINE);
+        }
+    }
 
 	if (my_iterations >= 100) computeBranchLengths();
 	return tree_lh;
@@ -910,75 +983,78 @@ NNIMove PhyloSuperTree::getBestNNIForBran(PhyloNode *node1, PhyloNode *node2, NN
 	double nni_score1 = 0.0, nni_score2 = 0.0;
 	int local_totalNNIs = 0, local_evalNNIs = 0;
 
-    if (part_order.empty()) computePartitionOrder();
-	#ifdef _OPENMP
-	#pragma omp parallel for reduction(+: nni_score1, nni_score2, local_totalNNIs, local_evalNNIs) private(part) schedule(dynamic) if(num_threads>1)
-	#endif
-	for (int treeid = 0; treeid < ntrees; treeid++) {
-        part = part_order_by_nptn[treeid];
-		bool is_nni = true;
-		local_totalNNIs++;
-		FOR_NEIGHBOR_DECLARE(node1, NULL, nit) {
-			if (! ((SuperNeighbor*)*nit)->link_neighbors[part]) { is_nni = false; break; }
-		}
-		FOR_NEIGHBOR(node2, NULL, nit) {
-			if (! ((SuperNeighbor*)*nit)->link_neighbors[part]) { is_nni = false; break; }
-		}
-		if (!is_nni && params->terrace_aware) {
-			if (part_info[part].cur_score == 0.0)  {
-				part_info[part].cur_score = at(part)->computeLikelihood();
-				if (save_all_trees == 2 || nniMoves)
-					at(part)->computePatternLikelihood(part_info[part].cur_ptnlh, &part_info[part].cur_score);
+    for (int phase = 0; phase < 2; phase++) {
+        int first, last;
+        getScheduleRange(phase, first, last);
+        #ifdef _OPENMP
+        #pragma omp parallel for reduction(+: nni_score1, nni_score2, local_totalNNIs, local_evalNNIs) private(part) schedule(dynamic) if(phase == 1 && num_threads > 1)
+        #endif
+        for (int treeid = first; treeid < last; treeid++) {
+            part = part_sched[treeid];
+			bool is_nni = true;
+			local_totalNNIs++;
+			FOR_NEIGHBOR_DECLARE(node1, NULL, nit) {
+				if (! ((SuperNeighbor*)*nit)->link_neighbors[part]) { is_nni = false; break; }
+			}
+			FOR_NEIGHBOR(node2, NULL, nit) {
+				if (! ((SuperNeighbor*)*nit)->link_neighbors[part]) { is_nni = false; break; }
+			}
+			if (!is_nni && params->terrace_aware) {
+				if (part_info[part].cur_score == 0.0)  {
+					part_info[part].cur_score = at(part)->computeLikelihood();
+					if (save_all_trees == 2 || nniMoves)
+						at(part)->computePatternLikelihood(part_info[part].cur_ptnlh, &part_info[part].cur_score);
+				}
+				nni_score1 += part_info[part].cur_score;
+				nni_score2 += part_info[part].cur_score;
+				continue;
 			}
-			nni_score1 += part_info[part].cur_score;
-			nni_score2 += part_info[part].cur_score;
-			continue;
-		}
-
-		local_evalNNIs++;
-		part_info[part].evalNNIs++;
-
-		PhyloNeighbor *nei1_part = nei1->link_neighbors[part];
-		PhyloNeighbor *nei2_part = nei2->link_neighbors[part];
-
-		int brid = nei1_part->id;
 
-		//NNIMove part_moves[2];
-		//part_moves[0].node1Nei_it = NULL;
-
-		// setup subtree NNI correspondingly
-		PhyloNode *node1_part = (PhyloNode*)nei2_part->node;
-		PhyloNode *node2_part = (PhyloNode*)nei1_part->node;
-		part_info[part].nniMoves[0].node1 = part_info[part].nniMoves[1].node1 = node1;
-		part_info[part].nniMoves[0].node2 = part_info[part].nniMoves[1].node2 = node2;
-		part_info[part].nniMoves[0].node1Nei_it = node1_part->findNeighborIt(node1_nei->link_neighbors[part]->node);
-		part_info[part].nniMoves[0].node2Nei_it = node2_part->findNeighborIt(node2_nei->link_neighbors[part]->node);
-
-		part_info[part].nniMoves[1].node1Nei_it = node1_part->findNeighborIt(node1_nei->link_neighbors[part]->node);
-		part_info[part].nniMoves[1].node2Nei_it = node2_part->findNeighborIt(node2_nei_other->link_neighbors[part]->node);
-
-		at(part)->getBestNNIForBran((PhyloNode*)nei2_part->node, (PhyloNode*)nei1_part->node, part_info[part].nniMoves);
-		// detect the corresponding NNIs and swap if necessary (the swapping refers to the swapping of NNI order)
-		if (!((*part_info[part].nniMoves[0].node1Nei_it == node1_nei->link_neighbors[part] &&
-				*part_info[part].nniMoves[0].node2Nei_it == node2_nei->link_neighbors[part]) ||
-			(*part_info[part].nniMoves[0].node1Nei_it != node1_nei->link_neighbors[part] &&
-					*part_info[part].nniMoves[0].node2Nei_it != node2_nei->link_neighbors[part])))
-		{
-			outError("WRONG");
-			NNIMove tmp = part_info[part].nniMoves[0];
-			part_info[part].nniMoves[0] = part_info[part].nniMoves[1];
-			part_info[part].nniMoves[1] = tmp;
-		}
-		nni_score1 += part_info[part].nniMoves[0].newloglh;
-		nni_score2 += part_info[part].nniMoves[1].newloglh;
-		int numlen = 1;
-		if (params->nni5) numlen = 5;
-		for (int i = 0; i < numlen; i++) {
-			part_info[part].nni1_brlen[brid*numlen + i] = part_info[part].nniMoves[0].newLen[i];
-			part_info[part].nni2_brlen[brid*numlen + i] = part_info[part].nniMoves[1].newLen[i];
-		}
+			local_evalNNIs++;
+			part_info[part].evalNNIs++;
+
+			PhyloNeighbor *nei1_part = nei1->link_neighbors[part];
+			PhyloNeighbor *nei2_part = nei2->link_neighbors[part];
+
+			int brid = nei1_part->id;
+
+			//NNIMove part_moves[2];
+			//part_moves[0].node1Nei_it = NULL;
+
+			// setup subtree NNI correspondingly
+			PhyloNode *node1_part = (PhyloNode*)nei2_part->node;
+			PhyloNode *node2_part = (PhyloNode*)nei1_part->node;
+			part_info[part].nniMoves[0].node1 = part_info[part].nniMoves[1].node1 = node1;
+			part_info[part].nniMoves[0].node2 = part_info[part].nniMoves[1].node2 = node2;
+			part_info[part].nniMoves[0].node1Nei_it = node1_part->findNeighborIt(node1_nei->link_neighbors[part]->node);
+			part_info[part].nniMoves[0].node2Nei_it = node2_part->findNeighborIt(node2_nei->link_neighbors[part]->node);
+
+			part_info[part].nniMoves[1].node1Nei_it = node1_part->findNeighborIt(node1_nei->link_neighbors[part]->node);
+			part_info[part].nniMoves[1].node2Nei_it = node2_part->findNeighborIt(node2_nei_other->link_neighbors[part]->node);
+
+			at(part)->getBestNNIForBran((PhyloNode*)nei2_part->node, (PhyloNode*)nei1_part->node, part_info[part].nniMoves);
+			// detect the corresponding NNIs and swap if necessary (the swapping refers to the swapping of NNI order)
+			if (!((*part_info[part].nniMoves[0].node1Nei_it == node1_nei->link_neighbors[part] &&
+					*part_info[part].nniMoves[0].node2Nei_it == node2_nei->link_neighbors[part]) ||
+				(*part_info[part].nniMoves[0].node1Nei_it != node1_nei->link_neighbors[part] &&
+						*part_info[part].nniMoves[0].node2Nei_it != node2_nei->link_neighbors[part])))
+			{
+				outError("WRONG");
+				NNIMove tmp = part_info[part].nniMoves[0];
+				part_info[part].nniMoves[0] = part_info[part].nniMoves[1];
+				part_info[part].nniMoves[1] = tmp;
+			}
+			nni_score1 += part_info[part].nniMoves[0].newloglh;
+			nni_score2 += part_info[part].nniMoves[1].newloglh;
+			int numlen = 1;
+			if (params->nni5) numlen = 5;
+			for (int i = 0; i < numlen; i++) {
+				part_info[part].nni1_brlen[brid*numlen + i] = part_info[part].nniMoves[0].newLen[i];
+				part_info[part].nni2_brlen[brid*numlen + i] = part_info[part].nniMoves[1].newLen[i];
+			}
 
-	}
+        }
+    }
 	totalNNIs += local_totalNNIs;
 	evalNNIs += local_evalNNIs;
 	double nni_scores[2] = {nni_score1, nni_score2};
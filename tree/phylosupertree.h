@@ -365,6 +365,38 @@ public:
     /* compute part_order vector */
     void computePartitionOrder();
 
+    /**
+        partition IDs sorted in descending order of kernel cost (#patterns * #states^2 * #categories).
+        The first num_heavy_parts partitions each exceed a fair per-thread share of the remaining cost:
+        they are processed one after another with all threads in their own kernel.
+        The remaining partitions are processed concurrently with one thread each.
+    */
+    IntVector part_sched;
+    int num_heavy_parts;
+
+    /** number of rate categories x mixture classes of every partition when part_sched was computed */
+    IntVector part_sched_ncat;
+
+    /**
+        compute part_sched and assign the number of threads of every partition tree
+    */
+    void computePartitionSchedule();
+
+    /**
+        @return true if part_sched is missing or the rate categories of a partition changed since
+    */
+    bool isPartitionScheduleStale();
+
+    /**
+        @param phase 0 for heavy partitions (sequential), 1 for light partitions (parallel)
+        @param[out] first, last range [first,last) of part_sched to process in this phase
+    */
+    void getScheduleRange(int phase, int &first, int &last) {
+        if (isPartitionScheduleStale()) computePartitionSchedule();
+        first = (phase == 0) ? 0 : num_heavy_parts;
+        last = (phase == 0) ? num_heavy_parts : part_sched.size();
+    }
+
     /**
             get the name of the model
     */
@@ -277,15 +277,18 @@ void PhyloSuperTreePlen::optimizeOneBranch(PhyloNode *node1, PhyloNode *node2, b
 	//this->clearAllPartialLH();
 	PhyloTree::optimizeOneBranch(node1, node2, false, maxNRStep);
 
-    if (part_order.empty()) computePartitionOrder();
 	// bug fix: assign cur_score into part_info
-    #ifdef _OPENMP
-    #pragma omp parallel for private(part) schedule(dynamic) if(num_threads > 1)
-    #endif    
-    for (int partid = 0; partid < size(); partid++) {
-        part = part_order_by_nptn[partid];
-        if (((SuperNeighbor*)current_it)->link_neighbors[part]) {
-            part_info[part].cur_score = at(part)->computeLikelihoodFromBuffer();
+    for (int phase = 0; phase < 2; phase++) {
+        int first, last;
+        getScheduleRange(phase, first, last);
+        #ifdef _OPENMP
+        #pragma omp parallel for private(part) schedule(dynamic) if(phase == 1 && num_threads > 1)
+        #endif
+        for (int partid = first; partid < last; partid++) {
+            part = part_sched[partid];
+            if (((SuperNeighbor*)current_it)->link_neighbors[part]) {
+                part_info[part].cur_score = at(part)->computeLikelihoodFromBuffer();
+            }
         }
     }
 
@@ -306,7 +309,6 @@ void PhyloSuperTreePlen::optimizeOneBranch(PhyloNode *node1, PhyloNode *node2, b
 double PhyloSuperTreePlen::computeFunction(double value) {
 
 	double tree_lh = 0.0;
-	int ntrees = size();
 
 	if (!central_partial_lh) initializeAllPartialLh();
 
@@ -318,27 +320,30 @@ double PhyloSuperTreePlen::computeFunction(double value) {
 	SuperNeighbor *nei2 = (SuperNeighbor*)current_it->node->findNeighbor(current_it_back->node);
 	ASSERT(nei1 && nei2);
 
-    if (part_order.empty()) computePartitionOrder();
-    #ifdef _OPENMP
-    #pragma omp parallel for reduction(+: tree_lh) schedule(dynamic) if(num_threads > 1)
-    #endif    
-	for (int partid = 0; partid < ntrees; partid++) {
-            int part = part_order_by_nptn[partid];
-			PhyloNeighbor *nei1_part = nei1->link_neighbors[part];
-			PhyloNeighbor *nei2_part = nei2->link_neighbors[part];
-			if (nei1_part && nei2_part) {
-				at(part)->current_it = nei1_part;
-				at(part)->current_it_back = nei2_part;
-				nei1_part->length += lambda*part_info[part].part_rate;
-				nei2_part->length += lambda*part_info[part].part_rate;
-				part_info[part].cur_score = at(part)->computeLikelihoodBranch(nei2_part,(PhyloNode*)nei1_part->node);
-				tree_lh += part_info[part].cur_score;
-			} else {
-				if (part_info[part].cur_score == 0.0)
-					part_info[part].cur_score = at(part)->computeLikelihood();
-				tree_lh += part_info[part].cur_score;
-			}
-		}
+    for (int phase = 0; phase < 2; phase++) {
+        int first, last;
+        getScheduleRange(phase, first, last);
+        #ifdef _OPENMP
+        #pragma omp parallel for reduction(+: tree_lh) schedule(dynamic) if(phase == 1 && num_threads > 1)
+        #endif
+        for (int partid = first; partid < last; partid++) {
+            int part = part_sched[partid];
+            PhyloNeighbor *nei1_part = nei1->link_neighbors[part];
+            PhyloNeighbor *nei2_part = nei2->link_neighbors[part];
+            if (nei1_part && nei2_part) {
+                at(part)->current_it = nei1_part;
+                at(part)->current_it_back = nei2_part;
+                nei1_part->length += lambda*part_info[part].part_rate;
+                nei2_part->length += lambda*part_info[part].part_rate;
+                part_info[part].cur_score = at(part)->computeLikelihoodBranch(nei2_part,(PhyloNode*)nei1_part->node);
+                tree_lh += part_info[part].cur_score;
+            } else {
+                if (part_info[part].cur_score == 0.0)
+                    part_info[part].cur_score = at(part)->computeLikelihood();
+                tree_lh += part_info[part].cur_score;
+            }
+        }
+    }
     return -tree_lh;
 }
 
@@ -364,8 +369,6 @@ void PhyloSuperTreePlen::computeFuncDerv(double value, double &df_ret, double &d
 	double df = 0.0;
 	double ddf = 0.0;
 
-	int ntrees = size();
-
 	if (!central_partial_lh) initializeAllPartialLh();
 
 	double lambda = value-current_it->length;
@@ -376,34 +379,37 @@ void PhyloSuperTreePlen::computeFuncDerv(double value, double &df_ret, double &d
 	SuperNeighbor *nei2 = (SuperNeighbor*)current_it->node->findNeighbor(current_it_back->node);
 	ASSERT(nei1 && nei2);
 
-    if (part_order.empty()) computePartitionOrder();
-    #ifdef _OPENMP
-    #pragma omp parallel for reduction(+: df, ddf) schedule(dynamic) if(num_threads > 1)
-    #endif    
-	for (int partid = 0; partid < ntrees; partid++) {
-        int part = part_order_by_nptn[partid];
-        double df_aux, ddf_aux;
-        PhyloNeighbor *nei1_part = nei1->link_neighbors[part];
-        PhyloNeighbor *nei2_part = nei2->link_neighbors[part];
-        if (nei1_part && nei2_part) {
-            at(part)->current_it = nei1_part;
-            at(part)->current_it_back = nei2_part;
+    for (int phase = 0; phase < 2; phase++) {
+        int first, last;
+        getScheduleRange(phase, first, last);
+        #ifdef _OPENMP
+        #pragma omp parallel for reduction(+: df, ddf) schedule(dynamic) if(phase == 1 && num_threads > 1)
+        #endif
+        for (int partid = first; partid < last; partid++) {
+            int part = part_sched[partid];
+            double df_aux, ddf_aux;
+            PhyloNeighbor *nei1_part = nei1->link_neighbors[part];
+            PhyloNeighbor *nei2_part = nei2->link_neighbors[part];
+            if (nei1_part && nei2_part) {
+                at(part)->current_it = nei1_part;
+                at(part)->current_it_back = nei2_part;
             
-            nei1_part->length += lambda*part_info[part].part_rate;
-            nei2_part->length += lambda*part_info[part].part_rate;
-            if(nei1_part->length<-1e-4) {
-                cout<<"lambda = "<<lambda<<endl;
-                cout<<"NEGATIVE BRANCH len = "<<nei1_part->length<<endl<<" rate = "<<part_info[part].part_rate<<endl;
-                ASSERT(0);
-                outError("shit!!   ",__func__);
+                nei1_part->length += lambda*part_info[part].part_rate;
+                nei2_part->length += lambda*part_info[part].part_rate;
+                if(nei1_part->length<-1e-4) {
+                    cout<<"lambda = "<<lambda<<endl;
+                    cout<<"NEGATIVE BRANCH len = "<<nei1_part->length<<endl<<" rate = "<<part_info[part].part_rate<<endl;
+                    ASSERT(0);
+                    outError("shit!!   ",__func__);
+                }
+                at(part)->computeLikelihoodDerv(nei2_part,(PhyloNode*)nei1_part->node, &df_aux, &ddf_aux);
+                df += part_info[part].part_rate*df_aux;
+                ddf += part_info[part].part_rate*part_info[part].part_rate*ddf_aux;
             }
-            at(part)->computeLikelihoodDerv(nei2_part,(PhyloNode*)nei1_part->node, &df_aux, &ddf_aux);
-            df += part_info[part].part_rate*df_aux;
-            ddf += part_info[part].part_rate*part_info[part].part_rate*ddf_aux;
-        }
-        else {
-            if (part_info[part].cur_score == 0.0) {
-                part_info[part].cur_score = at(part)->computeLikelihood();
+            else {
+                if (part_info[part].cur_score == 0.0) {
+                    part_info[part].cur_score = at(part)->computeLikelihood();
+                }
             }
         }
     }
@@ -1641,6 +1647,10 @@ void PhyloSuperTreePlen::initializeAllPartialLh() {
         total_lh_cat_size = 0,
         total_buffer_size = 0;
 
+    // kernel buffers are sized by the threads of each partition
+    if (!buffer_partial_lh && isPartitionScheduleStale())
+        computePartitionSchedule();
+
 	if (part_order.empty())
 		computePartitionOrder();
 
@@ -1661,6 +1671,8 @@ void PhyloSuperTreePlen::initializeAllPartialLh() {
 		total_block_size += block_size[part];
         total_scale_block_size += scale_block_size[part];
 		total_lh_cat_size += lh_cat_size[part];
+        if (!buffer_partial_lh)
+            (*it)->setNumPacketsByCache();
         total_buffer_size += (buffer_size[part] = (*it)->getBufferPartialLhSize());
 	}
 
@@ -1674,8 +1686,11 @@ void PhyloSuperTreePlen::initializeAllPartialLh() {
         theta_all = aligned_alloc<double>(total_block_size);
     if (!buffer_scale_all)
         buffer_scale_all = aligned_alloc<double>(total_mem_size);
-    if (!buffer_partial_lh)
+    if (!buffer_partial_lh) {
         buffer_partial_lh = aligned_alloc<double>(total_buffer_size);
+        for (it = begin(); it != end(); it++)
+            (*it)->buffer_num_packets = (*it)->num_packets;
+    }
     at(part_order[0])->theta_all = theta_all;
     at(part_order[0])->buffer_scale_all = buffer_scale_all;
     at(part_order[0])->buffer_partial_lh = buffer_partial_lh;
@@ -1735,12 +1750,10 @@ void PhyloSuperTreePlen::initializeAllPartialLh() {
 
 	// allocate central memory for all partitions
 	if (!central_partial_lh) {
-        try {
-        	central_partial_lh = aligned_alloc<double>(total_partial_lh_entries);
-        	central_scale_num = aligned_alloc<UBYTE>(total_scale_num_entries);
-        } catch (std::bad_alloc &ba) {
-        	outError("Not enough memory for partial likelihood vectors (bad_alloc)");
-        }
+        if (params->lh_float)
+            warnDoublePartialLh();
+        allocateCentralPartialLh(total_partial_lh_entries);
+        allocateCentralScaleNum(total_scale_num_entries);
 	}
 //    if (!central_partial_pars) {
 //        try {
@@ -293,8 +293,10 @@ void PhyloSuperTreeUnlinked::writeUFBootTrees(Params &params) {
     
     for (auto tree = begin(); tree != end(); tree++) {
         MTreeSet trees;
-
-        trees.init(((IQTree*)*tree)->boot_trees, (*tree)->rooted);
+        IntVector sample_trees;
+        ((IQTree*)*tree)->getBootTrees(trees, &sample_trees);
+        StrVector tree_strs;
+        tree_strs.resize(trees.size());
         for (i = 0; i < trees.size(); i++) {
             NodeVector taxa;
             // change the taxa name from ID to real name
@@ -305,13 +307,17 @@ void PhyloSuperTreeUnlinked::writeUFBootTrees(Params &params) {
                 // reinsert removed seqs into each tree
                 trees[i]->insertTaxa(removed_seqs, twin_seqs);
             }
-            // now print to file
-            for (j = 0; j < trees.tree_weights[i]; j++)
-                if (params.print_ufboot_trees == 1)
-                    trees[i]->printTree(out, WT_NEWLINE);
-                else
-                    trees[i]->printTree(out, WT_NEWLINE + WT_BR_LEN);
+            stringstream ss;
+            if (params.print_ufboot_trees == 1)
+                trees[i]->printTree(ss, WT_NEWLINE);
+            else
+                trees[i]->printTree(ss, WT_NEWLINE + WT_BR_LEN);
+            tree_strs[i] = ss.str();
         }
+        // now print to file in the order of samples
+        for (auto it = sample_trees.begin(); it != sample_trees.end(); it++)
+            if (*it >= 0)
+                out << tree_strs[*it];
     }
     cout << "UFBoot trees printed to " << filename << endl;
     out.close();
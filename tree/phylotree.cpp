@@ -27,6 +27,7 @@
 #include "alignment/alignmentsummary.h"
 #include <algorithm>
 #include <limits>
+#include <mutex>
 #include "utils/timeutil.h"
 #include "utils/pllnni.h"
 #include "phylosupertree.h"
@@ -34,6 +35,7 @@
 #include "upperbounds.h"
 #include "utils/MPIHelper.h"
 #include "utils/hammingdistance.h"
+#include "utils/operatingsystem.h"
 #include "model/modelmixture.h"
 #include "phylonodemixlen.h"
 #include "phylotreemixlen.h"
@@ -87,7 +89,10 @@ void PhyloTree::init() {
     ptn_freq_computed = false;
     central_scale_num = NULL;
     nni_scale_num = NULL;
+    central_lh_mapped_size = central_scale_mapped_size = 0;
+    repeat_counter = repeat_epoch = 0;
     central_partial_pars = NULL;
+    computeParsimonyInsertPointer = NULL;
     cost_matrix = NULL;
     model_factory = NULL;
     discard_saturated_site = true;
@@ -100,6 +105,8 @@ void PhyloTree::init() {
     theta_all = NULL;
     buffer_scale_all = NULL;
     buffer_partial_lh = NULL;
+    buffer_float_lh = NULL;
+    float_partial_lh = false;
     ptn_freq = NULL;
     ptn_freq_pars = NULL;
     ptn_invar = NULL;
@@ -111,6 +118,7 @@ void PhyloTree::init() {
     setNumThreads(1);
     num_threads = 0;
     num_packets = 0;
+    buffer_num_packets = 0;
     max_lh_slots = 0;
     save_all_trees = 0;
     nodeBranchDists = NULL;
@@ -229,10 +237,11 @@ void myPartitionsDestroy(partitionList *pl) {
 
 PhyloTree::~PhyloTree() {
     doneComputingDistances();
+    for (Neighbor *nei : nni_temp_nei)
+        delete nei;
     aligned_free(nni_scale_num);
     aligned_free(nni_partial_lh);
-    aligned_free(central_partial_lh);
-    aligned_free(central_scale_num);
+    freeCentralPartialLh();
     aligned_free(central_partial_pars);
     aligned_free(cost_matrix);
 
@@ -248,6 +257,7 @@ PhyloTree::~PhyloTree() {
     aligned_free(theta_all);
     aligned_free(buffer_scale_all);
     aligned_free(buffer_partial_lh);
+    aligned_free(buffer_float_lh);
     aligned_free(ptn_freq);
     aligned_free(ptn_freq_pars);
     ptn_freq_computed = false;
@@ -378,6 +388,8 @@ void PhyloTree::copyPhyloTreeMixlen(PhyloTree *tree, int mix, bool borrowSummary
 #define FAST_NAME_CHECK 1
 void PhyloTree::setAlignment(Alignment *alignment) {
     aln = alignment;
+    // repeat classes refer to the patterns and leaf IDs of the old alignment
+    repeat_epoch = repeat_counter;
     //double checkStart = getRealTime();
     size_t nseq = aln->getNSeq();
     bool err = false;
@@ -874,6 +886,9 @@ size_t PhyloTree::getBufferPartialLhSize() {
 
     buffer_size += get_safe_upper_limit(block *(aln->STATE_UNKNOWN+1));
     buffer_size += (block*2+model->num_states)*VECTOR_SIZE*num_packets;
+    // site-repeat kernel: one more block and the invariant-site likelihoods per packet
+    if (params && params->lh_site_repeats)
+        buffer_size += (block+1)*VECTOR_SIZE*num_packets;
 
     // always more buffer for non-rev kernel, in case switching between kernels
     buffer_size += get_safe_upper_limit(block)*(aln->STATE_UNKNOWN+1)*2;
@@ -887,6 +902,17 @@ size_t PhyloTree::getBufferPartialLhSize() {
     return buffer_size;
 }
 
+size_t PhyloTree::getBufferFloatLhSize() {
+    const size_t VECTOR_SIZE = 8; // largest SIMD width, as in getBufferPartialLhSize
+    size_t nstates = model->num_states;
+    size_t block   = nstates * site_rate->getNRate() * ((model_factory->fused_mix_rate)? 1 : model->getNMixtures());
+    // computePartialLikelihoodFloatSIMD: 3 blocks and nstates of a pair of pattern vectors in float,
+    // followed by the transition matrices, the inverse eigenvectors and the tip likelihoods of 2 leaves
+    size_t float_size = 2*block*nstates + nstates*nstates + 2*block*(aln->STATE_UNKNOWN+1);
+    // (the double kernels convert 3 blocks of a pattern vector at the beginning of it)
+    return (3*block + nstates)*VECTOR_SIZE + ((float_size+15)/16)*8;
+}
+
 void PhyloTree::initializeAllPartialLh() {
     int index, indexlh;
     int numStates = model->num_states;
@@ -910,8 +936,18 @@ void PhyloTree::initializeAllPartialLh() {
     if (!buffer_scale_all)
         buffer_scale_all = aligned_alloc<double>(mem_size);
     if (!buffer_partial_lh) {
+        setNumPacketsByCache();
         buffer_partial_lh = aligned_alloc<double>(getBufferPartialLhSize());
+        buffer_num_packets = num_packets;
+    }
+    // the precision is fixed for as long as central_partial_lh is allocated
+    if (!central_partial_lh) {
+        float_partial_lh = useFloatPartialLh();
+        if (params->lh_float && !float_partial_lh)
+            warnDoublePartialLh();
     }
+    if (float_partial_lh && !buffer_float_lh)
+        buffer_float_lh = aligned_alloc<double>(getBufferFloatLhSize()*buffer_num_packets);
     if (!ptn_freq) {
         ptn_freq = aligned_alloc<double>(mem_size);
         ptn_freq_computed = false;
@@ -923,6 +959,8 @@ void PhyloTree::initializeAllPartialLh() {
     initializeAllPartialLh(index, indexlh);
     if (params->lh_mem_save == LM_MEM_SAVE)
         mem_slots.init(this, max_lh_slots);
+    // the alignment may have changed
+    repeat_epoch = repeat_counter;
         
     ASSERT(index == (nodeNum - 1) * 2);
     if (params->lh_mem_save == LM_PER_NODE) {
@@ -933,11 +971,154 @@ void PhyloTree::initializeAllPartialLh() {
 
 }
 
+void computePacketBounds(int threads, int packets, size_t elements, size_t vector_size, vector<size_t> &limits) {
+    //It is assumed that threads divides packets evenly
+    limits.reserve(packets+1);
+    elements = roundUpToMultiple(elements, vector_size);
+    size_t block_start = 0;
+
+    if ((Params::getInstance().lh_cache_size != 0 && packets > 2*threads) || Params::getInstance().numa_aware) {
+        // cache-sized packets (see setNumPacketsByCache): equal-sized blocks,
+        // load balancing is left to the dynamic schedule over many packets.
+        // NUMA mode: the static schedule gives thread i the i-th contiguous slice,
+        // the same slice it first-touched in firstTouchPartialLh
+        size_t block_size = roundUpToMultiple((elements+packets-1)/packets, vector_size);
+        for (int packet = 0; packet < packets; packet++) {
+            limits.push_back(min(block_start, elements));
+            block_start += block_size;
+        }
+        limits.push_back(elements);
+        return;
+    }
+
+    for (int wave = packets/threads; wave>=1; --wave) {
+        size_t elementsThisWave = (elements-block_start);
+        if (1<wave) {
+            elementsThisWave = (elementsThisWave * 3) / 4;
+        }
+        elementsThisWave = roundUpToMultiple(elementsThisWave, vector_size);
+        size_t stopElementThisWave = block_start + elementsThisWave;
+        for (int threads_to_go=threads; 1<=threads_to_go; --threads_to_go) {
+            limits.push_back(block_start);
+            size_t block_size = (stopElementThisWave - block_start)/threads_to_go;
+            block_size = roundUpToMultiple(block_size, vector_size);
+            block_start += block_size;
+        }
+    }
+    limits.push_back(elements);
+    
+    if (limits.size() != packets+1) {
+        if (Params::getInstance().num_threads == 0)
+            outError("Too many threads may slow down analysis [-nt option]. Reduce threads");
+        else
+            outError("Too many threads may slow down analysis [-nt option]. Reduce threads or use -nt AUTO to automatically determine it");
+    }
+}
+
+void PhyloTree::firstTouchPartialLh(uint64_t num_slots, size_t nptn, uint64_t block_size, size_t ptn_lh_bytes,
+    uint64_t scale_block_size, size_t ptn_scale_size) {
+#ifdef _OPENMP
+    if (num_threads <= 1)
+        return;
+    // the packets of the kernels; patterns behind their range go to the last packet
+    size_t vsize = max(vector_size, (size_t)1);
+    size_t kernel_nptn = roundUpToMultiple(roundUpToMultiple(aln->size(), vsize) + model_factory->unobserved_ptns.size(), vsize);
+    vector<size_t> limits;
+    computePacketBounds(num_threads, num_packets, kernel_nptn, vsize, limits);
+    limits.back() = max(limits.back(), nptn);
+#pragma omp parallel for schedule(runtime) num_threads(num_threads)
+    for (int packet_id = 0; packet_id < num_packets; packet_id++) {
+        size_t ptn_lower = min(limits[packet_id], nptn);
+        size_t ptn_upper = min(limits[packet_id+1], nptn);
+        for (uint64_t slot = 0; slot < num_slots; slot++) {
+            memset((char*)(central_partial_lh + slot*block_size) + ptn_lower*ptn_lh_bytes, 0,
+                   (ptn_upper-ptn_lower)*ptn_lh_bytes);
+            memset(central_scale_num + slot*scale_block_size + ptn_lower*ptn_scale_size, 0,
+                   sizeof(UBYTE)*(ptn_upper-ptn_lower)*ptn_scale_size);
+        }
+    }
+    if (verbose_mode >= VB_MED)
+        cout << "Partial likelihoods placed by " << num_threads << " threads in " << num_packets << " packets" << endl;
+#endif
+}
+
+void PhyloTree::allocateCentralPartialLh(uint64_t entries) {
+    if (params->lh_scratch_dir) {
+        central_lh_mapped_size = entries * sizeof(double);
+        central_partial_lh = (double*)mapScratchFile(params->lh_scratch_dir, central_lh_mapped_size);
+        if (!central_partial_lh)
+            outError("Cannot map partial likelihood vectors to a scratch file in ", params->lh_scratch_dir);
+    } else {
+        try {
+            central_partial_lh = aligned_alloc<double>(entries);
+        } catch (std::bad_alloc &ba) {
+            outError("Not enough memory for partial likelihood vectors (bad_alloc)");
+        }
+    }
+    if (!central_partial_lh)
+        outError("Not enough memory for partial likelihood vectors");
+}
+
+void PhyloTree::allocateCentralScaleNum(uint64_t entries) {
+    if (params->lh_scratch_dir) {
+        central_scale_mapped_size = entries * sizeof(UBYTE);
+        central_scale_num = (UBYTE*)mapScratchFile(params->lh_scratch_dir, central_scale_mapped_size);
+        if (!central_scale_num)
+            outError("Cannot map scale num vectors to a scratch file in ", params->lh_scratch_dir);
+    } else {
+        try {
+            central_scale_num = aligned_alloc<UBYTE>(entries);
+        } catch (std::bad_alloc &ba) {
+            outError("Not enough memory for scale num vectors (bad_alloc)");
+        }
+    }
+    if (!central_scale_num)
+        outError("Not enough memory for scale num vectors");
+}
+
+void PhyloTree::freeCentralPartialLh() {
+    if (central_lh_mapped_size) {
+        unmapScratchFile(central_partial_lh, central_lh_mapped_size);
+        central_partial_lh = NULL;
+        central_lh_mapped_size = 0;
+    } else
+        aligned_free(central_partial_lh);
+    if (central_scale_mapped_size) {
+        unmapScratchFile(central_scale_num, central_scale_mapped_size);
+        central_scale_num = NULL;
+        central_scale_mapped_size = 0;
+    } else
+        aligned_free(central_scale_num);
+}
+
+void PhyloTree::prefetchTraversalPartialLh() {
+    size_t lh_bytes = getPartialLhBytes();
+    size_t scale_bytes = getScaleNumBytes();
+    for (auto it = traversal_info.begin(); it != traversal_info.end(); it++) {
+        PhyloNode *node = (PhyloNode*)it->dad_branch->node;
+        FOR_NEIGHBOR_IT(node, it->dad, nit) {
+            PhyloNeighbor *child = (PhyloNeighbor*)*nit;
+            if (child->node->isLeaf() || !child->partial_lh)
+                continue;
+            prefetchMappedRegion(child->partial_lh, lh_bytes);
+            prefetchMappedRegion(child->scale_num, scale_bytes);
+        }
+    }
+}
+
+void PhyloTree::writeBackTraversalPartialLh() {
+    size_t lh_bytes = getPartialLhBytes();
+    size_t scale_bytes = getScaleNumBytes();
+    for (auto it = traversal_info.begin(); it != traversal_info.end(); it++) {
+        writeBackMappedRegion(it->dad_branch->partial_lh, lh_bytes);
+        writeBackMappedRegion(it->dad_branch->scale_num, scale_bytes);
+    }
+}
+
 void PhyloTree::deleteAllPartialLh() {
     //Note: aligned_free now sets the pointer to nullptr
     //      (so there's no need to do that explicitly any more)
-    aligned_free(central_partial_lh);
-    aligned_free(central_scale_num);
+    freeCentralPartialLh();
     aligned_free(central_partial_pars);
     aligned_free(nni_scale_num);
     aligned_free(nni_partial_lh);
@@ -947,6 +1128,9 @@ void PhyloTree::deleteAllPartialLh() {
     aligned_free(theta_all);
     aligned_free(buffer_scale_all);
     aligned_free(buffer_partial_lh);
+    buffer_num_packets = 0;
+    aligned_free(buffer_float_lh);
+    float_partial_lh = false;
     aligned_free(_pattern_lh_cat);
     aligned_free(_pattern_lh);
     aligned_free(_site_lh);
@@ -988,7 +1172,7 @@ uint64_t PhyloTree::getMemoryRequired(size_t ncategory, bool full_mem) {
     if (model)
         mem_size += model->getMemoryRequired();
 
-    int64_t lh_scale_size = block_size * sizeof(double) + scale_block_size * sizeof(UBYTE);
+    int64_t lh_scale_size = block_size * (useFloatPartialLh() ? sizeof(float) : sizeof(double)) + scale_block_size * sizeof(UBYTE);
 
     max_lh_slots = leafNum-2;
 
@@ -1056,8 +1240,11 @@ void PhyloTree::initializeAllPartialLh(int &index, int &indexlh, PhyloNode *node
     // +num_states for ascertainment bias correction
     size_t nptn = get_safe_upper_limit(aln->size())+ max(get_safe_upper_limit(aln->num_states), get_safe_upper_limit(model_factory->unobserved_ptns.size()));
     uint64_t block_size;
-    uint64_t scale_block_size = nptn * site_rate->getNRate() * ((model_factory->fused_mix_rate)? 1 : model->getNMixtures());
+    size_t ncat_mix = site_rate->getNRate() * ((model_factory->fused_mix_rate)? 1 : model->getNMixtures());
+    uint64_t scale_block_size = nptn * ncat_mix;
     block_size = scale_block_size * model->num_states;
+    // memory of one partial_lh, less than block_size if stored in single precision
+    uint64_t lh_block_size = getPartialLhSize();
 
     if (!node) {
         node = (PhyloNode*) root;
@@ -1077,24 +1264,18 @@ void PhyloTree::initializeAllPartialLh(int &index, int &indexlh, PhyloNode *node
             if (max_lh_slots == 0)
                 getMemoryRequired();
 
-            uint64_t mem_size = (uint64_t)max_lh_slots * block_size + 4 + tip_partial_lh_size;
+            uint64_t mem_size = (uint64_t)max_lh_slots * lh_block_size + 4 + tip_partial_lh_size;
 
             if (verbose_mode >= VB_MAX)
                 cout << "Allocating " << mem_size * sizeof(double) << " bytes for partial likelihood vectors" << endl;
-            try {
-                central_partial_lh = aligned_alloc<double>(mem_size);
-            } catch (std::bad_alloc &ba) {
-                outError("Not enough memory for partial likelihood vectors (bad_alloc)");
-            }
-            if (!central_partial_lh)
-                outError("Not enough memory for partial likelihood vectors");
+            allocateCentralPartialLh(mem_size);
         }
 
         // now always assign tip_partial_lh
         if (params->lh_mem_save == LM_PER_NODE) {
-            tip_partial_lh = central_partial_lh + ((nodeNum - leafNum)*block_size);
+            tip_partial_lh = central_partial_lh + ((nodeNum - leafNum)*lh_block_size);
         } else {
-            tip_partial_lh = central_partial_lh + (max_lh_slots*block_size);
+            tip_partial_lh = central_partial_lh + (max_lh_slots*lh_block_size);
         }
 
         if (!central_scale_num) {
@@ -1102,13 +1283,10 @@ void PhyloTree::initializeAllPartialLh(int &index, int &indexlh, PhyloNode *node
 
             if (verbose_mode >= VB_MAX)
                 cout << "Allocating " << mem_size * sizeof(UBYTE) << " bytes for scale num vectors" << endl;
-            try {
-                central_scale_num = aligned_alloc<UBYTE>(mem_size);
-            } catch (std::bad_alloc &ba) {
-                outError("Not enough memory for scale num vectors (bad_alloc)");
-            }
-            if (!central_scale_num)
-                outError("Not enough memory for scale num vectors");
+            allocateCentralScaleNum(mem_size);
+            if (params->numa_aware)
+                firstTouchPartialLh(max_lh_slots, nptn, lh_block_size,
+                    ncat_mix * model->num_states * (float_partial_lh ? sizeof(float) : sizeof(double)), scale_block_size, ncat_mix);
         }
 
         if (!central_partial_pars) {
@@ -1147,7 +1325,7 @@ void PhyloTree::initializeAllPartialLh(int &index, int &indexlh, PhyloNode *node
                 nei->partial_lh = NULL; // do not allocate memory for tip, use tip_partial_lh instead
                 nei->scale_num = NULL;
                 nei2->scale_num = central_scale_num + ((indexlh) * scale_block_size);
-                nei2->partial_lh = central_partial_lh + (indexlh * block_size);
+                nei2->partial_lh = central_partial_lh + (indexlh * lh_block_size);
                 indexlh++;
             } else {
                 nei->partial_lh = NULL; 
@@ -1190,9 +1368,54 @@ size_t PhyloTree::getPartialLhSize() {
     size_t block_size = get_safe_upper_limit(aln->size())+max(get_safe_upper_limit(aln->num_states),
         get_safe_upper_limit(model_factory->unobserved_ptns.size()));
     block_size *= model->num_states * site_rate->getNRate() * ((model_factory->fused_mix_rate)? 1 : model->getNMixtures());
+    if (float_partial_lh)
+        return get_safe_upper_limit_float(block_size) / 2;
     return block_size;
 }
 
+bool PhyloTree::useFloatPartialLh() {
+    if (!params || !params->lh_float || !aln || !model_factory || !model || !site_rate)
+        return false;
+    return getDoublePartialLhReason() == NULL;
+}
+
+const char *PhyloTree::getDoublePartialLhReason() {
+    // only the reversible SIMD kernels of phylokernelnew.h read single-precision partial_lh,
+    // the other readers of partial_lh expect double
+    if (sse < LK_SSE2)
+        return "the non-vectorized likelihood kernel";
+    if (!model->useRevKernel())
+        return "non-reversible models";
+    if (model->isSiteSpecificModel())
+        return "site-specific models";
+    if (model->getNMixtures() > 1)
+        return "mixture models";
+    if (isMixlen())
+        return "mixtures of branch lengths";
+    if (isSuperTree())
+        return "partition models with linked branch lengths";
+    if (isTreeMix())
+        return "tree mixtures";
+    if (params->lh_site_repeats)
+        return "--site-repeats";
+    if (params->bayes_branch_length)
+        return "Bayesian branch lengths";
+    if (params->upper_bound || params->upper_bound_NNI)
+        return "likelihood upper bounds";
+    return NULL;
+}
+
+void PhyloTree::warnDoublePartialLh() {
+    static mutex warned_mutex;
+    static set<string> warned;
+    const char *reason = getDoublePartialLhReason();
+    if (!reason)
+        return;
+    lock_guard<mutex> lock(warned_mutex);
+    if (warned.insert(reason).second)
+        outWarning(string("--float-lh is ignored for ") + reason + ", partial likelihoods are stored in double precision");
+}
+
 size_t PhyloTree::getPartialLhBytes() {
     // +num_states for ascertainment bias correction
     return getPartialLhSize() * sizeof(double);
@@ -1255,7 +1478,7 @@ double PhyloTree::computeLikelihood(double *pattern_lh) {
         int nptn = aln->getNPattern();
         //double check_score = 0.0;
         for (int i = 0; i < nptn; i++) {
-            pattern_lh[i] += max(current_it->scale_num[i], UBYTE(0)) * LOG_SCALING_THRESHOLD;
+            pattern_lh[i] += max(current_it->scale_num[i], UBYTE(0)) * getLogScalingThreshold();
             //check_score += (pattern_lh[i] * (aln->at(i).frequency));
         }
         /*       if (fabs(score - check_score) > 1e-6) {
@@ -1461,20 +1684,21 @@ void PhyloTree::computePatternLikelihood(double *ptn_lh, double *cur_logl, doubl
     } 
     
     double sum_scaling = current_it->lh_scale_factor + current_it_back->lh_scale_factor;
+    double log_scaling_threshold = getLogScalingThreshold();
     //double sum_scaling = 0.0;
     if (sum_scaling < 0.0) {
         if (current_it->lh_scale_factor == 0.0) {
             for (i = 0; i < nptn; i++) {
-                ptn_lh[i] = _pattern_lh[i] + (max(UBYTE(0), current_it_back->scale_num[i])) * LOG_SCALING_THRESHOLD;
+                ptn_lh[i] = _pattern_lh[i] + (max(UBYTE(0), current_it_back->scale_num[i])) * log_scaling_threshold;
             }
         } else if (current_it_back->lh_scale_factor == 0.0){
             for (i = 0; i < nptn; i++) {
-                ptn_lh[i] = _pattern_lh[i] + (max(UBYTE(0), current_it->scale_num[i])) * LOG_SCALING_THRESHOLD;
+                ptn_lh[i] = _pattern_lh[i] + (max(UBYTE(0), current_it->scale_num[i])) * log_scaling_threshold;
             }
         } else {
             for (i = 0; i < nptn; i++) {
                 ptn_lh[i] = _pattern_lh[i] + (max(UBYTE(0), current_it->scale_num[i]) +
-                    max(UBYTE(0), current_it_back->scale_num[i])) * LOG_SCALING_THRESHOLD;
+                    max(UBYTE(0), current_it_back->scale_num[i])) * log_scaling_threshold;
             }
         }
     } else {
@@ -1535,7 +1759,7 @@ void PhyloTree::computePatternLikelihood(double *ptn_lh, double *cur_logl, doubl
             // per-category scaling
             for (ptn = 0; ptn < nptn; ptn++) {
                 for (i = 0; i < ncat; i++) {
-                    out_lh_cat[i] = log(lh_cat[i]) + nei2_scale[i] * LOG_SCALING_THRESHOLD;
+                    out_lh_cat[i] = log(lh_cat[i]) + nei2_scale[i] * log_scaling_threshold;
                 }
                 lh_cat += ncat;
                 out_lh_cat += ncat;
@@ -1544,7 +1768,7 @@ void PhyloTree::computePatternLikelihood(double *ptn_lh, double *cur_logl, doubl
         } else {
             // normal scaling
             for (ptn = 0; ptn < nptn; ptn++) {
-                double scale = nei2_scale[ptn] * LOG_SCALING_THRESHOLD;
+                double scale = nei2_scale[ptn] * log_scaling_threshold;
                 for (i = 0; i < ncat; i++)
                     out_lh_cat[i] = log(lh_cat[i]) + scale;
                 lh_cat += ncat;
@@ -1561,7 +1785,7 @@ void PhyloTree::computePatternLikelihood(double *ptn_lh, double *cur_logl, doubl
             // per-category scaling
             for (ptn = 0; ptn < nptn; ptn++) {
                 for (i = 0; i < ncat; i++) {
-                    out_lh_cat[i] = log(lh_cat[i]) + (nei1_scale[i]+nei2_scale[i]) * LOG_SCALING_THRESHOLD;
+                    out_lh_cat[i] = log(lh_cat[i]) + (nei1_scale[i]+nei2_scale[i]) * log_scaling_threshold;
                 }
                 lh_cat += ncat;
                 out_lh_cat += ncat;
@@ -1571,7 +1795,7 @@ void PhyloTree::computePatternLikelihood(double *ptn_lh, double *cur_logl, doubl
         } else {
             // normal scaling
             for (ptn = 0; ptn < nptn; ptn++) {
-                double scale = (nei1_scale[ptn] + nei2_scale[ptn]) * LOG_SCALING_THRESHOLD;
+                double scale = (nei1_scale[ptn] + nei2_scale[ptn]) * log_scaling_threshold;
                 for (i = 0; i < ncat; i++)
                     out_lh_cat[i] = log(lh_cat[i]) + scale;
                 lh_cat += ncat;
@@ -3704,6 +3928,8 @@ void PhyloTree::computeBioNJ(Params &params) {
             ( params.start_tree_subtype_name);
     bool wasDoneInMemory = false;
 #ifdef _OPENMP
+    // this may run inside a parallel region (--boot-workers), keep its nesting
+    int saved_nested = omp_get_nested();
     omp_set_nested(true);
     #pragma omp parallel num_threads(2)
     {
@@ -3741,8 +3967,7 @@ void PhyloTree::computeBioNJ(Params &params) {
         }
     }
     #ifdef _OPENMP
-        #pragma omp barrier
-        omp_set_nested(false);
+        omp_set_nested(saved_nested);
     #endif
         
     if (!wasDoneInMemory) {
@@ -4009,12 +4234,16 @@ void PhyloTree::doNNI(NNIMove &move, bool clearLH) {
         updateSubtreeDists(move);
     }
 
-    // update split store in node
+    // update split store in node, reusing the Split objects
     if (nei12->split != NULL || nei21->split != NULL) {
-        delete nei12->split;
-        nei12->split = new Split(leafNum);
-        delete nei21->split;
-        nei21->split = new Split(leafNum);
+        if (!nei12->split)
+            nei12->split = new Split(leafNum);
+        if (!nei21->split)
+            nei21->split = new Split(leafNum);
+        fill(nei12->split->begin(), nei12->split->end(), 0);
+        fill(nei21->split->begin(), nei21->split->end(), 0);
+        nei12->split->setWeight(0.0);
+        nei21->split->setWeight(0.0);
 
         FOR_NEIGHBOR_IT(nei12->node, node1, it)
                 *(nei12->split) += *((*it)->split);
@@ -4115,10 +4344,14 @@ NNIMove PhyloTree::getBestNNIForBran(PhyloNode *node1, PhyloNode *node2, NNIMove
 
     Neighbor *saved_nei[6];
     int mem_id = 0;
-    // save Neighbor and allocate new Neighbor pointer
+    // save Neighbor and put a temporary copy in place, allocated only once per tree
     for (id = 0; id < IT_NUM; id++) {
         saved_nei[id] = (*saved_it[id]);
-        *saved_it[id] = saved_nei[id]->newNeighbor();
+        if (id < nni_temp_nei.size())
+            nni_temp_nei[id]->copyNeighbor(saved_nei[id]);
+        else
+            nni_temp_nei.push_back(saved_nei[id]->newNeighbor());
+        *saved_it[id] = nni_temp_nei[id];
 
         if (((PhyloNeighbor*)saved_nei[id])->partial_lh) {
             ((PhyloNeighbor*) (*saved_it[id]))->partial_lh = nni_partial_lh + mem_id*partial_lh_size;
@@ -4138,11 +4371,9 @@ NNIMove PhyloTree::getBestNNIForBran(PhyloNode *node1, PhyloNode *node2, NNIMove
     int cnt;
 
     //NNIMove nniMoves[2];
-    bool newNNIMoves = false;
     if (nniMoves==nullptr) {
-        //   Initialize the 2 NNI moves
-        newNNIMoves = true;
-        nniMoves = new NNIMove[2];
+        //   Initialize the 2 NNI moves, reusing the branch length vectors of the last call
+        nniMoves = nni_moves;
         nniMoves[0].ptnlh = nniMoves[1].ptnlh = NULL;
         nniMoves[0].node1 = NULL;
     }
@@ -4283,7 +4514,6 @@ NNIMove PhyloTree::getBestNNIForBran(PhyloNode *node1, PhyloNode *node2, NNIMove
          if (*saved_it[id] == current_it) current_it = (PhyloNeighbor*) saved_nei[id];
          if (*saved_it[id] == current_it_back) current_it_back = (PhyloNeighbor*) saved_nei[id];
 
-         delete (*saved_it[id]);
          (*saved_it[id]) = saved_nei[id];
      }
 
@@ -4304,9 +4534,6 @@ NNIMove PhyloTree::getBestNNIForBran(PhyloNode *node1, PhyloNode *node2, NNIMove
      } else {
          res = nniMoves[1];
      }
-    if (newNNIMoves) {
-        delete [] nniMoves;
-    }
     return res;
 }
 
@@ -4871,6 +5098,295 @@ void PhyloTree::regraftSubtree(PruningInfo &info, PhyloNode *in_node, PhyloNode
     info.dad->updateNeighbor(info.dad_it_left, in_node_nei);
 }
 
+/****************************************************************************
+ Lazy subtree pruning and regrafting
+ ****************************************************************************/
+
+bool PhyloTree::isLazySPRSupported() {
+    return !isSuperTree() && !isMixlen() && !rooted && params->lh_mem_save != LM_MEM_SAVE && leafNum >= 5;
+}
+
+void PhyloTree::swapPartialLh(PhyloNeighbor *nei1, PhyloNeighbor *nei2) {
+    std::swap(nei1->partial_lh, nei2->partial_lh);
+    std::swap(nei1->scale_num, nei2->scale_num);
+    std::swap(nei1->lh_scale_factor, nei2->lh_scale_factor);
+    std::swap(nei1->size, nei2->size);
+    std::swap(nei1->repeats, nei2->repeats);
+    // only the likelihood moves along, partial parsimony stays with the neighbor
+    int computed1 = nei1->partial_lh_computed & 1;
+    nei1->partial_lh_computed = nei2->partial_lh_computed & 1;
+    nei2->partial_lh_computed = computed1;
+}
+
+void PhyloTree::detachSubtree(PhyloNode *node, PhyloNode *dad) {
+    PhyloNeighbor *node_nei = (PhyloNeighbor*)node->findNeighbor(dad);
+    // keep the partial likelihood memory of dad on the only neighbor that still points to it
+    reorientPartialLh(node_nei, node);
+    node_nei->clearPartialLh();
+
+    PhyloNeighbor *dad_nei[2];
+    int i = 0;
+    FOR_NEIGHBOR_IT(dad, node, it)
+        dad_nei[i++] = (PhyloNeighbor*)(*it);
+    ASSERT(i == 2);
+    PhyloNode *left = (PhyloNode*)dad_nei[0]->node;
+    PhyloNode *right = (PhyloNode*)dad_nei[1]->node;
+    PhyloNeighbor *left_nei = (PhyloNeighbor*)left->findNeighbor(dad);
+    PhyloNeighbor *right_nei = (PhyloNeighbor*)right->findNeighbor(dad);
+
+    double len = left_nei->length + right_nei->length;
+    left_nei->node = right;
+    left_nei->length = len;
+    right_nei->node = left;
+    right_nei->length = len;
+    // the subtree below right seen from left is the one seen from dad before
+    swapPartialLh(left_nei, dad_nei[1]);
+    swapPartialLh(right_nei, dad_nei[0]);
+
+    // the joined branch keeps the ID of (left-dad), (right-dad) waits on the free neighbors of dad
+    int free_id = right_nei->id;
+    right_nei->id = left_nei->id;
+    dad_nei[0]->id = dad_nei[1]->id = free_id;
+    dad_nei[0]->clearPartialLh();
+    dad_nei[1]->clearPartialLh();
+}
+
+void PhyloTree::attachSubtree(PhyloNode *node, PhyloNode *dad, PhyloNode *node2, PhyloNode *dad2) {
+    PhyloNeighbor *dad_nei[2];
+    int i = 0;
+    FOR_NEIGHBOR_IT(dad, node, it)
+        dad_nei[i++] = (PhyloNeighbor*)(*it);
+    ASSERT(i == 2);
+    PhyloNeighbor *node2_nei = (PhyloNeighbor*)node2->findNeighbor(dad2);
+    PhyloNeighbor *dad2_nei = (PhyloNeighbor*)dad2->findNeighbor(node2);
+
+    double len = node2_nei->length / 2;
+    dad_nei[0]->node = node2;
+    dad_nei[0]->length = len;
+    dad_nei[1]->node = dad2;
+    dad_nei[1]->length = len;
+    node2_nei->node = dad;
+    node2_nei->length = len;
+    dad2_nei->node = dad;
+    dad2_nei->length = len;
+    swapPartialLh(dad_nei[0], dad2_nei);
+    swapPartialLh(dad_nei[1], node2_nei);
+
+    dad_nei[0]->id = node2_nei->id;
+    dad2_nei->id = dad_nei[1]->id;
+    node2_nei->clearPartialLh();
+    dad2_nei->clearPartialLh();
+    ((PhyloNeighbor*)node->findNeighbor(dad))->clearPartialLh();
+}
+
+double PhyloTree::regraftLazySPR(PhyloNode *node, PhyloNode *dad, PhyloNode *node2, PhyloNode *dad2) {
+    attachSubtree(node, dad, node2, dad2);
+    PhyloNode *ends[3] = {node, node2, dad2};
+    PhyloNeighbor *dad_nei[3];
+    for (int i = 0; i < 3; i++)
+        dad_nei[i] = (PhyloNeighbor*)ends[i]->findNeighbor(dad);
+    for (int i = 0; i < 3; i++) {
+        // each new length outdates the partial likelihoods pointing to dad,
+        // but the branch to ends[i] only needs the one from ends[i]
+        for (int j = 0; j < 3; j++)
+            dad_nei[j]->clearPartialLh();
+        optimizeOneBranch(ends[i], dad, false, LAZY_SPR_NR_STEP);
+    }
+    return computeLikelihoodFromBuffer();
+}
+
+void PhyloTree::evaluateLazySPRRegraft(SPRMove &move, PhyloNode *node2, PhyloNode *dad2, int depth, int radius) {
+    PhyloNeighbor *node2_nei = (PhyloNeighbor*)node2->findNeighbor(dad2);
+    PhyloNeighbor *dad2_nei = (PhyloNeighbor*)dad2->findNeighbor(node2);
+    PhyloNeighbor *node_nei = (PhyloNeighbor*)move.prune_node->findNeighbor(move.prune_dad);
+    PhyloNeighbor *dad_nei = (PhyloNeighbor*)move.prune_dad->findNeighbor(move.prune_node);
+    double len = node2_nei->length;
+    double node_len = node_nei->length;
+    double score = regraftLazySPR(move.prune_node, move.prune_dad, node2, dad2);
+    detachSubtree(move.prune_node, move.prune_dad);
+    node2_nei->length = dad2_nei->length = len;
+    node_nei->length = dad_nei->length = node_len;
+    if (score > move.score) {
+        move.score = score;
+        move.regraft_node = node2;
+        move.regraft_dad = dad2;
+    }
+    if (depth >= radius)
+        return;
+    FOR_NEIGHBOR_IT(node2, dad2, it)
+        evaluateLazySPRRegraft(move, (PhyloNode*)(*it)->node, node2, depth + 1, radius);
+}
+
+void PhyloTree::evaluateLazySPR(SPRMove &move, int radius) {
+    PhyloNode *node = move.prune_node;
+    PhyloNode *dad = move.prune_dad;
+    move.regraft_node = move.regraft_dad = NULL;
+    move.score = -DBL_MAX;
+
+    PhyloNode *left = NULL, *right = NULL;
+    double left_len = 0.0, right_len = 0.0;
+    FOR_NEIGHBOR_IT(dad, node, it) {
+        if (!left) {
+            left = (PhyloNode*)(*it)->node;
+            left_len = (*it)->length;
+        } else {
+            right = (PhyloNode*)(*it)->node;
+            right_len = (*it)->length;
+        }
+    }
+
+    detachSubtree(node, dad);
+    // partial likelihoods toward the joined branch still contain the subtree, all
+    // others are reused by every regraft position
+    left->clearReversePartialLh(right);
+    right->clearReversePartialLh(left);
+    FOR_NEIGHBOR_IT(left, right, it)
+        evaluateLazySPRRegraft(move, (PhyloNode*)(*it)->node, left, 1, radius);
+    FOR_NEIGHBOR_IT(right, left, it)
+        evaluateLazySPRRegraft(move, (PhyloNode*)(*it)->node, right, 1, radius);
+
+    // put the subtree back
+    attachSubtree(node, dad, left, right);
+    left->findNeighbor(dad)->length = dad->findNeighbor(left)->length = left_len;
+    right->findNeighbor(dad)->length = dad->findNeighbor(right)->length = right_len;
+    dad->clearReversePartialLh(node);
+    current_it = (PhyloNeighbor*)node->findNeighbor(dad);
+    current_it_back = (PhyloNeighbor*)dad->findNeighbor(node);
+}
+
+void PhyloTree::evaluateLazySPRMoves(vector<SPRMove> &moves, int radius) {
+    for (SPRMove &move : moves)
+        evaluateLazySPR(move, radius);
+}
+
+double PhyloTree::applyLazySPR(SPRMove &move) {
+    PhyloNode *node = move.prune_node, *dad = move.prune_dad;
+    PhyloNode *node2 = move.regraft_node, *dad2 = move.regraft_dad;
+    PhyloNode *left = NULL, *right = NULL;
+    double left_len = 0.0, right_len = 0.0;
+    FOR_NEIGHBOR_IT(dad, node, it) {
+        if (!left) {
+            left = (PhyloNode*)(*it)->node;
+            left_len = (*it)->length;
+        } else {
+            right = (PhyloNode*)(*it)->node;
+            right_len = (*it)->length;
+        }
+    }
+    double node_len = node->findNeighbor(dad)->length;
+    double regraft_len = node2->findNeighbor(dad2)->length;
+    // computeLikelihood() overwrites curScore
+    double cur_score = curScore;
+
+    detachSubtree(node, dad);
+    // everything pointing toward the prune or regraft point changes
+    left->clearReversePartialLh(right);
+    right->clearReversePartialLh(left);
+    node2->clearReversePartialLh(dad2);
+    dad2->clearReversePartialLh(node2);
+    node->clearReversePartialLh(dad);
+    regraftLazySPR(node, dad, node2, dad2);
+
+    optimizeOneBranch(left, right);
+    optimizeOneBranch(node, dad);
+    optimizeOneBranch(node2, dad);
+    optimizeOneBranch(dad2, dad);
+    double score = computeLikelihood();
+    if (score > cur_score)
+        return score;
+
+    // move back
+    detachSubtree(node, dad);
+    attachSubtree(node, dad, left, right);
+    left->findNeighbor(dad)->length = dad->findNeighbor(left)->length = left_len;
+    right->findNeighbor(dad)->length = dad->findNeighbor(right)->length = right_len;
+    node->findNeighbor(dad)->length = dad->findNeighbor(node)->length = node_len;
+    node2->findNeighbor(dad2)->length = dad2->findNeighbor(node2)->length = regraft_len;
+    clearAllPartialLH();
+    current_it = (PhyloNeighbor*)node->findNeighbor(dad);
+    current_it_back = (PhyloNeighbor*)dad->findNeighbor(node);
+    curScore = cur_score;
+    return curScore;
+}
+
+void PhyloTree::getLazySPRPrunings(vector<SPRMove> &moves, PhyloNode *node, PhyloNode *dad) {
+    if (!node)
+        node = (PhyloNode*)root;
+    FOR_NEIGHBOR_IT(node, dad, it) {
+        PhyloNode *child = (PhyloNode*)(*it)->node;
+        SPRMove move;
+        move.regraft_node = move.regraft_dad = NULL;
+        move.score = -DBL_MAX;
+        if (!node->isLeaf()) {
+            move.prune_node = child;
+            move.prune_dad = node;
+            moves.push_back(move);
+        }
+        if (!child->isLeaf()) {
+            move.prune_node = node;
+            move.prune_dad = child;
+            moves.push_back(move);
+        }
+        getLazySPRPrunings(moves, child, node);
+    }
+}
+
+/**
+    @return TRUE if target is in the subtree below node, seen from dad
+*/
+static bool isInSubtree(Node *target, Node *node, Node *dad) {
+    if (node == target)
+        return true;
+    FOR_NEIGHBOR_IT(node, dad, it)
+        if (isInSubtree(target, (*it)->node, node))
+            return true;
+    return false;
+}
+
+double PhyloTree::optimizeLazySPR(int radius) {
+    curScore = computeLikelihood();
+    if (!isLazySPRSupported() || radius < 1)
+        return curScore;
+    int total_moves = 0;
+    for (int step = 1; step <= leafNum; step++) {
+        vector<SPRMove> moves;
+        getLazySPRPrunings(moves);
+        evaluateLazySPRMoves(moves, radius);
+        stable_sort(moves.begin(), moves.end(),
+            [](const SPRMove &a, const SPRMove &b) { return a.score > b.score; });
+
+        // apply improving moves best first, skipping those around already moved subtrees.
+        // Scores are relative to the tree before the first move
+        double eval_score = curScore;
+        vector<bool> touched(nodeNum, false);
+        int num_moves = 0;
+        for (SPRMove &move : moves) {
+            if (move.score <= eval_score + params->loglh_epsilon)
+                break;
+            if (touched[move.prune_node->id] || touched[move.prune_dad->id] ||
+                touched[move.regraft_node->id] || touched[move.regraft_dad->id])
+                continue;
+            // another move may have put the regraft branch into the subtree
+            if (isInSubtree(move.regraft_dad, move.prune_node, move.prune_dad))
+                continue;
+            FOR_NEIGHBOR_IT(move.prune_dad, NULL, it)
+                touched[(*it)->node->id] = true;
+            touched[move.prune_dad->id] = touched[move.regraft_node->id] = touched[move.regraft_dad->id] = true;
+            double cur_score = curScore;
+            if (applyLazySPR(move) > cur_score)
+                num_moves++;
+        }
+        total_moves += num_moves;
+        if (verbose_mode >= VB_MED)
+            cout << "Lazy SPR round " << step << ": " << num_moves << " moves, LogL: " << curScore << endl;
+        if (num_moves == 0)
+            break;
+    }
+    if (total_moves > 0 && root->neighbors[0]->split)
+        buildNodeSplit();
+    return curScore;
+}
+
 /****************************************************************************
  Approximate Likelihood Ratio Test with SH-like interpretation
  ****************************************************************************/
@@ -5904,6 +6420,140 @@ void PhyloTree::reorientPartialLh(PhyloNeighbor* dad_branch, Node *dad) {
         helper functions for computing tree traversal
  ****************************************************************************/
 
+/** site repeats only pay off if a subtree has at most this fraction of classes per pattern */
+const double MAX_REPEAT_CLASS_RATIO = 0.5;
+
+int PhyloTree::getPatternState(PhyloNode *leaf, size_t ptn, size_t max_orig_nptn) {
+    if (ptn < aln->size()) {
+        const char *state_row = getConvertedSequenceByNumber(leaf->id);
+        if (state_row)
+            return state_row[ptn];
+        return aln->at(ptn)[leaf->id];
+    }
+    if (ptn >= max_orig_nptn && ptn - max_orig_nptn < model_factory->unobserved_ptns.size())
+        return model_factory->unobserved_ptns[ptn - max_orig_nptn][leaf->id];
+    return aln->STATE_UNKNOWN;
+}
+
+void PhyloTree::updateRepeatClasses(size_t max_orig_nptn, size_t nptn) {
+    // the invariant-site status decides whether a pattern is scaled, so it is part of the classes
+    bool changed = repeat_invar.size() != nptn;
+    repeat_invar.resize(nptn);
+    for (size_t ptn = 0; ptn < nptn; ptn++) {
+        char invar = (ptn_invar[ptn] != 0.0);
+        if (repeat_invar[ptn] != invar) {
+            repeat_invar[ptn] = invar;
+            changed = true;
+        }
+    }
+    if (changed)
+        repeat_epoch = repeat_counter;
+    if (repeat_workspace.size() < num_packets)
+        repeat_workspace.resize(num_packets);
+    for (auto it = traversal_info.begin(); it != traversal_info.end(); it++)
+        computeRepeatClasses(it->dad_branch, it->dad, max_orig_nptn, nptn);
+}
+
+void PhyloTree::computeRepeatClasses(PhyloNeighbor *dad_branch, PhyloNode *dad, size_t max_orig_nptn, size_t nptn) {
+    PhyloNode *node = (PhyloNode*)dad_branch->node;
+    RepeatClasses &repeats = dad_branch->repeats;
+    if (node->isLeaf())
+        return;
+
+    PhyloNeighbor *child[2];
+    int64_t child_version[2] = {0, 0};
+    int num_children = 0;
+    FOR_NEIGHBOR_IT(node, dad, it) {
+        if (num_children < 2) {
+            child[num_children] = (PhyloNeighbor*)*it;
+            if (!child[num_children]->node->isLeaf()) {
+                if (child[num_children]->repeats.version <= repeat_epoch)
+                    computeRepeatClasses(child[num_children], node, max_orig_nptn, nptn);
+                child_version[num_children] = child[num_children]->repeats.version;
+            } else {
+                // tip states never change
+                child_version[num_children] = -1 - child[num_children]->node->id;
+            }
+        }
+        num_children++;
+    }
+    if (repeats.version > repeat_epoch &&
+        repeats.child_version[0] == child_version[0] && repeats.child_version[1] == child_version[1])
+        return;
+
+    repeats.version = ++repeat_counter;
+    repeats.child_version[0] = child_version[0];
+    repeats.child_version[1] = child_version[1];
+    repeats.num_classes = 0;
+
+    // a subtree has at least as many classes as each of its subtrees
+    bool use_repeats = (num_children == 2);
+    size_t child_classes[2];
+    for (int i = 0; i < 2 && use_repeats; i++) {
+        if (child[i]->node->isLeaf())
+            child_classes[i] = aln->STATE_UNKNOWN+1;
+        else
+            child_classes[i] = child[i]->repeats.num_classes;
+        if (child_classes[i] == 0)
+            use_repeats = false;
+    }
+    if (!use_repeats) {
+        vector<int>().swap(repeats.pattern_class);
+        return;
+    }
+
+    // class of each pattern in the two subtrees
+    vector<int> classes[2];
+    for (int i = 0; i < 2; i++) {
+        if (!child[i]->node->isLeaf())
+            continue;
+        classes[i].resize(nptn);
+        for (size_t ptn = 0; ptn < nptn; ptn++) {
+            int state = getPatternState((PhyloNode*)child[i]->node, ptn, max_orig_nptn);
+            if (state < 0 || state > aln->STATE_UNKNOWN) {
+                vector<int>().swap(repeats.pattern_class);
+                return;
+            }
+            classes[i][ptn] = state;
+        }
+    }
+    int *class0 = child[0]->node->isLeaf() ? classes[0].data() : child[0]->repeats.pattern_class.data();
+    int *class1 = child[1]->node->isLeaf() ? classes[1].data() : child[1]->repeats.pattern_class.data();
+
+    // number the class pairs in the order of their first pattern, directly indexed if small enough,
+    // otherwise in a hash table with linear probing that holds at most max_classes keys
+    size_t max_classes = nptn * MAX_REPEAT_CLASS_RATIO;
+    uint64_t num_keys = (uint64_t)child_classes[0] * child_classes[1] * 2;
+    bool direct = num_keys <= 4*nptn;
+    int hash_bits = 1;
+    while (!direct && ((uint64_t)1 << hash_bits) < 2*max_classes)
+        hash_bits++;
+    size_t table_size = direct ? num_keys : ((size_t)1 << hash_bits);
+    vector<int> table_class(table_size, -1);
+    vector<int64_t> table_key(direct ? 0 : table_size);
+    repeats.pattern_class.resize(nptn);
+    int num_classes = 0;
+    for (size_t ptn = 0; ptn < nptn; ptn++) {
+        int64_t key = ((int64_t)class0[ptn] * child_classes[1] + class1[ptn]) * 2 + repeat_invar[ptn];
+        size_t pos = key;
+        if (!direct) {
+            pos = ((uint64_t)key * 0x9E3779B97F4A7C15ULL) >> (64 - hash_bits);
+            while (table_class[pos] >= 0 && table_key[pos] != key)
+                pos = (pos + 1) & (table_size - 1);
+            table_key[pos] = key;
+        }
+        if (table_class[pos] < 0) {
+            if (num_classes >= max_classes) {
+                vector<int>().swap(repeats.pattern_class);
+                return;
+            }
+            table_class[pos] = num_classes++;
+        }
+        repeats.pattern_class[ptn] = table_class[pos];
+    }
+    repeats.num_classes = num_classes;
+}
+
 bool PhyloTree::computeTraversalInfo(PhyloNeighbor *dad_branch, PhyloNode *dad, double* &buffer) {
 
     size_t nstates = aln->num_states;
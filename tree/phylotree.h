@@ -54,6 +54,23 @@ class AlignmentPairwise;
 #define BootValType float
 //#define BootValType double
 
+/** pattern count in a UFBoot sample, counts from BOOT_COUNT_MAX are stored in BootCountOverflow */
+typedef unsigned char BootCountType;
+#define BOOT_COUNT_MAX 255
+
+/** (pattern, count) pairs of one UFBoot sample with count >= BOOT_COUNT_MAX, sorted by pattern */
+typedef vector<pair<int, int> > BootCountOverflow;
+
+/**
+    split the patterns into the packets processed by the likelihood kernels
+    @param threads number of threads
+    @param packets number of packets
+    @param elements number of patterns
+    @param vector_size SIMD vector size, packet bounds are multiples of it
+    @param[out] limits packets+1 pattern bounds
+*/
+void computePacketBounds(int threads, int packets, size_t elements, size_t vector_size, vector<size_t> &limits);
+
 enum CostMatrixType {CM_UNIFORM, CM_LINEAR};
 
 //extern int instruction_set;
@@ -78,9 +95,16 @@ const double TOL_LIKELIHOOD_PARAMOPT = 0.001; // BQM: newly introduced for Model
 //#define SCALING_THRESHOLD ldexp(1.0, -256)
 //#define LOG_SCALING_THRESHOLD log(SCALING_THRESHOLD)
 #define LOG_SCALING_THRESHOLD -177.4456782233459932741
+// 2^{-64}, for partial likelihoods stored in single precision (--float-lh)
+#define SCALING_THRESHOLD_FLOAT_EXP 64
+#define SCALING_THRESHOLD_FLOAT 5.421010862427522170037e-20
+#define LOG_SCALING_THRESHOLD_FLOAT -44.36141955583649980270
 
 const int SPR_DEPTH = 2;
 
+/** maximal number of Newton-Raphson steps per branch when scoring a lazy SPR regraft position */
+const int LAZY_SPR_NR_STEP = 3;
+
 //using namespace Eigen;
 
 #ifndef ROUND_UP_TO_MULTIPLE
@@ -603,6 +627,36 @@ public:
     typedef BootValType (PhyloTree::*DotProductType)(BootValType *x, BootValType *y, int size);
     DotProductType dotProduct;
 
+    /**
+        dot products of vector x with each row of a row-major matrix of pattern counts, blocked over columns
+        @param x vector of size elements
+        @param mat first row of the matrix
+        @param overflow counts >= BOOT_COUNT_MAX of each row
+        @param stride distance between two rows of the matrix
+        @param nrows number of rows
+        @param size number of columns, a multiple of the vector size
+        @param[out] res nrows dot products
+        @param buffer getDotProductMatrixBufferSize(nrows) aligned elements of the calling thread
+    */
+    template <class Numeric, class VectorClass>
+    void dotProductMatrixSIMD(Numeric *x, BootCountType *mat, BootCountOverflow *overflow, size_t stride, int nrows, int size, Numeric *res,
+        Numeric *buffer);
+
+    typedef void (PhyloTree::*DotProductMatrixType)(BootValType *x, BootCountType *mat, BootCountOverflow *overflow, size_t stride, int nrows, int size, BootValType *res,
+        BootValType *buffer);
+    DotProductMatrixType dotProductMatrix;
+
+    /** columns of a block of dotProductMatrixSIMD: 4 converted rows and x of a block take 20 KB, fitting a 32 KB L1 cache */
+    static const int DOT_MATRIX_BLOCK = 4096 / sizeof(BootValType);
+
+    /**
+        @param nrows number of rows passed to dotProductMatrix
+        @return number of elements of the buffer of one thread, for any vector size up to 16
+    */
+    static size_t getDotProductMatrixBufferSize(int nrows) {
+        return nrows*16 + 4*DOT_MATRIX_BLOCK;
+    }
+
     typedef double (PhyloTree::*DotProductDoubleType)(double *x, double *y, int size);
     DotProductDoubleType dotProductDouble;
 
@@ -694,6 +748,24 @@ public:
 
     template<class VectorClass>
     int computeParsimonyBranchSankoffSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad, int *branch_subst = NULL);
+
+    typedef UINT (PhyloTree::*ComputeParsimonyInsertType)(PhyloNeighbor *, PhyloNode *, NodeVector &, NodeVector &, int &);
+    /** NULL if the parsimony kernel has no batched insertion, see addTaxonMPFast() for the fallback */
+    ComputeParsimonyInsertType computeParsimonyInsertPointer;
+
+    /**
+            score the insertion of a subtree into each of the given branches in one pass
+            over the branches, without changing the tree and without storing the partial
+            parsimony of the new internal node
+            @param added_branch branch from added_node leading to the subtree to insert
+            @param added_node the new internal node, not yet in the tree
+            @param nodes1, nodes2 the end nodes of the candidate branches
+            @param[out] best_id index of the best branch, the first one on ties
+            @return parsimony score of the tree after inserting into branch best_id
+     */
+    template<class VectorClass>
+    UINT computeParsimonyInsertFastSIMD(PhyloNeighbor *added_branch, PhyloNode *added_node,
+        NodeVector &nodes1, NodeVector &nodes2, int &best_id);
     
 //    void printParsimonyStates(PhyloNeighbor *dad_branch = NULL, PhyloNode *dad = NULL);
 
@@ -706,6 +778,10 @@ public:
 
     virtual void setParsimonyKernelSSE();
 
+#ifdef __AVX512KNL
+    void setParsimonyKernelAVX512();
+#endif
+
     /****************************************************************************
      Sankoff Parsimony function
      ****************************************************************************/
@@ -757,6 +833,9 @@ public:
 
     size_t getBufferPartialLhSize();
 
+    /** number of doubles of buffer_float_lh per packet (--float-lh) */
+    size_t getBufferFloatLhSize();
+
     /**
             initialize partial_lh vector of all PhyloNeighbors, allocating central_partial_lh
      */
@@ -775,6 +854,48 @@ public:
      */
     virtual void initializeAllPartialLh(int &index, int &indexlh, PhyloNode *node = NULL, PhyloNode *dad = NULL);
 
+    /**
+            NUMA mode: every slot is first written packet by packet with the same bounds
+            and schedule as the likelihood kernels, so that each page is placed on the
+            node of the thread that later computes on it
+            @param num_slots number of slots in central_partial_lh and central_scale_num
+            @param nptn number of patterns per slot
+            @param block_size number of doubles per partial_lh slot
+            @param ptn_lh_bytes number of bytes of partial_lh per pattern
+            @param scale_block_size number of bytes per scale_num slot
+            @param ptn_scale_size number of scale_num entries per pattern
+     */
+    void firstTouchPartialLh(uint64_t num_slots, size_t nptn, uint64_t block_size, size_t ptn_lh_bytes,
+        uint64_t scale_block_size, size_t ptn_scale_size);
+
+    /**
+            allocate central_partial_lh, mapped to a scratch file if --scratch-dir is given
+            @param entries number of doubles
+     */
+    void allocateCentralPartialLh(uint64_t entries);
+
+    /**
+            allocate central_scale_num, mapped to a scratch file if --scratch-dir is given
+            @param entries number of bytes
+     */
+    void allocateCentralScaleNum(uint64_t entries);
+
+    /**
+            free central_partial_lh and central_scale_num, whether in RAM or mapped to scratch files
+     */
+    void freeCentralPartialLh();
+
+    /**
+            out-of-core mode: ask the OS to read in the partial likelihoods of the children
+            of all branches in traversal_info, in traversal order
+     */
+    void prefetchTraversalPartialLh();
+
+    /**
+            out-of-core mode: start writing back the partial likelihoods computed for traversal_info
+     */
+    void writeBackTraversalPartialLh();
+
 
     /**
             clear all partial likelihood for a clean computation again
@@ -799,8 +920,30 @@ public:
 
     /** get the number of bytes occupied by partial_lh */
     size_t getPartialLhBytes();
+
+    /** get the number of doubles occupied by partial_lh, half the entries if stored in single precision */
     size_t getPartialLhSize();
 
+    /**
+        @return true if partial_lh can be stored in single precision (--float-lh),
+        only the reversible SIMD kernels convert it to double
+    */
+    bool useFloatPartialLh();
+
+    /**
+        @return why partial_lh cannot be stored in single precision despite --float-lh,
+        NULL if it can
+    */
+    const char *getDoublePartialLhReason();
+
+    /** warn once per reason that --float-lh is ignored for this tree */
+    void warnDoublePartialLh();
+
+    /** log of the factor that one unit of scale_num stands for */
+    double getLogScalingThreshold() {
+        return float_partial_lh ? LOG_SCALING_THRESHOLD_FLOAT : LOG_SCALING_THRESHOLD;
+    }
+
     /**
             allocate memory for a scale num vector
      */
@@ -835,6 +978,9 @@ public:
     /** number of packets used for likelihood kernel (typically more) */
     int num_packets;
 
+    /** number of packets buffer_partial_lh was sized for, 0 if not allocated */
+    int buffer_num_packets;
+
     /****************************************************************************
             helper functions for computing tree traversal
      ****************************************************************************/
@@ -854,6 +1000,27 @@ public:
     template<class VectorClass>
     void computeTraversalInfo(PhyloNode *node, PhyloNode *dad, bool compute_partial_lh);
 
+    /**
+        site repeats: bring the repeat classes of all branches in traversal_info up to date
+        @param max_orig_nptn number of patterns rounded up to the vector size
+        @param nptn number of patterns including unobserved ones, rounded up to the vector size
+    */
+    void updateRepeatClasses(size_t max_orig_nptn, size_t nptn);
+
+    /**
+        site repeats: compute the repeat classes of a subtree unless they are up to date,
+        also for outdated subtrees below
+        @param dad_branch the branch leading to the subtree
+        @param dad its dad, used to direct the traversal
+    */
+    void computeRepeatClasses(PhyloNeighbor *dad_branch, PhyloNode *dad, size_t max_orig_nptn, size_t nptn);
+
+    /**
+        @return state of a leaf at a pattern as seen by the likelihood kernel,
+            including padding and unobserved patterns
+    */
+    int getPatternState(PhyloNode *leaf, size_t ptn, size_t max_orig_nptn);
+
     /**
         precompute info for models
     */
@@ -916,6 +1083,34 @@ public:
     template <class VectorClass, const bool SAFE_NUMERIC, const bool FMA = false, const bool SITE_MODEL = false>
     void computePartialLikelihoodGenericSIMD(TraversalInfo &info, size_t ptn_lower, size_t ptn_upper, int thread_id);
 
+    /**
+        site repeats: compute the partial likelihood of a bifurcating node once per repeat class
+        of dad_branch and copy it to all patterns of the class, see computePartialLikelihoodSIMD()
+        for the other parameters
+        @param left, right children of the node, left is a leaf if one of them is
+        @param eleft, eright eigen-transformed transition matrices of left and right
+        @param buffer (3*block+nstates+1)*VectorClass::size() doubles of this packet
+        @param packet_id packet whose entry of repeat_workspace is used
+     */
+    template <class VectorClass, const bool SAFE_NUMERIC, const int nstates, const bool FMA = false>
+    void computePartialRepeatsSIMD(TraversalInfo &info, PhyloNeighbor *left, PhyloNeighbor *right,
+        double *eleft, double *eright, double *partial_lh_leaves, size_t ptn_lower, size_t ptn_upper,
+        double *buffer, int packet_id);
+
+    template <class VectorClass, const bool SAFE_NUMERIC, const bool FMA = false>
+    void computePartialRepeatsGenericSIMD(TraversalInfo &info, PhyloNeighbor *left, PhyloNeighbor *right,
+        double *eleft, double *eright, double *partial_lh_leaves, size_t ptn_lower, size_t ptn_upper,
+        double *buffer, int packet_id);
+
+    /**
+        --float-lh: compute the partial likelihood of a bifurcating node in single precision, two pattern
+        vectors at a time, see computePartialRepeatsSIMD() for the parameters
+        @param ptn_upper ptn_lower plus a multiple of 2*VectorClass::size()
+     */
+    template <class VectorClass, const bool SAFE_NUMERIC, const int nstates, const bool FMA = false>
+    void computePartialLikelihoodFloatSIMD(TraversalInfo &info, PhyloNeighbor *left, PhyloNeighbor *right,
+        double *eleft, double *eright, double *partial_lh_leaves, size_t ptn_lower, size_t ptn_upper, int packet_id);
+
     /*
     template <class VectorClass, const int VCSIZE, const int nstates>
     void computeMixratePartialLikelihoodEigenSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad = NULL);
@@ -1540,6 +1735,15 @@ public:
     /** buffer used when computing partial_lh, to avoid repeated mem allocation */
     double *buffer_partial_lh;
 
+    /**
+        per-packet buffer for single-precision partial_lh: 3 blocks of a pattern vector to compute them
+        in double, or the workspace of computePartialLikelihoodFloatSIMD()
+    */
+    double *buffer_float_lh;
+
+    /** true if partial_lh of the PhyloNeighbors is stored in single precision (--float-lh) */
+    bool float_partial_lh;
+
     /**
      * frequencies of alignment patterns, used as buffer for likelihood computation
      */
@@ -1872,6 +2076,89 @@ public:
     void regraftSubtree(PruningInfo &info,
             PhyloNode *in_node, PhyloNode *in_dad);
 
+    /****************************************************************************
+            Lazy subtree pruning and regrafting (--spr-radius)
+     ****************************************************************************/
+
+    /**
+            @return TRUE if optimizeLazySPR() supports this tree
+     */
+    bool isLazySPRSupported();
+
+    /**
+            search by lazy subtree pruning and regrafting. Every subtree is regrafted onto all
+            branches within the radius. A position is scored after optimizing only the three
+            branches around the regraft point, reusing the partial likelihoods of the pruned tree.
+            Improving moves are applied best first. Repeated until no move improves the tree.
+            @param radius maximal number of branches between prune and regraft point
+            @return the likelihood of the tree
+     */
+    double optimizeLazySPR(int radius);
+
+    /**
+            find the best regraft position of every pruned subtree, see evaluateLazySPR()
+            @param moves [IN/OUT] subtrees to prune, best regraft positions and scores
+            @param radius maximal number of branches between prune and regraft point
+     */
+    virtual void evaluateLazySPRMoves(vector<SPRMove> &moves, int radius);
+
+    /**
+            find the best regraft position of the subtree (move.prune_dad-move.prune_node)
+            within the radius. The tree is unchanged afterwards.
+            @param move [IN/OUT] prune_node and prune_dad given, regraft_node, regraft_dad and
+                score returned (regraft_node is NULL if there is no regraft position)
+            @param radius maximal number of branches between prune and regraft point
+     */
+    void evaluateLazySPR(SPRMove &move, int radius);
+
+    /**
+            score regrafting the subtree of move onto the branch (node2-dad2) and onto the
+            branches behind node2, up to the radius
+            @param depth number of branches between prune point and (node2-dad2)
+     */
+    void evaluateLazySPRRegraft(SPRMove &move, PhyloNode *node2, PhyloNode *dad2, int depth, int radius);
+
+    /**
+            apply a move found by evaluateLazySPR() and optimize the branches around
+            the prune and regraft points. The move is undone if the tree does not improve.
+            @return the new likelihood of the tree, or curScore if the move was undone
+     */
+    double applyLazySPR(SPRMove &move);
+
+    /**
+            collect the subtrees to prune in depth-first order, so that consecutive
+            subtrees share most partial likelihoods
+            @param moves [OUT] one move per subtree with prune_node and prune_dad set
+     */
+    void getLazySPRPrunings(vector<SPRMove> &moves, PhyloNode *node = NULL, PhyloNode *dad = NULL);
+
+    /**
+            remove dad with the subtree below node from the tree by joining the two other
+            branches of dad. The joined branch reuses the neighbors of the two other nodes
+            and takes over the partial likelihoods of their subtrees from dad. Partial
+            likelihoods pointing toward the joined branch are NOT cleared.
+     */
+    void detachSubtree(PhyloNode *node, PhyloNode *dad);
+
+    /**
+            insert dad with the subtree below node, removed by detachSubtree(), in the middle
+            of the branch (node2-dad2). Partial likelihoods pointing toward dad are NOT cleared.
+     */
+    void attachSubtree(PhyloNode *node, PhyloNode *dad, PhyloNode *node2, PhyloNode *dad2);
+
+    /**
+            attach the subtree (dad-node) to the branch (node2-dad2) and optimize the three
+            branches around dad with at most LAZY_SPR_NR_STEP Newton-Raphson steps each
+            @return likelihood of the resulting tree
+     */
+    double regraftLazySPR(PhyloNode *node, PhyloNode *dad, PhyloNode *node2, PhyloNode *dad2);
+
+    /**
+            exchange the partial likelihoods (and scaling, repeats) of two neighbors
+            that are moved to point to each other's subtree
+     */
+    void swapPartialLh(PhyloNeighbor *nei1, PhyloNeighbor *nei2);
+
     /****************************************************************************
             Approximate Likelihood Ratio Test with SH-like interpretation
      ****************************************************************************/
@@ -2031,6 +2318,14 @@ public:
 
     virtual void setNumThreads(int num_threads);
 
+    /**
+        increase num_packets such that the partial likelihoods of one pattern packet,
+        over the nodes of a typical traversal, fit into the cache size of --cache-packets.
+        Called by setNumThreads and before buffer_partial_lh is allocated; once allocated,
+        num_packets stays within buffer_num_packets.
+    */
+    void setNumPacketsByCache();
+
 #if defined(BINARY32) || defined(__NOAVX__)
     void setLikelihoodKernelAVX() {}
     void setLikelihoodKernelFMA() {}
@@ -2382,6 +2677,19 @@ protected:
     UBYTE *central_scale_num;
     UBYTE *nni_scale_num; // used for NNI functions
 
+    /**
+            Neighbor objects and NNI moves reused by getBestNNIForBran for every evaluated branch,
+            so that tentative NNIs do not allocate on the heap
+     */
+    vector<Neighbor*> nni_temp_nei;
+    NNIMove nni_moves[2];
+
+    /**
+            number of bytes of central_partial_lh and central_scale_num mapped to scratch files
+            (--scratch-dir), 0 if they are allocated in RAM
+     */
+    uint64_t central_lh_mapped_size, central_scale_mapped_size;
+
     /**
             the main memory storing all partial parsimony states for all neighbors of the tree.
             The variable partial_pars in PhyloNeighbor will be assigned to a region inside this variable.
@@ -2398,6 +2706,20 @@ protected:
     /** mapping from */
     MemSlotVector mem_slots;
 
+    //----------- site repeats ------//
+
+    /** last version given to a RepeatClasses */
+    int64_t repeat_counter;
+
+    /** RepeatClasses with a version up to this one are outdated */
+    int64_t repeat_epoch;
+
+    /** invariant-site status (ptn_invar != 0) of each pattern that the repeat classes were built with */
+    vector<char> repeat_invar;
+
+    /** index workspace of the site-repeat kernel per packet, sized by updateRepeatClasses() */
+    vector<RepeatWorkspace> repeat_workspace;
+
     /**
             TRUE to discard saturated for Meyer & von Haeseler (2003) model
      */
@@ -36,13 +36,16 @@ void PhyloTree::setParsimonyKernelAVX() {
     // Fitch kernel
 	computeParsimonyBranchPointer = &PhyloTree::computeParsimonyBranchFastSIMD<Vec8ui>;
     computePartialParsimonyPointer = &PhyloTree::computePartialParsimonyFastSIMD<Vec8ui>;
+    computeParsimonyInsertPointer = &PhyloTree::computeParsimonyInsertFastSIMD<Vec8ui>;
 }
 
 void PhyloTree::setDotProductAVX() {
 #ifdef BOOT_VAL_FLOAT
 		dotProduct = &PhyloTree::dotProductSIMD<float, Vec8f>;
+		dotProductMatrix = &PhyloTree::dotProductMatrixSIMD<float, Vec8f>;
 #else
 		dotProduct = &PhyloTree::dotProductSIMD<double, Vec4d>;
+		dotProductMatrix = &PhyloTree::dotProductMatrixSIMD<double, Vec4d>;
 #endif
         dotProductDouble = &PhyloTree::dotProductSIMD<double, Vec4d>;
 }
@@ -1214,13 +1214,21 @@ int PhyloTree::computeParsimonyTree(const char *out_prefix, Alignment *alignment
         added_node->addNeighbor((Node*) 1, -1.0);
         added_node->addNeighbor((Node*) 2, -1.0);
 
-        for (int nodeid = 0; nodeid < nodes1.size(); nodeid++) {
-        
-            int score = addTaxonMPFast(new_taxon, added_node, nodes1[nodeid], nodes2[nodeid]);
-            if (score < best_pars_score) {
-                best_pars_score = score;
-                target_node = (PhyloNode*)nodes1[nodeid];
-                target_dad = (PhyloNode*)nodes2[nodeid];
+        if (computeParsimonyInsertPointer) {
+            // score all branches in one pass without inserting added_node
+            int best_id;
+            best_pars_score = (this->*computeParsimonyInsertPointer)(
+                (PhyloNeighbor*)added_node->findNeighbor(new_taxon), added_node, nodes1, nodes2, best_id);
+            target_node = (PhyloNode*)nodes1[best_id];
+            target_dad = (PhyloNode*)nodes2[best_id];
+        } else {
+            for (int nodeid = 0; nodeid < nodes1.size(); nodeid++) {
+                int score = addTaxonMPFast(new_taxon, added_node, nodes1[nodeid], nodes2[nodeid]);
+                if (score < best_pars_score) {
+                    best_pars_score = score;
+                    target_node = (PhyloNode*)nodes1[nodeid];
+                    target_dad = (PhyloNode*)nodes2[nodeid];
+                }
             }
         }
         
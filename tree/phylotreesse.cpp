@@ -19,6 +19,7 @@
  ***************************************************************************/
 #include "phylotree.h"
 #include "vectorclass/instrset.h"
+#include "utils/timeutil.h"
 
 #if INSTRSET < 2
 #include "phylokernelnew.h"
@@ -49,10 +50,45 @@ void PhyloTree::setNumThreads(int threadCount) {
     }
     this->num_threads = threadCount;
     this->num_packets = (num_threads==1) ? 1 : (num_threads*PACKETS_PER_THREAD);
+    // keep the cache-sized packets for the new thread count
+    setNumPacketsByCache();
+}
+
+void PhyloTree::setNumPacketsByCache() {
+    if (!params || params->lh_cache_size == 0 || isSuperTree() || !aln || !model || !site_rate)
+        return;
+    int64_t cache_size = params->lh_cache_size;
+    if (cache_size < 0)
+        cache_size = getL2CacheSize();
+    if (cache_size <= 0)
+        return;
+    const size_t VECTOR_SIZE = 8; // largest SIMD width, as in getBufferPartialLhSize
+    size_t ncat_mix = site_rate->getNRate() * ((model_factory->fused_mix_rate)? 1 : model->getNMixtures());
+    size_t nptn = get_safe_upper_limit(aln->getNPattern()) + get_safe_upper_limit(model_factory->unobserved_ptns.size());
+    // working set per pattern: partial_lh and scale_num of every node of a traversal,
+    // approximated by the depth of a balanced tree plus the two branch ends
+    size_t depth = (size_t)ceil(log2((double)max((int)leafNum, 2))) + 2;
+    size_t bytes_per_ptn = ncat_mix * (model->num_states * sizeof(double) + sizeof(UBYTE)) * depth;
+    size_t packet_ptns = max((size_t)cache_size / bytes_per_ptn, VECTOR_SIZE);
+    size_t packets = (nptn + packet_ptns - 1) / packet_ptns;
+    // each packet spans at least one full vector
+    packets = min(packets, max(nptn / VECTOR_SIZE, (size_t)1));
+    packets = roundUpToMultiple(packets, (size_t)num_threads);
+    // buffer_partial_lh holds per-packet workspace and cannot grow here
+    if (buffer_num_packets > 0 && packets > (size_t)buffer_num_packets)
+        packets = (buffer_num_packets / num_threads) * num_threads;
+    if (packets <= (size_t)num_packets)
+        return;
+    num_packets = packets;
+    if (verbose_mode >= VB_MED)
+        cout << "Likelihood kernel uses " << num_packets << " packets of ~" << (nptn+num_packets-1)/num_packets
+             << " patterns for " << cache_size/1024 << " KB cache" << endl;
 }
 
 void PhyloTree::setParsimonyKernel(LikelihoodKernel lk) {
     
+    // only the SIMD Fitch kernels score insertions in batch
+    computeParsimonyInsertPointer = NULL;
     if (cost_matrix) {
         // Sankoff parsimony kernel
         if (lk < LK_SSE2) {
@@ -77,6 +113,12 @@ void PhyloTree::setParsimonyKernel(LikelihoodKernel lk) {
         computePartialParsimonyPointer = &PhyloTree::computePartialParsimonyFast;
     	return;
     }
+#ifdef __AVX512KNL
+    if (lk >= LK_AVX512) {
+        setParsimonyKernelAVX512();
+        return;
+    }
+#endif
     if (lk >= LK_AVX) {
         setParsimonyKernelAVX();
         return;
@@ -95,6 +137,10 @@ void PhyloTree::setLikelihoodKernel(LikelihoodKernel lk) {
     safe_numeric = (params && (params->lk_safe_scaling || leafNum >= params->numseq_safe_scaling)) ||
         (aln && aln->num_states != 4 && aln->num_states != 20);
 
+    // the kernel selected below reads partial_lh in double precision, reallocate it on the next use
+    if (float_partial_lh && !useFloatPartialLh())
+        deleteAllPartialLh();
+
     //--- parsimony kernel ---
     setParsimonyKernel(lk);
 
@@ -119,6 +165,7 @@ void PhyloTree::setLikelihoodKernel(LikelihoodKernel lk) {
 //		dotProduct = &PhyloTree::dotProductSIMD<float, Vec1f>;
 #else
 		dotProduct = &PhyloTree::dotProductSIMD<double, Vec1d>;
+		dotProductMatrix = &PhyloTree::dotProductMatrixSIMD<double, Vec1d>;
 #endif
         dotProductDouble = &PhyloTree::dotProductSIMD<double, Vec1d>;
 #endif
@@ -68,6 +68,16 @@ public:
         return (new SuperNeighbor(this));
     }
 
+    /**
+     reset this Neighbor to a copy of another one of the same type, like newNeighbor()
+     but reusing the memory of this object
+     @param nei another Neighbor
+     */
+    virtual void copyNeighbor(Neighbor *nei) {
+        PhyloNeighbor::copyNeighbor(nei);
+        link_neighbors.clear();
+    }
+
 	/**
 		vector of size m (m = #partitions)
 	*/
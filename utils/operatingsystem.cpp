@@ -8,10 +8,21 @@
 #include "operatingsystem.h"
 #include <string>
 #include <sstream>
+#include <algorithm>
+#include <stdio.h>
+#ifdef __linux__
+    #include <sched.h>
+    #include <dirent.h>
+    #include <stdlib.h>
+#endif
 #if defined(WIN32) || defined(WIN64)
     #include <io.h> //for _isatty
 #else
     #include <unistd.h> //for isatty
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <map>
+    #include <mutex>
 #endif
 
 std::string getOSName() {
@@ -38,3 +49,155 @@ bool isStandardOutputATerminal() {
     return isatty(fileno(stdout));
 #endif
 }
+
+int getNumaNodeOfCPU(int cpu) {
+#ifdef __linux__
+    // the sysfs directory of a CPU contains a link "nodeN" to its NUMA node
+    std::stringstream path;
+    path << "/sys/devices/system/cpu/cpu" << cpu;
+    DIR *dir = opendir(path.str().c_str());
+    if (!dir)
+        return 0;
+    int node = 0;
+    while (struct dirent *entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.size() > 4 && name.compare(0, 4, "node") == 0 &&
+            name.find_first_not_of("0123456789", 4) == std::string::npos) {
+            node = atoi(name.c_str() + 4);
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+#else
+    return 0;
+#endif
+}
+
+int getCurrentCPU() {
+#ifdef __linux__
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
+
+int getCPUsByNumaNode(std::vector<int> &cpus) {
+    cpus.clear();
+#ifdef __linux__
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (sched_getaffinity(0, sizeof(mask), &mask) != 0)
+        return 0;
+    std::vector<std::pair<int,int> > node_cpu;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        if (CPU_ISSET(cpu, &mask))
+            node_cpu.push_back(std::make_pair(getNumaNodeOfCPU(cpu), cpu));
+    std::sort(node_cpu.begin(), node_cpu.end());
+    int num_nodes = 0;
+    for (size_t i = 0; i < node_cpu.size(); i++) {
+        if (i == 0 || node_cpu[i].first != node_cpu[i-1].first)
+            num_nodes++;
+        cpus.push_back(node_cpu[i].second);
+    }
+    return num_nodes;
+#else
+    return 0;
+#endif
+}
+
+bool pinThreadToCPU(int cpu) {
+#ifdef __linux__
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    CPU_SET(cpu, &mask);
+    return sched_setaffinity(0, sizeof(mask), &mask) == 0;
+#else
+    return false;
+#endif
+}
+
+#if !defined(WIN32) && !defined(WIN64)
+/** file descriptors of the scratch files by start of their mapping, kept open for write-back */
+static std::map<char*, std::pair<size_t, int> > scratch_files;
+static std::mutex scratch_files_mutex;
+
+/** extend a region to whole pages as required by madvise() and sync_file_range() */
+static void alignToPages(void *&addr, size_t &size) {
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    size_t offset = (size_t)addr % page_size;
+    addr = (char*)addr - offset;
+    size += offset;
+}
+#endif
+
+void *mapScratchFile(const char *dir, size_t size) {
+#if defined(WIN32) || defined(WIN64)
+    return NULL;
+#else
+    std::string path = std::string(dir) + "/iqtree-scratch-XXXXXX";
+    std::vector<char> name(path.begin(), path.end());
+    name.push_back(0);
+    int fd = mkstemp(name.data());
+    if (fd < 0)
+        return NULL;
+    unlink(name.data());
+    // reserve the disk space now rather than failing with SIGBUS on a full disk later
+#ifdef __linux__
+    bool ok = posix_fallocate(fd, 0, size) == 0;
+#else
+    bool ok = ftruncate(fd, size) == 0;
+#endif
+    void *addr = ok ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    if (addr == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    std::lock_guard<std::mutex> lock(scratch_files_mutex);
+    scratch_files[(char*)addr] = std::make_pair(size, fd);
+    return addr;
+#endif
+}
+
+void unmapScratchFile(void *addr, size_t size) {
+#if !defined(WIN32) && !defined(WIN64)
+    if (!addr)
+        return;
+    munmap(addr, size);
+    std::lock_guard<std::mutex> lock(scratch_files_mutex);
+    auto it = scratch_files.find((char*)addr);
+    if (it != scratch_files.end()) {
+        close(it->second.second);
+        scratch_files.erase(it);
+    }
+#endif
+}
+
+void prefetchMappedRegion(void *addr, size_t size) {
+#if !defined(WIN32) && !defined(WIN64)
+    alignToPages(addr, size);
+    madvise(addr, size, MADV_WILLNEED);
+#endif
+}
+
+void writeBackMappedRegion(void *addr, size_t size) {
+#ifdef __linux__
+    // msync(MS_ASYNC) does not start any I/O on Linux, sync_file_range() does
+    alignToPages(addr, size);
+    int fd = -1;
+    size_t offset = 0;
+    {
+        std::lock_guard<std::mutex> lock(scratch_files_mutex);
+        auto it = scratch_files.upper_bound((char*)addr);
+        if (it == scratch_files.begin())
+            return;
+        --it;
+        offset = (char*)addr - it->first;
+        if (offset >= it->second.first)
+            return;
+        size = std::min(size, it->second.first - offset);
+        fd = it->second.second;
+    }
+    sync_file_range(fd, offset, size, SYNC_FILE_RANGE_WRITE);
+#endif
+}
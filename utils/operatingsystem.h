@@ -9,8 +9,57 @@
 #define operatingsystem_h
 
 #include <string>
+#include <vector>
 
 std::string getOSName();
 bool isStandardOutputATerminal();
 
+/**
+    @return NUMA node of a logical CPU, 0 if unknown or not a NUMA system
+*/
+int getNumaNodeOfCPU(int cpu);
+
+/**
+    @return logical CPU the calling thread is currently running on, -1 if unknown
+*/
+int getCurrentCPU();
+
+/**
+    list the logical CPUs available to this process, sorted by NUMA node
+    @param[out] cpus CPU IDs grouped by NUMA node, ascending within each node
+    @return number of NUMA nodes spanned by cpus
+*/
+int getCPUsByNumaNode(std::vector<int> &cpus);
+
+/**
+    bind the calling thread to one logical CPU
+    @return true if successful, false if not supported
+*/
+bool pinThreadToCPU(int cpu);
+
+/**
+    map a new scratch file into memory. The file is removed from dir at once,
+    so that its space is freed when the mapping ends
+    @param dir directory of the scratch file
+    @param size number of bytes
+    @return start of the mapping, NULL if failed or not supported
+*/
+void *mapScratchFile(const char *dir, size_t size);
+
+/**
+    end a mapping made by mapScratchFile()
+*/
+void unmapScratchFile(void *addr, size_t size);
+
+/**
+    ask the OS to read in a region of a mapped file in the background
+*/
+void prefetchMappedRegion(void *addr, size_t size);
+
+/**
+    start writing back the dirty pages of a region of a file mapped by mapScratchFile()
+    without waiting (Linux only, no effect elsewhere)
+*/
+void writeBackMappedRegion(void *addr, size_t size);
+
 #endif /* operatingsystem_h */
@@ -16,11 +16,29 @@
 #include <iostream>
 #include "lbfgsb/lbfgsb_new.h"
 #include "tools.h"
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 
 using namespace std;
 
 const double ERROR_X = 1.0e-4;
+// single-precision partial likelihoods (--float-lh) add rounding noise of about 1e-3 to the
+// log-likelihood, which a step of ERROR_X (or less for parameters near zero) turns into a wrong gradient
+const double ERROR_X_FLOAT = 1.0e-3;
+
+/**
+    @param x parameter value
+    @return step of the finite-difference gradient of x in derivativeFunk()
+*/
+static inline double finiteDiffStep(double x) {
+    if (Params::getInstance().lh_float)
+        return ERROR_X_FLOAT * max(fabs(x), 1.0);
+    double h = ERROR_X * fabs(x);
+    return (h == 0.0) ? ERROR_X : h;
+}
 
 double ran1(long *idum);
 double *new_vector(long nl, long nh);
@@ -923,10 +941,32 @@ double Optimization::derivativeFunk(double x[], double dfx[]) {
     double temp;
     int dim;
 	double fx = targetFunk(x);
+#ifdef _OPENMP
+    if (!gradient_workers.empty() && ndim > 1 && !omp_in_parallel()) {
+        int nworkers = min((int)gradient_workers.size(), ndim);
+        #pragma omp parallel num_threads(nworkers)
+        {
+            Optimization *worker = gradient_workers[omp_get_thread_num()];
+            double *xx = new double[ndim+1];
+            #pragma omp for schedule(dynamic)
+            for (int d = 1; d <= ndim; d++) {
+                memcpy(xx, x, sizeof(double)*(ndim+1));
+                h[d] = finiteDiffStep(x[d]);
+                xx[d] = x[d] + h[d];
+                h[d] = xx[d] - x[d];
+                dfx[d] = worker->targetFunk(xx);
+            }
+            delete [] xx;
+        }
+        for (dim = 1; dim <= ndim; dim++ )
+            dfx[dim] = (dfx[dim] - fx) / h[dim];
+        delete [] h;
+        return fx;
+    }
+#endif
 	for (dim = 1; dim <= ndim; dim++ ){
 		temp = x[dim];
-		h[dim] = ERROR_X * fabs(temp);
-		if (h[dim] == 0.0) h[dim] = ERROR_X;
+		h[dim] = finiteDiffStep(temp);
 		x[dim] = temp + h[dim];
 		h[dim] = x[dim] - temp;
 		dfx[dim] = (targetFunk(x));
@@ -938,6 +978,30 @@ double Optimization::derivativeFunk(double x[], double dfx[]) {
 	return fx;
 }
 
+double Optimization::checkDerivativeFunk(double x[]) {
+    int ndim = getNDim();
+    double *dfx = new double[ndim+1];
+    double *xx = new double[ndim+1];
+    double max_err = 0.0;
+    derivativeFunk(x, dfx);
+    memcpy(xx, x, sizeof(double)*(ndim+1));
+    for (int dim = 1; dim <= ndim; dim++) {
+        double h = max(1e-5 * fabs(x[dim]), 1e-8);
+        xx[dim] = x[dim] + h;
+        double f_plus = targetFunk(xx);
+        xx[dim] = x[dim] - h;
+        double f_minus = targetFunk(xx);
+        xx[dim] = x[dim];
+        double fd = (f_plus - f_minus) / (2.0*h);
+        max_err = max(max_err, fabs(fd - dfx[dim]) / max(fabs(dfx[dim]), 1.0));
+    }
+    // back to the state at x
+    targetFunk(x);
+    delete [] xx;
+    delete [] dfx;
+    return max_err;
+}
+
 
 /*#define NRANSI
 #define ITMAX 100
@@ -13,6 +13,7 @@
 #define OPTIMIZATION_H
 
 #include <iostream>
+#include <vector>
 
 /**
 Optimization class, implement some methods like Brent, Newton-Raphson (for 1 variable function), BFGS (for multi-dimensional function)
@@ -144,6 +145,21 @@ public:
 	*/
 	virtual double derivativeFunk(double x[], double dfx[]);
 
+	/**
+		compare derivativeFunk with central differences of targetFunk (--check-grad)
+		@param x the input vector x
+		@return the largest relative error of the derivative over all dimensions
+	*/
+	double checkDerivativeFunk(double x[]);
+
+	/**
+		copies of this object with their own likelihood state (--grad-workers).
+		If not empty, derivativeFunk evaluates the perturbed targetFunk of different
+		dimensions concurrently, one thread per worker.
+		The caller is responsible to keep the workers in sync with this object.
+	*/
+	std::vector<Optimization*> gradient_workers;
+
 	/**
 	        Controls restarting of optimization if optimization gets
                 stuck on the boundary. Models are free to override this
@@ -285,6 +285,26 @@ __inline uint64_t getMemorySize( )
 }
 
 
+/**
+ * Returns the size of the (per-core) level-2 data cache in bytes, 0 if unknown.
+ */
+__inline uint64_t getL2CacheSize( )
+{
+#if defined(__APPLE__) && defined(__MACH__)
+	uint64_t size = 0;
+	size_t len = sizeof( size );
+	if ( sysctlbyname( "hw.l2cachesize", &size, &len, NULL, 0 ) == 0 )
+		return size;
+	return 0L;
+#elif defined(_SC_LEVEL2_CACHE_SIZE)
+	long size = sysconf( _SC_LEVEL2_CACHE_SIZE );
+	return (size > 0) ? (uint64_t)size : 0L;
+#else
+	return 0L;			/* Unknown OS. */
+#endif
+}
+
+
 #define HOW_LONG(x) \
 { std::cout.precision(6); double startTime = getRealTime(); \
 x; \
@@ -1093,6 +1093,7 @@ void parseArg(int argc, char *argv[], Params &params) {
     params.gurobi_threads = 1;
     params.num_bootstrap_samples = 0;
     params.bootstrap_spec = NULL;
+    params.num_boot_workers = 0;
     params.transfer_bootstrap = 0;
 
     params.aln_file = NULL;
@@ -1119,6 +1120,7 @@ void parseArg(int argc, char *argv[], Params &params) {
     params.merge_models = "1";
     params.merge_rates = "1";
     params.partfinder_log_rate = true;
+    params.partfinder_topk = 0;
     
     params.sequence_type = NULL;
     params.aln_output = NULL;
@@ -1140,6 +1142,9 @@ void parseArg(int argc, char *argv[], Params &params) {
     params.numSmoothTree = 1;
     params.nni5 = true;
     params.nni5_num_eval = 1;
+    params.num_nni_workers = 0;
+    params.lazy_spr_radius = 0;
+    params.num_search_workers = 0;
     params.brlen_num_traversal = 1;
     params.leastSquareBranch = false;
     params.pars_branch_length = false;
@@ -1173,6 +1178,7 @@ void parseArg(int argc, char *argv[], Params &params) {
     params.optimize_mixmodel_weight = false;
     params.optimize_rate_matrix = false;
     params.store_trans_matrix = false;
+    params.trans_cache_size = 64 * 1048576;
     //params.freq_type = FREQ_EMPIRICAL;
     params.freq_type = FREQ_UNKNOWN;
     params.keep_zero_freq = true;
@@ -1185,8 +1191,10 @@ void parseArg(int argc, char *argv[], Params &params) {
     params.gamma_median = false;
     params.p_invar_sites = -1.0;
     params.optimize_model_rate_joint = false;
+    params.num_grad_workers = 0;
     params.optimize_by_newton = true;
     params.optimize_alg_freerate = "2-BFGS,EM";
+    params.check_gradient = false;
     params.optimize_alg_mixlen = "EM";
     params.optimize_alg_gammai = "EM";
     params.optimize_alg_treeweight = "EM";
@@ -1327,6 +1335,7 @@ void parseArg(int argc, char *argv[], Params &params) {
     params.num_threads = 1;
     params.num_threads_max = 10000;
     params.openmp_by_model = false;
+    params.num_threads_per_model = 0;
     params.model_test_criterion = MTC_BIC;
 //    params.model_test_stop_rule = MTC_ALL;
     params.model_test_sample_size = 0;
@@ -1344,6 +1353,11 @@ void parseArg(int argc, char *argv[], Params &params) {
 	params.print_branch_lengths = false;
 	params.lh_mem_save = LM_PER_NODE; // auto detect
     params.buffer_mem_save = false;
+    params.lh_site_repeats = false;
+    params.lh_float = false;
+    params.lh_cache_size = 0;
+    params.numa_aware = false;
+    params.lh_scratch_dir = NULL;
 	params.start_tree = STT_PLL_PARSIMONY;
     params.start_tree_subtype_name = StartTree::Factory::getNameOfDefaultTreeBuilder();
 
@@ -1583,6 +1597,10 @@ void parseArg(int argc, char *argv[], Params &params) {
 				params.optimize_alg_freerate = argv[cnt];
 				continue;
 			}
+			if (strcmp(argv[cnt], "--check-grad") == 0) {
+				params.check_gradient = true;
+				continue;
+			}
 			if (strcmp(argv[cnt], "-optlen") == 0) {
 				cnt++;
 				if (cnt >= argc)
@@ -2525,6 +2543,16 @@ void parseArg(int argc, char *argv[], Params &params) {
                 continue;
             }
 
+            if (strcmp(argv[cnt], "--merge-topk") == 0) {
+                cnt++;
+                if (cnt >= argc)
+                    throw "Use --merge-topk NUM";
+                params.partfinder_topk = convert_int(argv[cnt]);
+                if (params.partfinder_topk < 0)
+                    throw "--merge-topk must be >= 0";
+                continue;
+            }
+
 			if (strcmp(argv[cnt], "-keep_empty_seq") == 0) {
 				params.remove_empty_seq = false;
 				continue;
@@ -3239,6 +3267,23 @@ void parseArg(int argc, char *argv[], Params &params) {
 				params.store_trans_matrix = true;
 				continue;
 			}
+            if (strcmp(argv[cnt], "--mstore-mem") == 0) {
+                cnt++;
+                if (cnt >= argc)
+                    throw "Use --mstore-mem <cache_size>[M|G]";
+                int end_pos;
+                double cache = convert_double(argv[cnt], end_pos);
+                if (cache <= 0)
+                    throw "--mstore-mem must be positive";
+                if (argv[cnt][end_pos] == 'G') {
+                    params.trans_cache_size = cache * 1073741824.0;
+                } else if (argv[cnt][end_pos] == 'M' || argv[cnt][end_pos] == 0) {
+                    params.trans_cache_size = cache * 1048576.0;
+                } else
+                    throw "Invalid --mstore-mem option. Example: --mstore-mem 100M, --mstore-mem 1G";
+                params.store_trans_matrix = true;
+                continue;
+            }
 			if (strcmp(argv[cnt], "-nni_lh") == 0) {
 				params.nni_lh = true;
 				continue;
@@ -3453,6 +3498,15 @@ void parseArg(int argc, char *argv[], Params &params) {
 				params.optimize_model_rate_joint = false;
 				continue;
 			}
+            if (strcmp(argv[cnt], "--grad-workers") == 0) {
+                cnt++;
+                if (cnt >= argc)
+                    throw "Use --grad-workers <num_workers>";
+                params.num_grad_workers = convert_int(argv[cnt]);
+                if (params.num_grad_workers < 0)
+                    throw "--grad-workers must not be negative";
+                continue;
+            }
 			if (strcmp(argv[cnt], "-fixbr") == 0 || strcmp(argv[cnt], "-blfix") == 0) {
 				params.fixed_branch_length = BRLEN_FIX;
                 params.optimize_alg_gammai = "Brent";
@@ -3585,6 +3639,15 @@ void parseArg(int argc, char *argv[], Params &params) {
                 params.remove_empty_seq = false;
 				continue;
 			}
+            if (strcmp(argv[cnt], "--boot-workers") == 0) {
+                cnt++;
+                if (cnt >= argc)
+                    throw "Use --boot-workers <num_workers>";
+                params.num_boot_workers = convert_int(argv[cnt]);
+                if (params.num_boot_workers < 0)
+                    throw "--boot-workers must not be negative";
+                continue;
+            }
             
             if (strcmp(argv[cnt], "--subsample") == 0) {
                 cnt++;
@@ -4190,6 +4253,47 @@ void parseArg(int argc, char *argv[], Params &params) {
                 params.buffer_mem_save = false;
                 continue;
             }
+            if (strcmp(argv[cnt], "--site-repeats") == 0) {
+                params.lh_site_repeats = true;
+                continue;
+            }
+            if (strcmp(argv[cnt], "--float-lh") == 0) {
+                params.lh_float = true;
+                continue;
+            }
+            if (strcmp(argv[cnt], "--numa") == 0) {
+                params.numa_aware = true;
+                continue;
+            }
+            if (strcmp(argv[cnt], "--scratch-dir") == 0) {
+                cnt++;
+                if (cnt >= argc)
+                    throw "Use --scratch-dir DIR";
+                params.lh_scratch_dir = argv[cnt];
+                continue;
+            }
+            if (strcmp(argv[cnt], "--cache-packets") == 0) {
+                cnt++;
+                if (cnt >= argc)
+                    throw "Use --cache-packets AUTO|<cache_size>[K|M]";
+                if (iEquals(argv[cnt], "AUTO")) {
+                    params.lh_cache_size = -1;
+                    continue;
+                }
+                int end_pos;
+                double cache = convert_double(argv[cnt], end_pos);
+                if (cache <= 0)
+                    throw "--cache-packets must be positive";
+                if (argv[cnt][end_pos] == 'M') {
+                    params.lh_cache_size = cache * 1048576.0;
+                } else if (argv[cnt][end_pos] == 'K') {
+                    params.lh_cache_size = cache * 1024.0;
+                } else if (argv[cnt][end_pos] == 0) {
+                    params.lh_cache_size = cache;
+                } else
+                    throw "Invalid --cache-packets option. Example: --cache-packets 512K, --cache-packets 1M";
+                continue;
+            }
 //			if (strcmp(argv[cnt], "-storetrees") == 0) {
 //				params.store_candidate_trees = true;
 //				continue;
@@ -4495,6 +4599,33 @@ void parseArg(int argc, char *argv[], Params &params) {
                     throw("Positive -nni-eval expected");
                 continue;
             }
+            if (strcmp(argv[cnt], "--nni-workers") == 0) {
+                cnt++;
+                if (cnt >= argc)
+                    throw "Use --nni-workers <num_workers>";
+                params.num_nni_workers = convert_int(argv[cnt]);
+                if (params.num_nni_workers < 0)
+                    throw "--nni-workers must not be negative";
+                continue;
+            }
+            if (strcmp(argv[cnt], "--search-workers") == 0) {
+                cnt++;
+                if (cnt >= argc)
+                    throw "Use --search-workers <num_workers>";
+                params.num_search_workers = convert_int(argv[cnt]);
+                if (params.num_search_workers < 0)
+                    throw "--search-workers must not be negative";
+                continue;
+            }
+            if (strcmp(argv[cnt], "--spr-radius") == 0) {
+                cnt++;
+                if (cnt >= argc)
+                    throw "Use --spr-radius <num_branches>";
+                params.lazy_spr_radius = convert_int(argv[cnt]);
+                if (params.lazy_spr_radius < 0)
+                    throw "--spr-radius must not be negative";
+                continue;
+            }
 
             if (strcmp(argv[cnt], "-bl-eval") == 0) {
 				cnt++;
@@ -4653,6 +4784,17 @@ void parseArg(int argc, char *argv[], Params &params) {
                 continue;
             }
 
+            if (strcmp(argv[cnt], "--threads-per-model") == 0) {
+                cnt++;
+                if (cnt >= argc)
+                    throw "Use --threads-per-model <num_threads>";
+                params.num_threads_per_model = convert_int(argv[cnt]);
+                if (params.num_threads_per_model < 1)
+                    throw "At least 1 thread please";
+                params.openmp_by_model = true;
+                continue;
+            }
+
             if (strcmp(argv[cnt], "--thread-site") == 0) {
                 params.openmp_by_model = false;
                 continue;
@@ -5656,6 +5798,10 @@ void usage_iqtree(char* argv[], bool full_command) {
     << "  --seed NUM           Random seed number, normally used for debugging purpose" << endl
     << "  --safe               Safe likelihood kernel to avoid numerical underflow" << endl
     << "  --mem NUM[G|M|%]     Maximal RAM usage in GB | MB | %" << endl
+    << "  --cache-packets SIZE Kernel pattern packets fit SIZE[K|M] or AUTO cache (default: OFF)" << endl
+    << "  --site-repeats       Compute repeated site patterns below a node only once" << endl
+    << "  --float-lh           Store partial likelihoods in single precision" << endl
+    << "  --scratch-dir DIR    Keep partial likelihoods in memory-mapped files in DIR" << endl
     << "  --runs NUM           Number of indepedent runs (default: 1)" << endl
     << "  -v, --verbose        Verbose mode, printing more messages to screen" << endl
     << "  -V, --version        Display version number" << endl
@@ -5665,6 +5811,7 @@ void usage_iqtree(char* argv[], bool full_command) {
 #ifdef _OPENMP
     << "  -T NUM|AUTO          No. cores/threads or AUTO-detect (default: 1)" << endl
     << "  --threads-max NUM    Max number of threads for -T AUTO (default: all cores)" << endl
+    << "  --numa               Pin threads and place partial likelihoods per NUMA node" << endl
 #endif
     << endl << "CHECKPOINT:" << endl
     << "  --redo               Redo both ModelFinder and tree search" << endl
@@ -5693,6 +5840,9 @@ void usage_iqtree(char* argv[], bool full_command) {
     << "  --perturb NUM        Perturbation strength for randomized NNI (default: 0.5)" << endl
     << "  --radius NUM         Radius for parsimony SPR search (default: 6)" << endl
     << "  --allnni             Perform more thorough NNI search (default: OFF)" << endl
+    << "  --nni-workers NUM    Evaluate NNIs on NUM tree copies in parallel (default: OFF)" << endl
+    << "  --spr-radius NUM     Also search by lazy SPR moves up to NUM branches (default: OFF)" << endl
+    << "  --search-workers NUM Run NUM search iterations concurrently (default: OFF)" << endl
     << "  -g FILE              (Multifurcating) topological constraint tree file" << endl
     << "  --fast               Fast search to resemble FastTree" << endl
     << "  --polytomy           Collapse near-zero branches into polytomy" << endl
@@ -5723,6 +5873,7 @@ void usage_iqtree(char* argv[], bool full_command) {
     << "  --jack-prop NUM      Subsampling proportion for jackknife (default: 0.5)" << endl
     << "  --bcon NUM           Replicates for bootstrap + consensus tree" << endl
     << "  --bonly NUM          Replicates for bootstrap only" << endl
+    << "  --boot-workers NUM   Run NUM replicates concurrently (default: OFF)" << endl
 #ifdef USE_BOOSTER
     << "  --tbe                Transfer bootstrap expectation" << endl
 #endif
@@ -5772,6 +5923,7 @@ void usage_iqtree(char* argv[], bool full_command) {
     << "  --rcluster NUM       Percentage of partition pairs for rcluster algorithm" << endl
     << "  --rclusterf NUM      Percentage of partition pairs for rclusterf algorithm" << endl
     << "  --rcluster-max NUM   Max number of partition pairs (default: 10*partitions)" << endl
+    << "  --merge-topk NUM     Examine closest pairs NUM at a time, stop at a better one" << endl
 
     << endl << "SUBSTITUTION MODEL:" << endl
     << "  -m STRING            Model name string (e.g. GTR+F+I+G)" << endl
@@ -6257,7 +6409,7 @@ int finish_random() {
 
 /******************/
 
-int *randstream;
+thread_local int *randstream;
 
 int init_random(int seed, bool write_info, int** rstream) {
     //    srand((unsigned) time(NULL));
@@ -776,6 +776,15 @@ public:
 	 */
 	int nni5_num_eval;
 
+    /** number of tree copies to evaluate NNIs of different branches concurrently, 0 to disable */
+    int num_nni_workers;
+
+    /** maximal number of branches between prune and regraft point of lazy SPR moves, 0 to disable */
+    int lazy_spr_radius;
+
+    /** number of tree copies to run search iterations concurrently, 0 to disable */
+    int num_search_workers;
+
 	/**
 	 *  Number of traversal for all branch lengths optimization of the initial tree 
 	 */
@@ -983,6 +992,10 @@ public:
 
     /** use logarithm of rates for clustering algorithm */
     bool partfinder_log_rate;
+
+    /** examine the closest partition pairs in batches of this size and end a merging round
+        at the first batch with a better scheme, 0 (default) to examine all pairs */
+    int partfinder_topk;
     
     /************************************************/
     /******* variables for Terrace analysis *********/
@@ -1609,6 +1622,11 @@ public:
      */
     bool store_trans_matrix;
 
+    /**
+            memory cap (bytes) of the stored transition matrices per model
+     */
+    int64_t trans_cache_size;
+
     /**
             state frequency type
      */
@@ -1660,6 +1678,9 @@ public:
     /** TRUE to optimize all model and rate parameters jointly by BFGS, default: FALSE */
     bool optimize_model_rate_joint;
 
+    /** number of model copies to evaluate finite-difference gradients concurrently, 0 to disable */
+    int num_grad_workers;
+
     /**
             TRUE if you want to optimize branch lengths by Newton-Raphson method
      */
@@ -1668,6 +1689,12 @@ public:
     /** optimization algorithm for free rate model: 1-BFGS, 2-BFGS, EM */
     string optimize_alg_freerate;
 
+    /**
+        TRUE to compare the gradient of the free rate model with central differences
+        before each BFGS optimization (for testing), default: false
+    */
+    bool check_gradient;
+
     /** optimization algorithm for mixture (heterotachy) branch length models */
     string optimize_alg_mixlen;
 
@@ -1735,6 +1762,9 @@ public:
     */
     char *bootstrap_spec;
 
+    /** number of standard bootstrap replicates run concurrently, each with a share of the threads, 0 to disable */
+    int num_boot_workers;
+
     /** 1 or 2 to perform transfer boostrap expectation (TBE) */
     int transfer_bootstrap;
     
@@ -2194,6 +2224,9 @@ public:
     /** true to parallel ModelFinder by models instead of sites */
     bool openmp_by_model;
 
+    /** number of threads for each model evaluated concurrently by ModelFinder, 0 for automatic */
+    int num_threads_per_model;
+
     /** either MTC_AIC, MTC_AICc, MTC_BIC */
     ModelTestCriterion model_test_criterion;
 
@@ -2252,9 +2285,39 @@ public:
     /** true to save buffer, default: false */
     bool buffer_mem_save;
 
+    /**
+        TRUE to compute the partial likelihoods of patterns with identical tip states
+        below a node only once (site repeats), default: false
+    */
+    bool lh_site_repeats;
+
+    /**
+        TRUE to store partial likelihoods in single precision to halve their memory,
+        only honoured by the reversible SIMD kernels, default: false
+    */
+    bool lh_float;
+
+    /**
+        cache size (bytes) that one pattern packet of the likelihood kernel should fit into,
+        0 (default) to split patterns by the number of threads only, -1 to auto-detect L2 size
+    */
+    int64_t lh_cache_size;
+
+    /**
+        TRUE to pin threads to CPUs grouped by NUMA node, schedule kernel packets statically
+        and first-touch each thread's pattern slice of the partial likelihood vectors
+    */
+    bool numa_aware;
+
     /** maximum size of memory allowed to use */
     double max_mem_size;
 
+    /**
+        directory of scratch files holding the partial likelihood vectors out of core,
+        NULL (default) to keep them in RAM
+    */
+    char *lh_scratch_dir;
+
 	/* TRUE to print .splits file in star-dot format */
 	bool print_splits_file;
     
@@ -3156,7 +3219,8 @@ double computePValueChiSquare(double x, int df);
 /* random number generator */
 /*--------------------------------------------------------------*/
 
-extern int *randstream;
+/** random stream of the calling thread, so that concurrent analyses (--boot-workers) draw independently */
+extern thread_local int *randstream;
 
 /**
  * initialize the random number generator